@@ -0,0 +1,31 @@
+#include <kernel/core/context.h>
+
+// mirrors the pushes in context_switch
+typedef struct __attribute__((packed)) switch_frame
+{
+    u32 edi;
+    u32 esi;
+    u32 ebx;
+    u32 ebp;
+    u32 eip;
+
+    // fake return address of entry, it never returns
+    u32 entry_ret;
+} switch_frame_t;
+
+usize_ptr context_init_stack(void* stack_top, void (*entry)())
+{
+    // keep the SysV 16 byte alignment at the entry call site
+    usize_ptr top = (usize_ptr)stack_top & ~(usize_ptr)0xF;
+
+    switch_frame_t* frame = (switch_frame_t*)(top - sizeof(switch_frame_t));
+
+    frame->edi = 0;
+    frame->esi = 0;
+    frame->ebx = 0;
+    frame->ebp = 0;
+    frame->eip = (u32)entry;
+    frame->entry_ret = 0;
+
+    return (usize_ptr)frame;
+}
@@ -0,0 +1,24 @@
+[BITS 32]
+
+; void context_switch(usize_ptr* prev_sp, usize_ptr next_sp)
+; only the cdecl callee-saved registers need saving, eflags (IF) is
+; saved/restored by the scheduler around the call
+section .text
+global context_switch
+context_switch:
+    push ebp
+    push ebx
+    push esi
+    push edi
+
+    mov eax, [esp + 20]  ; prev_sp, 4 pushes + return address
+    mov edx, [esp + 24]  ; next_sp
+
+    mov [eax], esp
+    mov esp, edx
+
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
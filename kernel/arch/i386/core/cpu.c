@@ -1,6 +1,7 @@
 #include <kernel/core/cpu.h>
 #include <arch/i386/interrupts/irq.h>
 #include <arch/i386/drivers/pic/pic.h>
+#include <arch/i386/core/tsc.h>
 
 void cpu_halt()
 {
@@ -19,6 +20,24 @@ void cpu_relax()
     );
 }
 
+void cpu_idle()
+{
+    // sti only takes effect after the next instruction, so no irq
+    // can be taken between the two
+    asm volatile(
+        "sti\n\t"
+        "hlt\n\t"
+        :
+        :
+        : "memory"
+    );
+}
+
+u64 cpu_cycles()
+{
+    return rdtsc();
+}
+
 static inline void enable_wp(void) 
 {
     u32 cr0;
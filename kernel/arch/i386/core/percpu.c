@@ -0,0 +1,50 @@
+#include <kernel/core/percpu.h>
+#include <kernel/core/cpu.h>
+#include <kernel/memory/paging.h>
+#include <memory/virt/virt_alloc.h>
+#include <string.h>
+
+extern u8 __percpu_start[];
+extern u8 __percpu_end[];
+
+DEFINE_PER_CPU(usize_ptr, percpu_offset);
+DEFINE_PER_CPU(u32, percpu_cpu_id);
+
+// the BSP's copy is the template, offset 0
+static usize_ptr offsets[MAX_CPUS];
+
+bool percpu_setup_cpu(u32 cpu)
+{
+    assert(cpu != 0 && cpu < MAX_CPUS);
+
+    usize_ptr size = __percpu_end - __percpu_start;
+    usize_ptr pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    u8* copy = kvalloc_pages(pages, VREGION_PERCPU);
+    if (copy == NULL)
+    {
+        return false;
+    }
+
+    memset(copy, 0, pages * PAGE_SIZE);
+
+    usize_ptr offset = (usize_ptr)(copy - __percpu_start);
+    offsets[cpu] = offset;
+
+    *per_cpu_ptr(percpu_offset, cpu) = offset;
+    *per_cpu_ptr(percpu_cpu_id, cpu) = cpu;
+
+    return true;
+}
+
+usize_ptr percpu_offset_of(u32 cpu)
+{
+    assert(cpu < MAX_CPUS);
+
+    return offsets[cpu];
+}
+
+u32 cpu_id()
+{
+    return this_cpu_read(percpu_cpu_id);
+}
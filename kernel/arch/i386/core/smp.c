@@ -0,0 +1,267 @@
+#include <arch/i386/core/smp.h>
+#include <arch/i386/core/cpuid.h>
+#include <arch/i386/core/percpu.h>
+#include <arch/i386/drivers/apic/ioapic.h>
+#include <arch/i386/drivers/apic/lapic.h>
+#include <arch/i386/drivers/apic/lapic_timer.h>
+#include <arch/i386/interrupts/irq.h>
+#include <firmware/acpi/madt.h>
+#include <kernel/core/cpu.h>
+#include <kernel/core/percpu.h>
+#include <kernel/devices/clock.h>
+#include <kernel/devices/int_timer.h>
+#include <kernel/interrupts/irq.h>
+#include <memory/virt/virt_alloc.h>
+#include <services/threads/sched.h>
+#include <services/time/timer.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+// INIT-SIPI-SIPI timing from the MP spec
+#define SMP_INIT_DELAY_NS     10000000ULL
+#define SMP_SIPI_DELAY_NS     200000ULL
+#define SMP_ONLINE_TIMEOUT_NS 100000000ULL
+#define SMP_ONLINE_POLL_NS    100000ULL
+
+extern u8 smp_trampoline_start[];
+extern u8 smp_trampoline_params[];
+extern u8 smp_trampoline_end[];
+
+// the boot CPU counts as online from the start
+static cpu_t cpus[MAX_CPUS] = { [0] = { .index = 0, .online = true } };
+static u32 cpu_slots = 1;
+static u32 cpu_count = 1;
+
+// only ap_entry needs it, cpu_id() reads the per CPU area
+static u8 apic_to_index[256];
+
+static irq_action_t resched_action;
+
+// flat 4 GiB data segment starting at base, wraps past 4 GiB like the
+// offsets it holds
+static void set_percpu_segment(gdt_entry_t* entry, u32 base)
+{
+    const u16 flags = GDT_DATA_PL0;
+
+    entry->limit_low   = 0xFFFF;
+    entry->granularity = 0x0F | ((flags >> 8) & 0xF0);
+
+    entry->base_low    = base & 0xFFFF;
+    entry->base_middle = (base >> 16) & 0xFF;
+    entry->base_high   = (base >> 24) & 0xFF;
+
+    entry->access      = flags & 0xFF;
+}
+
+static void load_cpu_gdt(cpu_t* cpu)
+{
+    memcpy(cpu->gdt, gdt_entries, sizeof(gdt_entries));
+    set_percpu_segment(&cpu->gdt[SMP_GDT_PERCPU], percpu_offset_of(cpu->index));
+
+    gdt_description_t gdtr;
+    gdtr.offset = (u32)cpu->gdt;
+    gdtr.limit = sizeof(cpu->gdt) - 1;
+
+    // same selectors as the boot GDT, GS moves to the per CPU segment
+    asm volatile (
+        "lgdt (%0)\n\t"
+        "ljmp $0x08, $1f\n\t"
+        "1:\n\t"
+        "movw $0x10, %%ax\n\t"
+        "movw %%ax, %%ds\n\t"
+        "movw %%ax, %%es\n\t"
+        "movw %%ax, %%fs\n\t"
+        "movw %%ax, %%ss\n\t"
+        "movw %1, %%ax\n\t"
+        "movw %%ax, %%gs\n\t"
+        :
+        : "r" (&gdtr), "i" (GDT_SELECTOR_PERCPU)
+        : "memory", "eax"
+    );
+}
+
+static bool resched_ipi(irq_frame_t* frame, void* ctx)
+{
+    (void)frame;
+    (void)ctx;
+
+    // the irq core's exit path does the actual switch
+    sched_request_resched();
+
+    return true;
+}
+
+// first C code of an AP, on the stack the BSP gave it. GS still has the
+// flat boot segment, so cpu_id() reads the BSP's 0 until load_cpu_gdt.
+__attribute__((noreturn)) static void ap_entry()
+{
+    cpu_t* cpu = &cpus[apic_to_index[lapic_id()]];
+
+    load_cpu_gdt(cpu);
+    irq_init_cpu();
+    lapic_enable();
+
+    int_timer_init_cpu();
+    ktimer_init_cpu();
+
+    sched_init_cpu();
+
+    atomic_store(&cpu->online, true);
+
+    sched_idle();
+}
+
+static bool start_ap(cpu_t* cpu)
+{
+    if (percpu_setup_cpu(cpu->index) == false)
+    {
+        return false;
+    }
+
+    cpu->stack = kvalloc_pages(SMP_AP_STACK_PAGES, VREGION_STACK);
+    if (cpu->stack == NULL)
+    {
+        return false;
+    }
+
+    u32 cr3;
+    asm volatile ("mov %%cr3, %0" : "=r"(cr3));
+
+    smp_trampoline_params_t* params = (smp_trampoline_params_t*)(
+        SMP_TRAMPOLINE_BASE + (smp_trampoline_params - smp_trampoline_start)
+    );
+    params->cr3 = cr3;
+    params->stack_top = (u32)cpu->stack + SMP_AP_STACK_PAGES * PAGE_SIZE;
+    params->entry = (u32)ap_entry;
+
+    lapic_send_init(cpu->apic_id);
+    clock_spin_delay_ns(SMP_INIT_DELAY_NS);
+
+    lapic_send_startup(cpu->apic_id, SMP_TRAMPOLINE_BASE >> 12);
+    clock_spin_delay_ns(SMP_SIPI_DELAY_NS);
+
+    // a second SIPI only if the first one was lost
+    if (atomic_load(&cpu->online) == false)
+    {
+        lapic_send_startup(cpu->apic_id, SMP_TRAMPOLINE_BASE >> 12);
+    }
+
+    for (u64 waited = 0; waited < SMP_ONLINE_TIMEOUT_NS; waited += SMP_ONLINE_POLL_NS)
+    {
+        if (atomic_load(&cpu->online))
+        {
+            return true;
+        }
+
+        clock_spin_delay_ns(SMP_ONLINE_POLL_NS);
+    }
+
+    // the AP may still wake up on this stack later, so it is not freed
+    return atomic_load(&cpu->online);
+}
+
+void init_smp()
+{
+    cpu_t* bsp = &cpus[0];
+    bsp->apic_id = cpuid(1, 0).ebx >> 24;
+
+    const madt_info_t* madt = madt_get_info();
+    if (madt->present == false || init_lapic(madt->lapic_address) == false)
+    {
+        printf("smp: no local APIC, staying on the boot CPU\n");
+        return;
+    }
+
+    bsp->apic_id = lapic_id();
+
+    load_cpu_gdt(bsp);
+    lapic_enable();
+
+    // legacy lines move off the 8259, it can't deliver to the APs
+    if (init_ioapic() == false)
+    {
+        printf("smp: no IO APIC, device interrupts stay on the boot CPU\n");
+    }
+
+    // a tick per CPU, the PIT only reaches the boot CPU
+    if (init_int_timer_local())
+    {
+        ktimer_init_cpu();
+        printf("smp: LAPIC timer at %llu Hz\n", lapic_timer_hz());
+    }
+
+    irq_request(LAPIC_VECTOR_RESCHED, &resched_action, resched_ipi, NULL, "resched");
+
+    memcpy(
+        (void*)SMP_TRAMPOLINE_BASE,
+        smp_trampoline_start,
+        smp_trampoline_end - smp_trampoline_start
+    );
+
+    for (u32 i = 0; i < madt->cpu_count; i++)
+    {
+        const madt_cpu_t* entry = &madt->cpus[i];
+        if (entry->apic_id == bsp->apic_id)
+        {
+            bsp->acpi_id = entry->acpi_id;
+            continue;
+        }
+
+        if (cpu_slots == MAX_CPUS)
+        {
+            break;
+        }
+
+        // a slot is never reused, a late AP may still show up in it
+        cpu_t* cpu = &cpus[cpu_slots];
+        cpu->index = cpu_slots++;
+        cpu->apic_id = entry->apic_id;
+        cpu->acpi_id = entry->acpi_id;
+        cpu->online = false;
+
+        apic_to_index[cpu->apic_id] = cpu->index;
+
+        if (start_ap(cpu) == false)
+        {
+            printf("smp: CPU with APIC id %u did not come up\n", cpu->apic_id);
+            continue;
+        }
+
+        cpu_count++;
+    }
+
+    printf("smp: %u of %u CPUs online\n", cpu_count, madt->cpu_count);
+}
+
+u32 smp_cpu_count()
+{
+    return cpu_count;
+}
+
+bool smp_cpu_online(u32 cpu)
+{
+    return cpu < MAX_CPUS && atomic_load_explicit(&cpus[cpu].online, memory_order_acquire);
+}
+
+void smp_send_reschedule(u32 cpu)
+{
+    if (cpu == cpu_id() || smp_cpu_online(cpu) == false)
+    {
+        return;
+    }
+
+    lapic_send_ipi(cpus[cpu].apic_id, LAPIC_VECTOR_RESCHED);
+}
+
+cpu_t* smp_get_cpu(u32 index)
+{
+    assert(index < MAX_CPUS);
+
+    return &cpus[index];
+}
+
+cpu_t* this_cpu()
+{
+    return &cpus[cpu_id()];
+}
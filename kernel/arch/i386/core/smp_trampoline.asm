@@ -0,0 +1,85 @@
+[BITS 16]
+
+; Real mode entry of the application processors. init_smp copies the blob
+; to SMP_TRAMPOLINE_BASE and fills the parameter block at its end, so every
+; absolute address in here is taken relative to the copy, not the link
+; address.
+
+%define SMP_TRAMPOLINE_BASE 0x8000
+%define TRAMPOLINE(label) (SMP_TRAMPOLINE_BASE + (label) - smp_trampoline_start)
+
+%define CR0_PE 0x00000001
+%define CR0_WP 0x00010000
+%define CR0_PG 0x80000000
+
+section .rodata
+align 16
+
+global smp_trampoline_start
+global smp_trampoline_params
+global smp_trampoline_end
+
+smp_trampoline_start:
+    cli
+    cld
+
+    ; SIPI leaves CS = base >> 4, IP = 0, data goes through segment 0
+    xor ax, ax
+    mov ds, ax
+
+    lgdt [TRAMPOLINE(trampoline_gdtr)]
+
+    mov eax, cr0
+    or eax, CR0_PE
+    mov cr0, eax
+
+    jmp dword 0x08:TRAMPOLINE(trampoline_protected)
+
+[BITS 32]
+trampoline_protected:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ; the BSP's page directory, it still identity maps the low 4 MiB
+    mov eax, [TRAMPOLINE(smp_trampoline_params) + 0]
+    mov cr3, eax
+
+    mov eax, cr0
+    or eax, CR0_PG | CR0_WP
+    mov cr0, eax
+
+    mov esp, [TRAMPOLINE(smp_trampoline_params) + 4]
+    xor ebp, ebp
+
+    ; high half C entry, never returns
+    mov eax, [TRAMPOLINE(smp_trampoline_params) + 8]
+    call eax
+
+.hang:
+    cli
+    hlt
+    jmp .hang
+
+; flat code/data, replaced by the per CPU GDT once in C
+align 8
+trampoline_gdt:
+    dq 0
+    dq 0x00CF9A000000FFFF
+    dq 0x00CF92000000FFFF
+trampoline_gdt_end:
+
+trampoline_gdtr:
+    dw trampoline_gdt_end - trampoline_gdt - 1
+    dd TRAMPOLINE(trampoline_gdt)
+
+; smp_trampoline_params_t
+align 4
+smp_trampoline_params:
+    dd 0 ; cr3
+    dd 0 ; stack_top
+    dd 0 ; entry
+smp_trampoline_end:
@@ -0,0 +1,209 @@
+#include <kernel/devices/clock.h>
+#include <kernel/devices/int_timer.h>
+#include <kernel/interrupts/irq.h>
+#include <kernel/core/cpu.h>
+
+#include <arch/i386/core/cpuid.h>
+#include <arch/i386/core/tsc.h>
+#include <firmware/acpi/acpi.h>
+#include <services/threads/locks/spinlock.h>
+
+#include <core/defs.h>
+
+#define NS_PER_SEC 1000000000ULL
+
+// 50ms worth of PM timer ticks
+#define CLOCK_CALIBRATE_PM_TICKS (ACPI_PM_TIMER_HZ / 20)
+
+typedef struct clock_state
+{
+    clock_source_type_t type;
+
+    // raw counter value at init
+    u64 base_cycles;
+
+    // ns = (cycles * mult) >> shift
+    u32 mult;
+    u32 shift;
+
+    u64 tsc_hz;
+
+    // PM timer is only 24/32 bits wide, extended to 64 bits here
+    spinlock_t pm_lock;
+    u32 pm_last_raw;
+    u64 pm_cycles;
+    u32 pm_mask;
+} clock_state_t;
+
+static clock_state_t clock;
+
+static const char* clock_source_names[] =
+{
+    [CLOCK_SOURCE_NONE]    = "none",
+    [CLOCK_SOURCE_TSC]     = "tsc",
+    [CLOCK_SOURCE_ACPI_PM] = "acpi_pm",
+    [CLOCK_SOURCE_PIT]     = "pit",
+};
+
+// largest shift whose mult still fits 32 bits, keeps the most precision
+static void calc_mult_shift(u64 hz, u32* mult, u32* shift)
+{
+    for (u32 s = 32; s > 0; s--)
+    {
+        u64 m = ((NS_PER_SEC << s) + hz / 2) / hz;
+
+        if (m <= 0xFFFFFFFF)
+        {
+            *mult = (u32)m;
+            *shift = s;
+            return;
+        }
+    }
+
+    *mult = (u32)(NS_PER_SEC / hz);
+    *shift = 0;
+}
+
+static u64 pm_read_cycles()
+{
+    spinlock_lock(&clock.pm_lock);
+
+    u32 raw = (u32)get_acpi_time() & clock.pm_mask;
+    clock.pm_cycles += (raw - clock.pm_last_raw) & clock.pm_mask;
+    clock.pm_last_raw = raw;
+
+    u64 cycles = clock.pm_cycles;
+
+    spinlock_unlock(&clock.pm_lock);
+
+    return cycles;
+}
+
+static void pm_init()
+{
+    spinlock_initlock(&clock.pm_lock, false);
+
+    clock.pm_mask = acpi_timer_mask();
+    clock.pm_last_raw = (u32)get_acpi_time() & clock.pm_mask;
+    clock.pm_cycles = 0;
+}
+
+static u64 read_cycles()
+{
+    switch (clock.type)
+    {
+        case CLOCK_SOURCE_TSC:
+            return rdtsc();
+
+        case CLOCK_SOURCE_ACPI_PM:
+            return pm_read_cycles();
+
+        case CLOCK_SOURCE_PIT:
+            return int_timer_now_ns();
+
+        default:
+            return 0;
+    }
+}
+
+// counts TSC cycles across a fixed number of PM timer ticks
+static u64 calibrate_tsc()
+{
+    usize_ptr irq_flags = irq_save();
+
+    // align to a PM edge so the window starts on a fresh count
+    u64 edge = pm_read_cycles();
+    while (pm_read_cycles() == edge)
+    {
+        cpu_relax();
+    }
+
+    u64 pm_start = pm_read_cycles();
+    u64 tsc_start = rdtsc();
+
+    u64 pm_end;
+    do
+    {
+        pm_end = pm_read_cycles();
+    } while (pm_end - pm_start < CLOCK_CALIBRATE_PM_TICKS);
+
+    u64 tsc_end = rdtsc();
+
+    irq_restore(irq_flags);
+
+    return ((tsc_end - tsc_start) * ACPI_PM_TIMER_HZ) / (pm_end - pm_start);
+}
+
+static void use_source(clock_source_type_t type, u64 hz)
+{
+    clock.type = type;
+    calc_mult_shift(hz, &clock.mult, &clock.shift);
+    clock.base_cycles = read_cycles();
+}
+
+void init_clock()
+{
+    clock.type = CLOCK_SOURCE_NONE;
+
+    if (acpi_timer_present())
+    {
+        pm_init();
+
+        if (cpuid_has_tsc() && cpuid_has_invariant_tsc())
+        {
+            clock.tsc_hz = calibrate_tsc();
+
+            if (clock.tsc_hz)
+            {
+                use_source(CLOCK_SOURCE_TSC, clock.tsc_hz);
+                return;
+            }
+        }
+
+        use_source(CLOCK_SOURCE_ACPI_PM, ACPI_PM_TIMER_HZ);
+        return;
+    }
+
+    // PIT source already reports ns, identity conversion
+    clock.type = CLOCK_SOURCE_PIT;
+    clock.mult = 1;
+    clock.shift = 0;
+    clock.base_cycles = read_cycles();
+}
+
+u64 clock_monotonic_ns()
+{
+    if (clock.type == CLOCK_SOURCE_NONE)
+    {
+        return 0;
+    }
+
+    u64 delta = read_cycles() - clock.base_cycles;
+
+    return mul_u64_u32_shr(delta, clock.mult, clock.shift);
+}
+
+clock_source_type_t clock_source()
+{
+    return clock.type;
+}
+
+const char* clock_source_name()
+{
+    return clock_source_names[clock.type];
+}
+
+u64 clock_tsc_hz()
+{
+    return clock.type == CLOCK_SOURCE_TSC ? clock.tsc_hz : 0;
+}
+
+void clock_spin_delay_ns(u64 ns)
+{
+    u64 start = clock_monotonic_ns();
+
+    while (clock_monotonic_ns() - start < ns)
+    {
+        cpu_relax();
+    }
+}
@@ -1,15 +1,130 @@
 #include <kernel/devices/int_timer.h>
 
+#include <kernel/devices/clock.h>
+#include <services/time/timer.h>
 #include <arch/i386/drivers/pic/pit.h>
+#include <arch/i386/drivers/apic/lapic_timer.h>
 
-void init_int_timer(const u64 hz, int_timer_callback_t callback)
-{
-    load_pit(hz);
+#define NS_PER_SEC 1000000000ULL
+
+static irq_action_t pit_action;
+
+static int_timer_handler_t timer_handler;
+// the PIT until init_int_timer_local() switched every CPU to its LAPIC
+static bool use_lapic;
+
+static ktimer_t periodic_timer;
+static int_timer_callback_t periodic_callback;
+static u64 periodic_ticks;
+static u32 periodic_hz;
 
-    pit_update_callback(callback);
+void init_int_timer_device()
+{
+    load_pit();
 
-    irq_register_handler(
+    irq_request(
         IRQ_TIMER_VEC, 
-        pit_timer_dispatch
+        &pit_action,
+        pit_timer_dispatch,
+        NULL,
+        "pit"
     );
-}
\ No newline at end of file
+}
+
+bool init_int_timer_local()
+{
+    // the PIT doubles as the clock then, it has to keep running
+    if (clock_source() == CLOCK_SOURCE_PIT || init_lapic_timer() == false)
+    {
+        return false;
+    }
+
+    lapic_timer_set_handler(timer_handler);
+    lapic_timer_init_cpu(LAPIC_TIMER_ONESHOT);
+
+    usize_ptr irq_flags = irq_save();
+
+    use_lapic = true;
+    irq_release(IRQ_TIMER_VEC, &pit_action);
+    pit_set_handler(NULL);
+
+    irq_restore(irq_flags);
+
+    return true;
+}
+
+void int_timer_init_cpu()
+{
+    if (use_lapic)
+    {
+        lapic_timer_init_cpu(LAPIC_TIMER_ONESHOT);
+    }
+}
+
+bool int_timer_per_cpu()
+{
+    return use_lapic;
+}
+
+void int_timer_set_handler(int_timer_handler_t handler)
+{
+    timer_handler = handler;
+
+    pit_set_handler(handler);
+    lapic_timer_set_handler(handler);
+}
+
+void int_timer_program_ns(u64 delta_ns)
+{
+    if (use_lapic)
+    {
+        lapic_timer_program_ns(delta_ns);
+        return;
+    }
+
+    pit_program_ns(delta_ns);
+}
+
+u64 int_timer_max_delta_ns()
+{
+    if (use_lapic)
+    {
+        return lapic_timer_max_delta_ns();
+    }
+
+    return pit_max_delta_ns();
+}
+
+static void periodic_fire(ktimer_t* timer, void* ctx)
+{
+    (void)timer;
+    (void)ctx;
+
+    periodic_ticks++;
+
+    int_timer_event_t event = {
+        .timestamp_ns = clock_monotonic_ns(),
+        .tick_count = periodic_ticks,
+        .frequency_hz = periodic_hz,
+    };
+
+    periodic_callback(event);
+}
+
+void init_int_timer(const u64 hz, int_timer_callback_t callback)
+{
+    assert(callback);
+    assert(hz != 0 && hz <= NS_PER_SEC);
+
+    periodic_callback = callback;
+    periodic_hz = (u32)hz;
+    periodic_ticks = 0;
+
+    ktimer_init(&periodic_timer, periodic_fire, NULL);
+    ktimer_start_periodic(&periodic_timer, NS_PER_SEC / hz);
+}
+
+u64 int_timer_now_ns()
+{
+    return pit_now_ns();
+}
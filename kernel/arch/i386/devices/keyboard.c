@@ -3,18 +3,21 @@
 #include <kernel/devices/keyboard.h>
 #include "core/assert.h"
 
+static irq_action_t ps2_action;
+
 void init_keyboard(key_event_cb_t callback)
 {
     assert(callback);
 
     ps2_init();
 
-    irq_register_handler(
+    key_event_callback = callback;
+
+    irq_request(
         PS2_IRQ_VECTOR,
-        ps2_key_dispatch
+        &ps2_action,
+        ps2_key_dispatch,
+        NULL,
+        "ps2_key"
     );
-
-    pic_unmask_vector(PS2_IRQ_VECTOR);
-
-    key_event_callback = callback;
 }
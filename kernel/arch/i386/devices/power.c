@@ -0,0 +1,30 @@
+#include <arch/i386/drivers/io/io.h>
+#include <kernel/core/cpu.h>
+#include <kernel/devices/power.h>
+#include <kernel/devices/serial.h>
+#include <kernel/interrupts/irq.h>
+
+#define DEBUG_EXIT_PORT 0xF4
+
+// PM1a control blocks of QEMU's and Bochs' fixed ACPI tables,
+// SLP_EN with the S5 sleep type they report
+#define QEMU_PM1A_CNT_PORT  0x604
+#define BOCHS_PM1A_CNT_PORT 0xB004
+#define PM1_SLP_S5          0x2000
+
+void power_off(u8 exit_code)
+{
+    serial_flush();
+
+    irq_disable();
+
+    outl(DEBUG_EXIT_PORT, exit_code);
+
+    outw(QEMU_PM1A_CNT_PORT, PM1_SLP_S5);
+    outw(BOCHS_PM1A_CNT_PORT, PM1_SLP_S5);
+
+    while (true)
+    {
+        cpu_halt();
+    }
+}
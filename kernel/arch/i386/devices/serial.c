@@ -0,0 +1,41 @@
+#include <kernel/devices/serial.h>
+
+#include <arch/i386/drivers/serial/uart.h>
+
+static bool serial_ready;
+static irq_action_t uart_action;
+
+bool init_serial(u32 baud)
+{
+    serial_ready = uart_init(UART_COM1_PORT, baud);
+
+    if (serial_ready == false)
+    {
+        return false;
+    }
+
+    irq_request(
+        UART_COM1_IRQ_VECTOR,
+        &uart_action,
+        uart_dispatch,
+        NULL,
+        "uart"
+    );
+
+    return true;
+}
+
+bool serial_present()
+{
+    return serial_ready;
+}
+
+void serial_write(const char* data, usize_ptr size)
+{
+    uart_write(data, size);
+}
+
+void serial_flush()
+{
+    uart_flush();
+}
@@ -0,0 +1,253 @@
+#include <arch/i386/drivers/apic/ioapic.h>
+#include <arch/i386/drivers/apic/lapic.h>
+#include <arch/i386/drivers/pic/pic.h>
+#include <arch/i386/core/smp.h>
+#include <arch/i386/memory/paging_utils.h>
+#include <firmware/acpi/madt.h>
+#include <kernel/interrupts/irq.h>
+#include <kernel/memory/paging.h>
+#include <memory/virt/virt_region.h>
+#include <services/threads/locks/spinlock.h>
+
+typedef struct ioapic
+{
+    volatile u32* base;
+    u32 gsi_base;
+    u32 entries;
+
+    // select + window is a two step access
+    spinlock_t lock;
+} ioapic_t;
+
+// one per ISA IRQ, indexed by vector - PIC_IRQ_OFFSET
+typedef struct ioapic_route
+{
+    ioapic_t* ioapic;
+    u32 pin;
+    // low half without the mask bit, mask/unmask toggle it
+    u32 redir_low;
+    bool masked;
+    u8 dest_apic_id;
+} ioapic_route_t;
+
+static ioapic_t ioapics[MADT_MAX_IOAPICS];
+static u32 ioapic_count;
+
+static ioapic_route_t routes[MADT_ISA_IRQS];
+
+static u32 ioapic_read(ioapic_t* ioapic, u32 reg)
+{
+    ioapic->base[IOAPIC_REG_SELECT / sizeof(u32)] = reg;
+    return ioapic->base[IOAPIC_REG_WINDOW / sizeof(u32)];
+}
+
+static void ioapic_write(ioapic_t* ioapic, u32 reg, u32 value)
+{
+    ioapic->base[IOAPIC_REG_SELECT / sizeof(u32)] = reg;
+    ioapic->base[IOAPIC_REG_WINDOW / sizeof(u32)] = value;
+}
+
+static ioapic_t* ioapic_for_gsi(u32 gsi)
+{
+    for (u32 i = 0; i < ioapic_count; i++)
+    {
+        if (gsi >= ioapics[i].gsi_base && gsi < ioapics[i].gsi_base + ioapics[i].entries)
+        {
+            return &ioapics[i];
+        }
+    }
+
+    return NULL;
+}
+
+static ioapic_route_t* vector_route(u32 vector)
+{
+    if (vector < PIC_IRQ_OFFSET || vector >= PIC_IRQ_OFFSET + MADT_ISA_IRQS)
+    {
+        return NULL;
+    }
+
+    ioapic_route_t* route = &routes[vector - PIC_IRQ_OFFSET];
+
+    return route->ioapic ? route : NULL;
+}
+
+// high half first, the entry may be live while the low half is written
+static void route_write(ioapic_route_t* route, bool masked)
+{
+    u32 reg = IOAPIC_REDIR_BASE + route->pin * 2;
+    u32 low = route->redir_low | (masked ? IOAPIC_REDIR_MASKED : 0);
+
+    spinlock_lock(&route->ioapic->lock);
+
+    route->masked = masked;
+
+    ioapic_write(route->ioapic, reg + 1, (u32)route->dest_apic_id << 24);
+    ioapic_write(route->ioapic, reg, low);
+
+    spinlock_unlock(&route->ioapic->lock);
+}
+
+static void ioapic_chip_mask(u32 vector)
+{
+    ioapic_route_t* route = vector_route(vector);
+    if (route)
+    {
+        route_write(route, true);
+    }
+}
+
+static void ioapic_chip_unmask(u32 vector)
+{
+    ioapic_route_t* route = vector_route(vector);
+    if (route)
+    {
+        route_write(route, false);
+    }
+}
+
+static void ioapic_chip_eoi(u32 vector)
+{
+    (void)vector;
+
+    // level entries are cleared by the LAPIC broadcasting the EOI
+    lapic_eoi();
+}
+
+static bool ioapic_chip_set_affinity(u32 vector, u32 cpu)
+{
+    return ioapic_set_affinity(vector, cpu);
+}
+
+static irq_chip_t ioapic_chip = {
+    .name         = "ioapic",
+    .mask         = ioapic_chip_mask,
+    .unmask       = ioapic_chip_unmask,
+    .eoi          = ioapic_chip_eoi,
+    .spurious     = NULL,
+    .set_affinity = ioapic_chip_set_affinity,
+};
+
+// an ISA IRQ whose GSI was overridden onto another ISA IRQ is not wired
+// (IRQ 2 usually, the PIT sits on GSI 2)
+static bool isa_irq_shadowed(u8 isa_irq, u32 gsi)
+{
+    const madt_info_t* madt = madt_get_info();
+
+    for (u32 i = 0; i < madt->override_count; i++)
+    {
+        const madt_override_t* override = &madt->overrides[i];
+        if (override->gsi == gsi && override->source != isa_irq)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static u32 redir_flags(u16 mps_flags)
+{
+    u32 flags = 0;
+
+    // ISA defaults (conforming) are active high, edge triggered
+    if ((mps_flags & MADT_ISO_POLARITY_MASK) == MADT_ISO_POLARITY_LOW)
+    {
+        flags |= IOAPIC_REDIR_ACTIVE_LOW;
+    }
+    if ((mps_flags & MADT_ISO_TRIGGER_MASK) == MADT_ISO_TRIGGER_LEVEL)
+    {
+        flags |= IOAPIC_REDIR_LEVEL;
+    }
+
+    return flags;
+}
+
+bool init_ioapic()
+{
+    const madt_info_t* madt = madt_get_info();
+    if (madt->ioapic_count == 0 || lapic_present() == false)
+    {
+        return false;
+    }
+
+    for (u32 i = 0; i < madt->ioapic_count; i++)
+    {
+        const madt_ioapic_info_t* info = &madt->ioapics[i];
+        ioapic_t* ioapic = &ioapics[ioapic_count++];
+
+        kvregion_mark((void*)info->address, 1, VREGION_MMIO, "IOAPIC");
+        paging_map_identity(
+            info->address, 1,
+            PAGING_FLAG_READ | PAGING_FLAG_WRITE | PAGING_FLAG_NOEXEC
+        );
+
+        ioapic->base = (volatile u32*)info->address;
+        ioapic->gsi_base = info->gsi_base;
+        spinlock_initlock(&ioapic->lock, false);
+
+        // version bits 23:16 hold the last entry index
+        ioapic->entries = ((ioapic_read(ioapic, IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+
+        // start from a quiet table, firmware may have left entries live
+        for (u32 pin = 0; pin < ioapic->entries; pin++)
+        {
+            ioapic_write(ioapic, IOAPIC_REDIR_BASE + pin * 2, IOAPIC_REDIR_MASKED);
+        }
+    }
+
+    u8 bsp_apic_id = smp_get_cpu(0)->apic_id;
+
+    for (u8 isa_irq = 0; isa_irq < MADT_ISA_IRQS; isa_irq++)
+    {
+        u16 mps_flags;
+        u32 gsi = madt_isa_to_gsi(isa_irq, &mps_flags);
+
+        ioapic_t* ioapic = ioapic_for_gsi(gsi);
+        if (ioapic == NULL || isa_irq_shadowed(isa_irq, gsi))
+        {
+            continue;
+        }
+
+        ioapic_route_t* route = &routes[isa_irq];
+        route->ioapic = ioapic;
+        route->pin = gsi - ioapic->gsi_base;
+        route->redir_low = (PIC_IRQ_OFFSET + isa_irq) | redir_flags(mps_flags);
+        route->dest_apic_id = bsp_apic_id;
+
+        route_write(route, true);
+    }
+
+    // the 8259 stays remapped so a stray interrupt lands on a known vector
+    pic_disable();
+
+    // moves the unmasked lines over, drivers requested them on the 8259
+    irq_set_chip(PIC_IRQ_OFFSET, MADT_ISA_IRQS, &ioapic_chip);
+
+    return true;
+}
+
+bool ioapic_present()
+{
+    return ioapic_count != 0;
+}
+
+bool ioapic_set_affinity(u32 vector, u32 cpu)
+{
+    ioapic_route_t* route = vector_route(vector);
+    if (route == NULL || smp_cpu_online(cpu) == false)
+    {
+        return false;
+    }
+
+    u8 apic_id = smp_get_cpu(cpu)->apic_id;
+    if (route->dest_apic_id == apic_id)
+    {
+        return true;
+    }
+
+    route->dest_apic_id = apic_id;
+    route_write(route, route->masked);
+
+    return true;
+}
@@ -0,0 +1,164 @@
+#include <arch/i386/drivers/apic/lapic.h>
+#include <arch/i386/core/cpuid.h>
+#include <arch/i386/core/msr.h>
+#include <arch/i386/memory/paging_utils.h>
+#include <kernel/core/cpu.h>
+#include <kernel/interrupts/irq.h>
+#include <kernel/memory/paging.h>
+#include <memory/virt/virt_region.h>
+
+#define LAPIC_SVR_ENABLE (1 << 8)
+
+#define LAPIC_ICR_INIT        (5 << 8)
+#define LAPIC_ICR_STARTUP     (6 << 8)
+#define LAPIC_ICR_PENDING     (1 << 12)
+#define LAPIC_ICR_ASSERT      (1 << 14)
+#define LAPIC_ICR_LEVEL       (1 << 15)
+
+static volatile u32* lapic_base;
+
+static irq_action_t lapic_error_action;
+static u32 lapic_error_count;
+
+u32 lapic_read(u32 reg)
+{
+    return lapic_base[reg / sizeof(u32)];
+}
+
+void lapic_write(u32 reg, u32 value)
+{
+    lapic_base[reg / sizeof(u32)] = value;
+}
+
+static void lapic_wait_icr()
+{
+    while (lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING)
+    {
+        cpu_relax();
+    }
+}
+
+static void lapic_send_icr(u8 apic_id, u32 command)
+{
+    // both halves from one CPU, an irq sending its own IPI can't interleave
+    usize_ptr irq_flags = irq_save();
+
+    lapic_wait_icr();
+    lapic_write(LAPIC_REG_ICR_HIGH, (u32)apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LOW, command);
+    lapic_wait_icr();
+
+    irq_restore(irq_flags);
+}
+
+static void lapic_chip_eoi(u32 vector)
+{
+    (void)vector;
+
+    lapic_eoi();
+}
+
+// the spurious vector is never in service, it must not get an EOI
+static bool lapic_chip_spurious(u32 vector)
+{
+    return vector == LAPIC_VECTOR_SPURIOUS;
+}
+
+static irq_chip_t lapic_chip = {
+    .name     = "lapic",
+    .mask     = NULL,
+    .unmask   = NULL,
+    .eoi      = lapic_chip_eoi,
+    .spurious = lapic_chip_spurious,
+};
+
+static bool lapic_error(irq_frame_t* frame, void* ctx)
+{
+    (void)frame;
+    (void)ctx;
+
+    // ESR latches on write
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_read(LAPIC_REG_ESR);
+
+    lapic_error_count++;
+
+    return true;
+}
+
+bool init_lapic(usize_ptr pa)
+{
+    if (cpuid_has_apic() == false)
+    {
+        return false;
+    }
+
+    u64 apic_base = rdmsr(MSR_APIC_BASE);
+    if ((apic_base & MSR_APIC_BASE_ENABLE) == 0)
+    {
+        wrmsr(MSR_APIC_BASE, apic_base | MSR_APIC_BASE_ENABLE);
+    }
+
+    pa &= MSR_APIC_BASE_MASK;
+
+    // identity mapped like the other firmware MMIO windows
+    kvregion_mark((void*)pa, 1, VREGION_MMIO, "LAPIC");
+    paging_map_identity(pa, 1, PAGING_FLAG_READ | PAGING_FLAG_WRITE | PAGING_FLAG_NOEXEC);
+
+    lapic_base = (volatile u32*)pa;
+
+    irq_set_chip(LAPIC_VECTOR_FIRST, 0x100 - LAPIC_VECTOR_FIRST, &lapic_chip);
+    irq_request(LAPIC_VECTOR_ERROR, &lapic_error_action, lapic_error, NULL, "lapic error");
+
+    return true;
+}
+
+bool lapic_present()
+{
+    return lapic_base != NULL;
+}
+
+void lapic_enable()
+{
+    // accept every priority class
+    lapic_write(LAPIC_REG_TPR, 0);
+
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_VECTOR_ERROR);
+
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_VECTOR_SPURIOUS);
+
+    // clear anything latched before the enable
+    lapic_write(LAPIC_REG_ESR, 0);
+    lapic_read(LAPIC_REG_ESR);
+
+    lapic_eoi();
+}
+
+u8 lapic_id()
+{
+    return lapic_read(LAPIC_REG_ID) >> 24;
+}
+
+void lapic_eoi()
+{
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+void lapic_send_init(u8 apic_id)
+{
+    lapic_send_icr(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT | LAPIC_ICR_LEVEL);
+
+    // deassert, required by pre-P4 parts and ignored by the rest
+    lapic_send_icr(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL);
+}
+
+void lapic_send_startup(u8 apic_id, u8 page)
+{
+    lapic_send_icr(apic_id, LAPIC_ICR_STARTUP | LAPIC_ICR_ASSERT | page);
+}
+
+void lapic_send_ipi(u8 apic_id, u8 vector)
+{
+    lapic_send_icr(apic_id, LAPIC_ICR_ASSERT | vector);
+}
@@ -0,0 +1,174 @@
+#include <arch/i386/drivers/apic/lapic_timer.h>
+#include <arch/i386/drivers/apic/lapic.h>
+#include <arch/i386/core/cpuid.h>
+#include <arch/i386/core/msr.h>
+#include <arch/i386/core/tsc.h>
+#include <kernel/core/cpu.h>
+#include <kernel/devices/clock.h>
+#include <kernel/interrupts/irq.h>
+
+#define NS_PER_SEC 1000000000ULL
+
+#define LAPIC_TIMER_CALIBRATE_NS 10000000ULL
+#define LAPIC_TIMER_MAX_COUNT    0xFFFFFFFFULL
+
+// keeps delta * tsc_hz inside 64 bits for any sane TSC rate
+#define LAPIC_TIMER_DEADLINE_MAX_NS NS_PER_SEC
+
+static u64 timer_hz;
+static u64 timer_max_delta_ns;
+static u64 tsc_hz;
+
+static lapic_timer_mode_t cpu_modes[MAX_CPUS];
+
+static void (*timer_handler)();
+static irq_action_t timer_action;
+
+static bool lapic_timer_irq(irq_frame_t* frame, void* ctx)
+{
+    (void)frame;
+    (void)ctx;
+
+    if (timer_handler)
+    {
+        timer_handler();
+    }
+
+    return true;
+}
+
+bool init_lapic_timer()
+{
+    if (lapic_present() == false)
+    {
+        return false;
+    }
+
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_VECTOR_TIMER);
+
+    // free running down count, masked so it can't fire midway
+    usize_ptr irq_flags = irq_save();
+
+    u64 start_ns = clock_monotonic_ns();
+    lapic_write(LAPIC_REG_TIMER_INIT, (u32)LAPIC_TIMER_MAX_COUNT);
+
+    clock_spin_delay_ns(LAPIC_TIMER_CALIBRATE_NS);
+
+    u32 remaining = lapic_read(LAPIC_REG_TIMER_CUR);
+    u64 elapsed_ns = clock_monotonic_ns() - start_ns;
+
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+
+    irq_restore(irq_flags);
+
+    u64 counts = LAPIC_TIMER_MAX_COUNT - remaining;
+    if (counts == 0 || elapsed_ns == 0)
+    {
+        return false;
+    }
+
+    timer_hz = counts * NS_PER_SEC / elapsed_ns;
+    timer_max_delta_ns = LAPIC_TIMER_MAX_COUNT * NS_PER_SEC / timer_hz;
+
+    // deadline mode counts in TSC cycles, only trusted if they're the clock
+    tsc_hz = cpuid_has_tsc_deadline() ? clock_tsc_hz() : 0;
+
+    irq_request(LAPIC_VECTOR_TIMER, &timer_action, lapic_timer_irq, NULL, "lapic timer");
+
+    return true;
+}
+
+bool lapic_timer_present()
+{
+    return timer_hz != 0;
+}
+
+void lapic_timer_init_cpu(lapic_timer_mode_t mode)
+{
+    assert(lapic_timer_present());
+
+    if (mode != LAPIC_TIMER_PERIODIC)
+    {
+        mode = tsc_hz ? LAPIC_TIMER_TSC_DEADLINE : LAPIC_TIMER_ONESHOT;
+    }
+
+    cpu_modes[cpu_id()] = mode;
+
+    u32 lvt = LAPIC_VECTOR_TIMER;
+    switch (mode)
+    {
+        case LAPIC_TIMER_PERIODIC:
+            lvt |= LAPIC_TIMER_LVT_PERIODIC;
+            break;
+
+        case LAPIC_TIMER_TSC_DEADLINE:
+            lvt |= LAPIC_TIMER_LVT_TSC_DEADLINE;
+            break;
+
+        default:
+            lvt |= LAPIC_TIMER_LVT_ONESHOT;
+            break;
+    }
+
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, lvt);
+
+    // the MMIO LVT write must land before any deadline MSR write
+    asm volatile ("mfence" ::: "memory");
+}
+
+lapic_timer_mode_t lapic_timer_mode()
+{
+    return cpu_modes[cpu_id()];
+}
+
+void lapic_timer_set_handler(void (*handler)())
+{
+    timer_handler = handler;
+}
+
+void lapic_timer_program_ns(u64 delta_ns)
+{
+    delta_ns = min(delta_ns, lapic_timer_max_delta_ns());
+
+    if (lapic_timer_mode() == LAPIC_TIMER_TSC_DEADLINE)
+    {
+        // 0 disarms, the earliest deadline is the next cycle
+        u64 cycles = max(delta_ns * tsc_hz / NS_PER_SEC, 1ULL);
+
+        wrmsr(MSR_TSC_DEADLINE, rdtsc() + cycles);
+        return;
+    }
+
+    // an initial count of 0 stops the timer
+    u64 counts = max(delta_ns * timer_hz / NS_PER_SEC, 1ULL);
+
+    lapic_write(LAPIC_REG_TIMER_INIT, (u32)counts);
+}
+
+void lapic_timer_stop()
+{
+    if (lapic_timer_mode() == LAPIC_TIMER_TSC_DEADLINE)
+    {
+        wrmsr(MSR_TSC_DEADLINE, 0);
+        return;
+    }
+
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+}
+
+u64 lapic_timer_max_delta_ns()
+{
+    if (lapic_timer_mode() == LAPIC_TIMER_TSC_DEADLINE)
+    {
+        return LAPIC_TIMER_DEADLINE_MAX_NS;
+    }
+
+    return timer_max_delta_ns;
+}
+
+u64 lapic_timer_hz()
+{
+    return timer_hz;
+}
@@ -11,7 +11,10 @@
 #include "core/num_defs.h"
 #include <stdio.h>
 #include <kernel/interrupts/irq.h>
+#include <kernel/core/cpu.h>
 #include <drivers/storage.h>
+#include <services/threads/softirq.h>
+#include <utils/data_structs/spsc_ring.h>
 
 #define INVALID_ID (~0)
 
@@ -24,6 +27,10 @@
 
 #define PCI_CMD_DMA_BIT (1 << 2)
 
+// finished requests waiting for the tasklet, one is in flight per
+// channel so this never fills
+#define IDE_DONE_RING_SIZE 4
+
 #define REG_OFF_DATA       0x00
 #define REG_OFF_ERROR      0x01
 #define REG_OFF_FEATURES   0x01
@@ -46,6 +53,11 @@ typedef struct ide_channel
     bool dma_io;         // is DMA IO or MMIO? True - IO, MMIO - False
     u32 irq;        // irq number
     bool pic_enabled;    // enabled PIC on this channel
+    irq_action_t irq_action;
+
+    // completions handed from the irq (producer) to the tasklet (consumer)
+    tasklet_t completion;
+    spsc_ring_t done;
 } ide_channel_t;
 
 enum ide_size_types {
@@ -112,6 +124,7 @@ typedef struct ide_request_item
 {
     stor_request_t* request;
     struct ide_request_item* prev;
+    i64 result;
 } ide_request_item_t;
 
 typedef struct ide_request_queue 
@@ -808,6 +821,9 @@ static void ide_submit(stor_request_t* request)
 
     ide_push_queue(request);
 
+    // complete on the submitting CPU, its caches hold the request
+    irq_set_affinity(ide.channels[dev->channel].irq, cpu_id());
+
     // The callback will queue the next task
     make_request(request);
 
@@ -815,77 +831,42 @@ static void ide_submit(stor_request_t* request)
 }
 
 
-static void primary_irq(irq_frame_t* irq_frame)
+// runs with interrupts enabled, the whole storage callback chain
+// (block layer, partitions, filesystem) hangs off this
+static void ide_complete(void* ctx)
 {
-    (void)irq_frame;
-
-    u16 channel = ATA_PRIMARY;
-    
-    ide_request_item_t* item = ide_pop_queue(channel);
+    ide_channel_t* channel = (ide_channel_t*)ctx;
 
-    if (!item) 
+    ide_request_item_t* item;
+    while ((item = spsc_ring_pop(&channel->done)))
     {
-        send_bm_cmd(channel, ATA_BM_CMD_STOP);
-        send_bm_status(channel, ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERR);
-    
-        pic_send_eoi_vector(ide.channels[channel].irq);
-    
-        return;
-    }
-
-    send_bm_cmd(channel, ATA_BM_CMD_STOP);
-    send_bm_status(channel, ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERR);
-
-    u32 bm_status = recv_bm_status(channel);
-    u16 drv_status = ide_get_status(channel);
+        if (item->request->callback)
+        {
+            item->request->callback(item->request, item->result);
+        }
 
-    int64_t result;
-    if ((bm_status & ATA_BM_STATUS_ERR) || (drv_status & ATA_STATUS_ERR)) 
-    {
-        result = -1;
-    }
-    else
-    {
-        result = 1;
+        kfree(item);
     }
-    
-    if (item->request->callback)
-    {
-        item->request->callback(item->request, result);
-    }
-    
-    if (ide.queue[channel].head)
-    {
-        make_request(ide.queue[channel].head->request);
-    }
-
-    kfree(item);
-    item = NULL;
-
-    pic_send_eoi_vector(ide.channels[channel].irq);
 }
 
-static void secondary_irq(irq_frame_t* irq_frame)
+// ctx carries the channel, both channels share this handler
+// only acks the hardware, completion is deferred to a tasklet
+static bool ide_irq(irq_frame_t* irq_frame, void* ctx)
 {
     (void)irq_frame;
-    
-    u16 channel = ATA_SECONDARY;
+
+    u16 channel = (u16)(usize_ptr)ctx;
 
     ide_request_item_t* item = ide_pop_queue(channel);
 
+    send_bm_cmd(channel, ATA_BM_CMD_STOP);
+    send_bm_status(channel, ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERR);
+
     if (!item) 
     {
-        send_bm_cmd(channel, ATA_BM_CMD_STOP);
-        send_bm_status(channel, ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERR);
-    
-        pic_send_eoi_vector(ide.channels[channel].irq);
-    
-        return;
+        return false;
     }
 
-    send_bm_cmd(channel, ATA_BM_CMD_STOP);
-    send_bm_status(channel, ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERR);
-
     u32 bm_status = recv_bm_status(channel);
     u16 drv_status = ide_get_status(channel);
 
@@ -899,17 +880,14 @@ static void secondary_irq(irq_frame_t* irq_frame)
         result = 1;
     }
 
-    item->request->callback(item->request, result);
+    item->result = result;
 
-    if (ide.queue[channel].head)
-    {
-        make_request(ide.queue[channel].head->request);
-    }
+    // one request in flight per channel, the ring always has room
+    assert(spsc_ring_push(&ide.channels[channel].done, item));
 
-    kfree(item);
-    item = NULL;
+    tasklet_schedule(&ide.channels[channel].completion);
 
-    pic_send_eoi_vector(ide.channels[channel].irq);
+    return true;
 }
 
 static void enable_pic()
@@ -931,12 +909,20 @@ static void enable_pic()
             send_bm_status(dev_channel, ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERR);
             (void)ide_get_status(dev_channel);
 
-            irq_register_handler(
-                ide.channels[dev_channel].irq,
-                dev_channel == ATA_PRIMARY ? primary_irq : secondary_irq
+            tasklet_init(
+                &ide.channels[dev_channel].completion,
+                ide_complete,
+                &ide.channels[dev_channel]
             );
+            spsc_ring_init(&ide.channels[dev_channel].done, IDE_DONE_RING_SIZE);
 
-            pic_unmask_vector(ide.channels[dev_channel].irq);
+            irq_request(
+                ide.channels[dev_channel].irq,
+                &ide.channels[dev_channel].irq_action,
+                ide_irq,
+                (void*)(usize_ptr)dev_channel,
+                dev_channel == ATA_PRIMARY ? "ide0" : "ide1"
+            );
 
             ide.channels[dev_channel].pic_enabled = true;
         }
@@ -125,6 +125,21 @@ static void pic_unmask_irq(u8 irq_line)
     irq_restore(irq_data);
 }
 
+static void pic_mask_irq(u8 irq_line)
+{
+    usize_ptr irq_data = irq_save();
+
+    u16 port = irq_line < 8 ? PIC1_DATA : PIC2_DATA;
+    u8 bit = irq_line < 8 ? irq_line : irq_line - 8;
+
+    io_wait();
+    u8 new_mask = inb(port) | (1u << bit);
+    io_wait();
+    outb(port, new_mask);
+
+    irq_restore(irq_data);
+}
+
 static inline int16_t vector_to_irq(u8 vector)
 {
     if (vector >= pic_master_base && vector < pic_master_base + 8)
@@ -144,6 +159,63 @@ void pic_unmask_vector(u8 vector)
     }
 }
 
+void pic_mask_vector(u8 vector)
+{
+    int16_t irq = vector_to_irq(vector);
+
+    if (irq >= 0) 
+    {
+        pic_mask_irq((u8)irq);
+    }
+}
+
+static void pic_chip_mask(u32 vector)
+{
+    pic_mask_vector((u8)vector);
+}
+
+static void pic_chip_unmask(u32 vector)
+{
+    pic_unmask_vector((u8)vector);
+}
+
+static void pic_chip_eoi(u32 vector)
+{
+    pic_send_eoi_vector((u8)vector);
+}
+
+// IRQ7/IRQ15 fire spuriously when the line drops before the ack,
+// the in-service bit is the only way to tell
+static bool pic_chip_spurious(u32 vector)
+{
+    int16_t irq = vector_to_irq((u8)vector);
+
+    if (irq != 7 && irq != 15)
+    {
+        return false;
+    }
+
+    if (pic_get_isr() & (1u << irq))
+    {
+        return false;
+    }
+
+    // the master did see a real cascade interrupt
+    if (irq == 15)
+    {
+        outb(PIC1, PIC_EOI);
+    }
+
+    return true;
+}
+
+static irq_chip_t pic_chip = {
+    .name = "8259",
+    .mask = pic_chip_mask,
+    .unmask = pic_chip_unmask,
+    .eoi = pic_chip_eoi,
+    .spurious = pic_chip_spurious,
+};
 
 void setup_pic()
 {
@@ -152,4 +224,12 @@ void setup_pic()
 	// make everything not usable
 	outb(PIC1_DATA, 0xFF ^ (1 << 2)); // only allow slave alerady
 	outb(PIC2_DATA, 0xFF);
+
+    irq_set_chip(PIC_IRQ_OFFSET, 16, &pic_chip);
+}
+
+void pic_disable()
+{
+	outb(PIC1_DATA, 0xFF);
+	outb(PIC2_DATA, 0xFF);
 }
\ No newline at end of file
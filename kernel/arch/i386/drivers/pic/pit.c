@@ -14,141 +14,126 @@
 // PIT constants
 #define PIT_INPUT_CLOCK 3579545
 #define PIT_DIVISOR     3
-#define MIN_PIT_HZ 18
-#define MAX_PIT_HZ 1193181
+#define PIT_BASE_HZ (PIT_INPUT_CLOCK / PIT_DIVISOR)
 
 // ports
 #define PIT_CHANNEL0    0x40
 #define PIT_COMMAND     0x43
 
+#define PIT_CMD_LATCH_CH0   0x00
+#define PIT_CMD_ONESHOT_CH0 0x30 // ch0, lobyte/hibyte, mode 0
+
+#define NS_PER_SEC 1000000000ULL
+
 // pit globals
-static u32 system_timer_ms_fractions = 0;
-static u32 system_timer_ms = 0;
-static u32 tick_ms_fractions = 0;
-static u32 tick_ms = 0;
-static u16 pit_reload_value = 0;
-static u32 pit_hz = 0;
-static u32 tick_count = 0;
-
-static inline u64 div_round(u64 num, u32 div) 
-{
-    u64 q = num / div;
-    u64 r = num % div;
-    
-    // round half up
-    if (r * 2 >= div) 
-        q++;
-    
-    return q;
-}
+// counts that passed before the last reprogramming
+static u64 pit_base_counts = 0;
+// count loaded by the last reprogramming
+static u16 pit_programmed = 0;
+static u64 last_now_ns = 0;
 
-static void compute_per_tick_time(u32 reload)
-{
-    // 64-bit product = reload * constant
-    // constant = (3000 * 2^42) / 3579545
-    u64 product = (u64)reload * (u64)0xDBB3A062;
+static void (*pit_handler)();
 
-    // divide by 2^10
-    product >>= 10;
+static u16 pit_read_count()
+{
+    outb(PIT_COMMAND, PIT_CMD_LATCH_CH0);
+    u8 low = inb(PIT_CHANNEL0);
+    u8 high = inb(PIT_CHANNEL0);
 
-    // split into 32.32 fixed point
-    tick_ms = (u32)(product >> 32);
-    tick_ms_fractions = (u32)(product & 0xFFFFFFFFu);
+    return ((u16)high << 8) | low;
 }
 
-static u32 compute_tick_frequency(u32 reload)
+// mode 0 keeps counting down (and wrapping) after terminal count,
+// so this holds for up to 65536 counts past the programming
+static inline u16 pit_elapsed_counts()
 {
-    u64 tmp = PIT_INPUT_CLOCK;
+    return (u16)(pit_programmed - pit_read_count());
+}
 
-    u32 q = div_round(tmp, reload);
+static void pit_program(u16 counts)
+{
+    usize_ptr irq_flags = irq_save();
 
-    u32 hz = div_round(q, PIT_DIVISOR);
+    // the very first load has no previous programming to account
+    if (pit_programmed)
+    {
+        pit_base_counts += pit_elapsed_counts();
+    }
 
-    return hz;
-}
+    outb(PIT_COMMAND, PIT_CMD_ONESHOT_CH0);
+    outb(PIT_CHANNEL0, (u8)(counts & 0xFF));       // low
+    outb(PIT_CHANNEL0, (u8)((counts >> 8) & 0xFF));// high
 
-static inline u64 compute_system_nanoseconds(void)
-{
-    u64 ns = (u64)system_timer_ms * 1000000ULL;
-    u64 frac_ns = ((u64)system_timer_ms_fractions * 1000000ULL) >> 32;
+    pit_programmed = counts;
 
-    return ns + frac_ns;
+    irq_restore(irq_flags);
 }
 
-int_timer_callback_t pit_callback;
-
-void set_pit_vars(u32 desired_hz)
+void pit_program_ns(u64 delta_ns)
 {
-    // Clamp reload value (too slow or too fast)
-    if (desired_hz <= MIN_PIT_HZ) 
-    {
-        pit_reload_value = 0xFFFF;
-    } 
-    else if (desired_hz >= MAX_PIT_HZ) 
+    u64 counts = (delta_ns * PIT_BASE_HZ) / NS_PER_SEC;
+
+    if (counts == 0)
     {
-        pit_reload_value = 1;
-    } 
-    else 
+        counts = 1;
+    }
+    else if (counts > PIT_MAX_COUNTS)
     {
-        // Compute reload (PIT_INPUT_CLOCK / desired_hz) / 3
-        u64 tmp = PIT_INPUT_CLOCK;
-        u32 div = desired_hz;
-
-        u64 q = div_round(tmp, div);
-
-        // Divide by 3 with rounding
-        pit_reload_value = div_round(q, PIT_DIVISOR);
-
-        if (pit_reload_value == 0)
-            pit_reload_value = 1;
+        counts = PIT_MAX_COUNTS;
     }
 
-    // Compute corrected frequency: (3579545 / reload) / 3
-    pit_hz = compute_tick_frequency(pit_reload_value);
-
-    // Calculate ms per tick in fixed-point
-    compute_per_tick_time(pit_reload_value);
+    pit_program((u16)counts);
 }
 
-void load_pit(u32 desired_hz)
+u64 pit_max_delta_ns()
 {
-    set_pit_vars(desired_hz);
-    
-    // Program PIT channel 0, mode 2 (rate generator)
-    outb(PIT_COMMAND, 0x34); // ch0, lobyte/hibyte, mode 2
-    outb(PIT_CHANNEL0, (u8)(pit_reload_value & 0xFF));       // low
-    outb(PIT_CHANNEL0, (u8)((pit_reload_value >> 8) & 0xFF));// high
-
-    // unmask IRQ0
-    pic_unmask_vector(IRQ_TIMER_VEC);
+    return (PIT_MAX_COUNTS * NS_PER_SEC) / PIT_BASE_HZ;
 }
 
-void pit_timer_dispatch(irq_frame_t* frame) 
+void pit_set_handler(void (*handler)())
 {
-    (void)frame;
+    pit_handler = handler;
+}
 
-    u64 sum = (u64)system_timer_ms_fractions + (u64)tick_ms_fractions;
-    system_timer_ms_fractions = (u32)(sum & 0xFFFFFFFF);
-    system_timer_ms += tick_ms + (u32)(sum >> 32);
+void load_pit()
+{
+    // start counting right away, the clock fallback depends on it
+    pit_program(PIT_MAX_COUNTS);
+}
 
-    tick_count++;
+bool pit_timer_dispatch(irq_frame_t* frame, void* ctx) 
+{
+    (void)frame;
+    (void)ctx;
 
-    if (pit_callback)
+    if (pit_handler)
     {
-        int_timer_event_t event = {
-            .timestamp_ns=compute_system_nanoseconds(),
-            .tick_count = tick_count,
-            .frequency_hz = pit_hz,
-        };
-
-        pit_callback(event);
+        pit_handler();
+    }
+    else
+    {
+        // nobody to rearm it yet, keep the counter accounted
+        pit_program(PIT_MAX_COUNTS);
     }
 
-    pic_send_eoi_vector(IRQ_TIMER_VEC);
+    return true;
 }
 
-void pit_update_callback(int_timer_callback_t callback) 
+u64 pit_now_ns()
 {
-    assert(callback);
-    pit_callback = callback;
+    usize_ptr irq_flags = irq_save();
+
+    u64 counts = pit_base_counts + pit_elapsed_counts();
+    u64 now_ns = (counts * NS_PER_SEC) / PIT_BASE_HZ;
+
+    // a late reprogram may lose a count or two, never go backwards
+    if (now_ns < last_now_ns)
+    {
+        now_ns = last_now_ns;
+    }
+    last_now_ns = now_ns;
+
+    irq_restore(irq_flags);
+
+    return now_ns;
 }
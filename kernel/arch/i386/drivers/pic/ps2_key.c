@@ -10,10 +10,6 @@ u8 ps2_read_data(void)
 {
     return inb(PS2_DATA);;
 }
-void ps2_send_eoi(void)
-{    
-    pic_send_eoi_vector(PS2_IRQ_VECTOR);
-}
 
 static u16 ps2_kc_map[128];
 static u16 ps2_kc_map_ext[128];
@@ -158,9 +154,10 @@ void ps2_init()
 
 key_event_cb_t key_event_callback;
 
-void ps2_key_dispatch(irq_frame_t* frame)
+bool ps2_key_dispatch(irq_frame_t* frame, void* ctx)
 {
     (void)frame;
+    (void)ctx;
 
     static bool extended = false;
 
@@ -170,16 +167,9 @@ void ps2_key_dispatch(irq_frame_t* frame)
     if (ps2_scancode == 0xE0)
     {
         extended = true;
-        io_wait();
-        ps2_send_eoi();
 
-        return;
+        return true;
     }
-    if (ps2_scancode == 0xE1) 
-    { 
-        io_wait();
-        ps2_send_eoi();
-    } 
     
     bool released    = ps2_scancode & 0x80;
     u8 code     = ps2_scancode & 0x7F;
@@ -202,6 +192,5 @@ void ps2_key_dispatch(irq_frame_t* frame)
 
     key_event_callback(key_event);
 
-    io_wait();
-    ps2_send_eoi();
+    return true;
 }
\ No newline at end of file
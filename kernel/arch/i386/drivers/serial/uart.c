@@ -0,0 +1,298 @@
+#include <arch/i386/drivers/serial/uart.h>
+#include <arch/i386/drivers/io/io.h>
+#include <services/threads/locks/spinlock.h>
+#include <kernel/core/cpu.h>
+
+// register offsets from the base port
+#define UART_REG_DATA 0 // RBR/THR, DLL when DLAB=1
+#define UART_REG_IER  1 // DLM when DLAB=1
+#define UART_REG_IIR  2 // read
+#define UART_REG_FCR  2 // write
+#define UART_REG_LCR  3
+#define UART_REG_MCR  4
+#define UART_REG_LSR  5
+#define UART_REG_MSR  6
+
+#define UART_IER_RDI   0x01
+#define UART_IER_THRI  0x02
+#define UART_IER_RLSI  0x04
+
+#define UART_IIR_NO_INT   0x01
+#define UART_IIR_ID_MASK  0x0E
+#define UART_IIR_MSI      0x00
+#define UART_IIR_THRI     0x02
+#define UART_IIR_RDI      0x04
+#define UART_IIR_RLSI     0x06
+#define UART_IIR_TIMEOUT  0x0C
+#define UART_IIR_FIFO_MASK 0xC0
+
+#define UART_FCR_ENABLE    0x01
+#define UART_FCR_CLEAR_RX  0x02
+#define UART_FCR_CLEAR_TX  0x04
+#define UART_FCR_TRIG_14   0xC0
+
+#define UART_LCR_8N1  0x03
+#define UART_LCR_DLAB 0x80
+
+#define UART_MCR_DTR  0x01
+#define UART_MCR_RTS  0x02
+#define UART_MCR_OUT1 0x04
+#define UART_MCR_OUT2 0x08 // gates the irq line on PC hardware
+#define UART_MCR_LOOP 0x10
+
+#define UART_LSR_DR   0x01
+#define UART_LSR_THRE 0x20
+
+#define UART_FIFO_16550 16
+
+#define UART_LOOPBACK_BYTE 0xAE
+
+#define UART_RING_MASK (UART_TX_RING_SIZE - 1)
+
+static struct
+{
+    u16 port;
+    bool present;
+    u8 fifo_size;
+    u8 ier;
+
+    spinlock_t lock;
+
+    // head = next write, tail = next read, free running
+    u32 head;
+    u32 tail;
+    char ring[UART_TX_RING_SIZE];
+} uart;
+
+static inline u8 uart_in(u16 reg)
+{
+    return inb(uart.port + reg);
+}
+
+static inline void uart_out(u16 reg, u8 val)
+{
+    outb(uart.port + reg, val);
+}
+
+static inline u32 ring_used()
+{
+    return uart.head - uart.tail;
+}
+
+static inline bool ring_full()
+{
+    return ring_used() == UART_TX_RING_SIZE;
+}
+
+static void set_ier(u8 ier)
+{
+    if (uart.ier == ier)
+    {
+        return;
+    }
+
+    uart.ier = ier;
+    uart_out(UART_REG_IER, ier);
+}
+
+// THR empty means the whole FIFO is empty, refill it in one burst
+// lock must be held
+static void fill_fifo()
+{
+    if ((uart_in(UART_REG_LSR) & UART_LSR_THRE) == 0)
+    {
+        return;
+    }
+
+    u8 burst = uart.fifo_size;
+    while (burst-- && uart.head != uart.tail)
+    {
+        uart_out(UART_REG_DATA, uart.ring[uart.tail & UART_RING_MASK]);
+        uart.tail++;
+    }
+}
+
+// lock must be held
+static void kick_tx()
+{
+    fill_fifo();
+
+    if (uart.head != uart.tail)
+    {
+        set_ier(uart.ier | UART_IER_THRI);
+    }
+    else
+    {
+        set_ier(uart.ier & ~UART_IER_THRI);
+    }
+}
+
+// lock must be held, only used when the ring is full (or on flush)
+static void poll_drain()
+{
+    while (uart.head != uart.tail)
+    {
+        while ((uart_in(UART_REG_LSR) & UART_LSR_THRE) == 0)
+        {
+            cpu_relax();
+        }
+
+        fill_fifo();
+    }
+}
+
+static inline void ring_push(char c)
+{
+    if (ring_full())
+    {
+        poll_drain();
+    }
+
+    uart.ring[uart.head & UART_RING_MASK] = c;
+    uart.head++;
+}
+
+bool uart_init(u16 port, u32 baud)
+{
+    uart.port = port;
+    uart.present = false;
+
+    if (baud == 0 || baud > UART_CLOCK_HZ)
+    {
+        return false;
+    }
+
+    u16 divisor = UART_CLOCK_HZ / baud;
+
+    uart_out(UART_REG_IER, 0);
+
+    uart_out(UART_REG_LCR, UART_LCR_DLAB);
+    uart_out(UART_REG_DATA, divisor & 0xFF);
+    uart_out(UART_REG_IER, divisor >> 8);
+    uart_out(UART_REG_LCR, UART_LCR_8N1);
+
+    uart_out(
+        UART_REG_FCR,
+        UART_FCR_ENABLE | UART_FCR_CLEAR_RX | UART_FCR_CLEAR_TX | UART_FCR_TRIG_14
+    );
+
+    // loopback self test, a missing port reads back 0xFF
+    uart_out(UART_REG_MCR, UART_MCR_LOOP | UART_MCR_OUT1 | UART_MCR_OUT2 | UART_MCR_RTS);
+    uart_out(UART_REG_DATA, UART_LOOPBACK_BYTE);
+
+    if (uart_in(UART_REG_DATA) != UART_LOOPBACK_BYTE)
+    {
+        return false;
+    }
+
+    // 16550A reports both FIFO bits, older parts have a broken/no FIFO
+    if ((uart_in(UART_REG_IIR) & UART_IIR_FIFO_MASK) == UART_IIR_FIFO_MASK)
+    {
+        uart.fifo_size = UART_FIFO_16550;
+    }
+    else
+    {
+        uart.fifo_size = 1;
+    }
+
+    uart_out(UART_REG_MCR, UART_MCR_DTR | UART_MCR_RTS | UART_MCR_OUT2);
+
+    spinlock_initlock(&uart.lock, false);
+    uart.head = 0;
+    uart.tail = 0;
+
+    // rx is drained and dropped for now, keeps the line from stalling
+    uart.ier = 0;
+    set_ier(UART_IER_RDI | UART_IER_RLSI);
+
+    uart.present = true;
+
+    return true;
+}
+
+void uart_write(const char* data, usize_ptr size)
+{
+    if (uart.present == false)
+    {
+        return;
+    }
+
+    spinlock_lock(&uart.lock);
+
+    for (usize_ptr i = 0; i < size; i++)
+    {
+        if (data[i] == '\n')
+        {
+            ring_push('\r');
+        }
+
+        ring_push(data[i]);
+    }
+
+    kick_tx();
+
+    spinlock_unlock(&uart.lock);
+}
+
+void uart_flush()
+{
+    if (uart.present == false)
+    {
+        return;
+    }
+
+    // abort path may hold the lock already, don't deadlock on it
+    bool locked = spinlock_try_lock(&uart.lock);
+
+    poll_drain();
+    set_ier(uart.ier & ~UART_IER_THRI);
+
+    if (locked)
+    {
+        spinlock_unlock(&uart.lock);
+    }
+}
+
+bool uart_dispatch(irq_frame_t* frame, void* ctx)
+{
+    (void)frame;
+    (void)ctx;
+
+    spinlock_lock(&uart.lock);
+
+    bool handled = false;
+
+    u8 iir;
+    while (((iir = uart_in(UART_REG_IIR)) & UART_IIR_NO_INT) == 0)
+    {
+        handled = true;
+
+        switch (iir & UART_IIR_ID_MASK)
+        {
+            case UART_IIR_THRI:
+                kick_tx();
+                break;
+
+            case UART_IIR_RDI:
+            case UART_IIR_TIMEOUT:
+                while (uart_in(UART_REG_LSR) & UART_LSR_DR)
+                {
+                    uart_in(UART_REG_DATA);
+                }
+                break;
+
+            case UART_IIR_RLSI:
+                uart_in(UART_REG_LSR);
+                break;
+
+            case UART_IIR_MSI:
+            default:
+                uart_in(UART_REG_MSR);
+                break;
+        }
+    }
+
+    spinlock_unlock(&uart.lock);
+
+    return handled;
+}
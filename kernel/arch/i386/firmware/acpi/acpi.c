@@ -5,6 +5,7 @@
 #include <arch/i386/firmware/acpi/acpi.h>
 #include <memory/core/memory_manager.h>
 #include <firmware/acpi/fadt.h>
+#include <firmware/acpi/madt.h>
 #include <firmware/acpi/rsdp.h>
 #include <firmware/acpi/rsdt.h>
 #include <kernel/memory/paging.h>
@@ -39,21 +40,40 @@ u64 get_acpi_time()
     return 0;
 }
 
+bool acpi_timer_present()
+{
+    return (acpi_timer.flags & ACPI_TIMER_ACTIVE) != 0;
+}
+
+u32 acpi_timer_mask()
+{
+    return (acpi_timer.flags & ACPI_TIMER_24) ? 0x00FFFFFF : 0xFFFFFFFF;
+}
+
 void init_acpi()
 {
     rsdp_t* rdsp = gather_rdsp();
     
     fadt_t* fadt = NULL;
+    madt_t* madt = NULL;
 
     if (rdsp->revision >= 2 && ((xsdp_t*)rdsp)->xsdt_address != 0) 
     {
         xsdt_t* xsdt = (xsdt_t*)(usize_ptr)((xsdp_t*)rdsp)->xsdt_address;
         fadt = find_fadt_by_xsdt(xsdt);
+        madt = (madt_t*)find_sdt_by_xsdt(xsdt, MADT_SIGNATURE);
     } 
     else 
     {
         rsdt_t* rsdt = (rsdt_t*)(usize_ptr)rdsp->rsdt_address;
         fadt = find_fadt_by_rsdt(rsdt);
+        madt = (madt_t*)find_sdt_by_rsdt(rsdt, MADT_SIGNATURE);
+    }
+
+    // no MADT = no APICs described, the kernel stays on the BSP and 8259
+    if (madt)
+    {
+        madt_parse(madt);
     }
 
     assert (fadt);
@@ -2,12 +2,24 @@
 #include <kernel/core/cpu.h>
 #include <arch/i386/core/idt.h>
 #include <arch/i386/interrupts/irq.h>
+#include <arch/i386/core/tsc.h>
+#include <services/threads/softirq.h>
+#include <services/threads/sched.h>
+#include <services/threads/rcu.h>
 #include <stdio.h>
 
 #define IRQ_VECTOR_PAGE_FAULT 14
 
+typedef struct irq_desc
+{
+    irq_action_t* actions;
+    irq_chip_t* chip;
+    irq_stats_t stats;
+} irq_desc_t;
+
 idt_entry_t idt_entries[IDT_ENTRIES];
 void (*interrupt_callback_entries[IDT_ENTRIES]) (irq_frame_t* data);
+static irq_desc_t irq_descs[IDT_ENTRIES];
 
 static void set_idt_entry(u32 entry_index, void (*handler_addr_ptr), u16 selector, u8 type_attr)
 {
@@ -88,6 +100,58 @@ bool irq_is_enabled()
 
     return flags & (1 << 9); 
 }
+
+static inline void account_irq(irq_stats_t* stats, u64 cycles64)
+{
+    u32 cycles = cycles64 > 0xFFFFFFFF ? 0xFFFFFFFF : (u32)cycles64;
+
+    stats->count++;
+    stats->cycles_total += cycles;
+    stats->cycles_max = max(stats->cycles_max, cycles);
+    stats->hist[cycles ? log2_u32(cycles) : 0]++;
+}
+
+// hardware vectors enter here straight from the IRQ stubs
+void irq_hw_dispatch(irq_frame_t* frame)
+{
+    u32 vector = frame->irq_index;
+    irq_desc_t* desc = &irq_descs[vector];
+
+    if (desc->chip && desc->chip->spurious && desc->chip->spurious(vector))
+    {
+        desc->stats.spurious++;
+        return;
+    }
+
+    u64 start = rdtsc();
+
+    bool handled = false;
+    for (irq_action_t* action = desc->actions; action; action = action->next)
+    {
+        handled |= action->handler(frame, action->ctx);
+    }
+
+    account_irq(&desc->stats, rdtsc() - start);
+
+    if (handled == false)
+    {
+        desc->stats.unhandled++;
+    }
+
+    if (desc->chip)
+    {
+        desc->chip->eoi(vector);
+    }
+
+    // the interrupted context had irqs on, so it was outside any read section
+    rcu_note_qs();
+
+    // deferred work runs after the EOI so the line can fire again
+    softirq_irq_exit();
+
+    sched_irq_exit();
+}
+
 void idt_c_handler(irq_frame_t *frame)
 {
     u32 v = frame->irq_index;
@@ -131,6 +195,132 @@ void irq_register_handler(u32 vector, void (*handle)(irq_frame_t*))
     interrupt_callback_entries[vector] = handle;
 }
 
+void irq_request(u32 vector, irq_action_t* action, irq_handler_t handler, void* ctx, const char* name)
+{
+    assert(vector < IDT_ENTRIES && action && handler);
+
+    action->handler = handler;
+    action->ctx = ctx;
+    action->name = name;
+    action->next = NULL;
+
+    usize_ptr irq_flags = irq_save();
+
+    irq_desc_t* desc = &irq_descs[vector];
+    bool first = desc->actions == NULL;
+
+    irq_action_t** link = &desc->actions;
+    while (*link)
+    {
+        link = &(*link)->next;
+    }
+    *link = action;
+
+    if (first && desc->chip && desc->chip->unmask)
+    {
+        desc->chip->unmask(vector);
+    }
+
+    irq_restore(irq_flags);
+}
+
+void irq_release(u32 vector, irq_action_t* action)
+{
+    assert(vector < IDT_ENTRIES && action);
+
+    usize_ptr irq_flags = irq_save();
+
+    irq_desc_t* desc = &irq_descs[vector];
+
+    irq_action_t** link = &desc->actions;
+    while (*link && *link != action)
+    {
+        link = &(*link)->next;
+    }
+
+    if (*link)
+    {
+        *link = action->next;
+        action->next = NULL;
+    }
+
+    if (desc->actions == NULL && desc->chip && desc->chip->mask)
+    {
+        desc->chip->mask(vector);
+    }
+
+    irq_restore(irq_flags);
+}
+
+void irq_set_chip(u32 first_vector, u32 count, irq_chip_t* chip)
+{
+    assert(first_vector + count <= IDT_ENTRIES);
+
+    usize_ptr irq_flags = irq_save();
+
+    for (u32 vector = first_vector; vector < first_vector + count; vector++)
+    {
+        irq_desc_t* desc = &irq_descs[vector];
+
+        if (desc->actions && desc->chip && desc->chip->mask)
+        {
+            desc->chip->mask(vector);
+        }
+
+        desc->chip = chip;
+
+        if (desc->actions && chip && chip->unmask)
+        {
+            chip->unmask(vector);
+        }
+    }
+
+    irq_restore(irq_flags);
+}
+
+bool irq_set_affinity(u32 vector, u32 cpu)
+{
+    assert(vector < IDT_ENTRIES);
+
+    irq_chip_t* chip = irq_descs[vector].chip;
+    if (chip == NULL || chip->set_affinity == NULL)
+    {
+        return false;
+    }
+
+    return chip->set_affinity(vector, cpu);
+}
+
+const irq_stats_t* irq_get_stats(u32 vector)
+{
+    assert(vector < IDT_ENTRIES);
+
+    return &irq_descs[vector].stats;
+}
+
+void irq_print_stats()
+{
+    for (u32 vector = 0; vector < IDT_ENTRIES; vector++)
+    {
+        irq_desc_t* desc = &irq_descs[vector];
+        if (desc->stats.count == 0 && desc->stats.spurious == 0)
+        {
+            continue;
+        }
+
+        printf(
+            "irq 0x%x %s: count %llu unhandled %llu spurious %llu avg %llu max %lu cycles\n",
+            vector,
+            desc->actions ? desc->actions->name : "-",
+            desc->stats.count,
+            desc->stats.unhandled,
+            desc->stats.spurious,
+            desc->stats.count ? desc->stats.cycles_total / desc->stats.count : 0,
+            (unsigned long)desc->stats.cycles_max
+        );
+    }
+}
+
 usize_ptr irq_frame_get_error(irq_frame_t *frame)
 {
     return frame->err_code;
@@ -202,8 +392,19 @@ void init_irq()
     set_idt_entry(0x2E, isr46, SEGMENT_SELECTOR_CODE_DPL0, IDT_INTERRUPT_32_DPL0);
     set_idt_entry(0x2F, isr47, SEGMENT_SELECTOR_CODE_DPL0, IDT_INTERRUPT_32_DPL0);
 
+    // Local APIC
+    set_idt_entry(0xEF, isr239, SEGMENT_SELECTOR_CODE_DPL0, IDT_INTERRUPT_32_DPL0);
+    set_idt_entry(0xF0, isr240, SEGMENT_SELECTOR_CODE_DPL0, IDT_INTERRUPT_32_DPL0);
+    set_idt_entry(0xFE, isr254, SEGMENT_SELECTOR_CODE_DPL0, IDT_INTERRUPT_32_DPL0);
+    set_idt_entry(0xFF, isr255, SEGMENT_SELECTOR_CODE_DPL0, IDT_INTERRUPT_32_DPL0);
+
     irq_register_handler(IRQ_VECTOR_PAGE_FAULT, interrupt_page_fault);
 
+    irq_init_cpu();
+}
+
+void irq_init_cpu()
+{
     idt_descriptor_t idt_descriptor;
     idt_descriptor.base = (u32)&idt_entries;
     idt_descriptor.limit = sizeof(idt_entries)- 1;
@@ -6,6 +6,7 @@
 ;
 
 extern idt_c_handler
+extern irq_hw_dispatch
 
 %macro PUSH_PLACEHOLDERS 0
     push dword 0      ; user SS
@@ -15,6 +16,8 @@ extern idt_c_handler
     add esp, 8
 %endmacro
 
+; hardware vectors skip the exception table and go straight to the
+; irq core (handler chain, stats and EOI)
 %macro IRQ 1
 section .text
 global isr%1
@@ -24,7 +27,7 @@ isr%1:
     push dword %1        ; irq_index
     push dword 0         ; fake err_code
     push esp             ; pointer to irq_frame_t
-    call idt_c_handler
+    call irq_hw_dispatch
     add esp, 12          ; pop arg, fake err_code and irq_index
     popad                ; restore registers
     POP_PLACEHOLDERS
@@ -113,4 +116,9 @@ IRQ 43
 IRQ 44
 IRQ 45
 IRQ 46
-IRQ 47
\ No newline at end of file
+IRQ 47
+; local APIC vectors (timer, reschedule IPI, error, spurious)
+IRQ 239
+IRQ 240
+IRQ 254
+IRQ 255
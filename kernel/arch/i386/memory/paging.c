@@ -66,11 +66,17 @@ bool paging_map_pages(void* pa_ptr, void* va_ptr, u32 count, u16 paging_flags)
     assert(((u32)va_ptr % PAGE_SIZE) == 0);
     assert(count > 0);
 
-    return map_phys_range(
+    mm_lock();
+
+    bool mapped = map_phys_range(
         pa_ptr, va_ptr, 
         count, 
         hw_flags
     );
+
+    mm_unlock();
+
+    return mapped;
 }
 
 bool paging_map_page(void* pa_ptr, void* va_ptr, u16 paging_flags)
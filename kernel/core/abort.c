@@ -1,10 +1,12 @@
 #include "core/abort.h"
 #include "kernel/interrupts/irq.h"
 #include "kernel/core/cpu.h"
+#include "drivers/console.h"
 
 void abort()
 {
     // for now
     irq_disable();
+    console_flush();
     cpu_halt();
 }
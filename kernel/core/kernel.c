@@ -8,9 +8,15 @@
 #include "drivers/storage.h"
 #include "memory/virt/virt_alloc.h"
 #include "memory/virt/virt_region.h"
+#include "services/bench/bench.h"
 #include "services/block/device.h"
 #include "services/block/manager.h"
 #include "services/block/request.h"
+#include "services/time/timer.h"
+#include "services/threads/softirq.h"
+#include "services/threads/rcu.h"
+#include "services/threads/sched.h"
+#include "services/threads/workqueue.h"
 #include "vfs/core/errors.h"
 #include "vfs/core/mount.h"
 #include "vfs/core/path.h"
@@ -20,13 +26,17 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <core/defs.h>
+#include <drivers/console.h>
 #include <drivers/tty.h>
 #include <firmware/acpi/acpi.h>
 #include <kernel/boot/boot_data.h>
 #include <kernel/devices/keyboard.h>
 #include <kernel/devices/int_timer.h>
+#include <kernel/devices/clock.h>
+#include <kernel/devices/serial.h>
 #include <kernel/interrupts/irq.h>
 #include <kernel/core/cpu.h>
+#include <kernel/core/smp.h>
 #include <string.h>
 
 void init_memory(boot_data_t* data);
@@ -83,6 +93,7 @@ static void dummy_key_handler(raw_key_event_t key_event)
         case KEYCODE_ENTER: printf("\n"); break;
         case KEYCODE_SPACE: printf(" "); break;
         case KEYCODE_MINUS: dummy_printing_time = !dummy_printing_time; break;
+        case KEYCODE_EQUAL: irq_print_stats(); break;
 
         default:
             break;
@@ -104,8 +115,11 @@ static void dummy_time_event(int_timer_event_t time_event)
 void kernel_main(boot_data_t* boot_data)
 {
     cpu_init();
+    init_softirq();
 
 	terminal_initialize();
+    init_serial(SERIAL_DEFAULT_BAUD);
+    console_set_backends(CONSOLE_DEFAULT_BACKENDS);
 
     // Setup interrupt handlers
 	init_memory(boot_data);
@@ -115,6 +129,16 @@ void kernel_main(boot_data_t* boot_data)
     init_acpi();
 
     // basic drivers
+    init_int_timer_device();
+    init_clock();
+    init_timers();
+    printf("clocksource: %s\n", clock_source_name());
+
+    init_sched();
+    init_smp();
+    init_workqueue();
+    init_rcu();
+
     init_int_timer(10, dummy_time_event);
     init_keyboard(dummy_key_handler);
     init_storage();
@@ -126,6 +150,13 @@ void kernel_main(boot_data_t* boot_data)
     block_device_t* block_dev = block_manager_get_device(2);
     init_vfs(block_dev);
     vfs_mount_map_t* map = vfs_get_mount_data();
+
+#ifdef KERNEL_BENCH
+    // never returns, the results go out on the serial port
+    bench_env_t bench_env = { .device = block_dev, .vfs = map };
+    bench_run_all(&bench_env);
+#endif
+
     dir_entry_t *result = NULL;
     i32 res = vfs_lookup_path(map, "/file.txt", &result);
     inode_t* inode = result->inode;
@@ -140,5 +171,6 @@ void kernel_main(boot_data_t* boot_data)
         }
     }
 
-    while(1) cpu_halt();
+    // the boot flow is this CPU's idle thread from here on
+    sched_idle();
 }
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <kernel/core/percpu.h>
+#include <kernel/core/cpu.h>
+#include <kernel/core/smp.h>
+#include <kernel/interrupts/irq.h>
+#include <core/defs.h>
+#include <services/threads/locks/spinlock.h>
+
+// room for runtime per CPU objects, part of the template so every CPU's
+// copy has it at the same offset
+#define PERCPU_DYNAMIC_SIZE 4096
+
+DEFINE_PER_CPU(u8, percpu_dynamic[PERCPU_DYNAMIC_SIZE]) __attribute__((aligned(64)));
+
+static spinlock_t dynamic_lock;
+static usize_ptr dynamic_used;
+
+void* percpu_alloc(usize_ptr size, usize_ptr align)
+{
+    assert(size && align && (align & (align - 1)) == 0);
+
+    spinlock_lock(&dynamic_lock);
+
+    usize_ptr start = (dynamic_used + align - 1) & ~(align - 1);
+    void* result = NULL;
+
+    if (start + size <= PERCPU_DYNAMIC_SIZE)
+    {
+        result = &percpu_dynamic[start];
+        dynamic_used = start + size;
+    }
+
+    spinlock_unlock(&dynamic_lock);
+
+    return result;
+}
+
+void percpu_counter_init(percpu_counter_t* counter, i64 value, i32 batch)
+{
+    assert(counter && batch > 0);
+
+    counter->count = value;
+    counter->batch = batch;
+    counter->local = percpu_alloc(sizeof(i32), sizeof(i32));
+    assert(counter->local);
+}
+
+void percpu_counter_add(percpu_counter_t* counter, i32 amount)
+{
+    // read, check and reset must stay on one CPU
+    usize_ptr irq_flags = irq_save();
+
+    i32 local = this_cpu_read(*counter->local) + amount;
+
+    if (local >= counter->batch || local <= -counter->batch)
+    {
+        atomic_fetch_add_explicit(&counter->count, local, memory_order_relaxed);
+        local = 0;
+    }
+
+    this_cpu_write(*counter->local, local);
+
+    irq_restore(irq_flags);
+}
+
+i64 percpu_counter_read(percpu_counter_t* counter)
+{
+    return atomic_load_explicit(&counter->count, memory_order_relaxed);
+}
+
+i64 percpu_counter_sum(percpu_counter_t* counter)
+{
+    i64 sum = atomic_load(&counter->count);
+
+    for (u32 cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        // offline CPUs have no copy, their offset aliases the BSP's
+        if (smp_cpu_online(cpu) == false)
+        {
+            continue;
+        }
+
+        sum += *(volatile i32*)per_cpu_ptr(*counter->local, cpu);
+    }
+
+    return sum;
+}
@@ -0,0 +1,53 @@
+#include <drivers/console.h>
+#include <drivers/tty.h>
+#include <kernel/devices/serial.h>
+
+// VGA only until the serial port is probed
+static u32 console_backends = CONSOLE_BACKEND_VGA;
+
+void console_set_backends(u32 backends)
+{
+    if (serial_present() == false)
+    {
+        backends &= ~CONSOLE_BACKEND_SERIAL;
+    }
+
+    // never end up with no output at all
+    if (backends == 0)
+    {
+        backends = CONSOLE_BACKEND_VGA;
+    }
+
+    console_backends = backends;
+}
+
+u32 console_get_backends()
+{
+    return console_backends;
+}
+
+void console_write(const char* data, usize_ptr size)
+{
+    if (console_backends & CONSOLE_BACKEND_SERIAL)
+    {
+        serial_write(data, size);
+    }
+
+    if (console_backends & CONSOLE_BACKEND_VGA)
+    {
+        terminal_write(data, size);
+    }
+}
+
+void console_flush()
+{
+    if (console_backends & CONSOLE_BACKEND_SERIAL)
+    {
+        serial_flush();
+    }
+
+    if (console_backends & CONSOLE_BACKEND_VGA)
+    {
+        terminal_flush();
+    }
+}
@@ -5,9 +5,11 @@
 
 #include <drivers/tty.h>
 #include <drivers/vga.h>
+#include <services/threads/locks/spinlock.h>
+#include <services/time/timer.h>
 
-static const usize VGA_WIDTH = 80;
-static const usize VGA_HEIGHT = 25;
+#define VGA_WIDTH  80
+#define VGA_HEIGHT 25
 static u16* const VGA_MEMORY = (u16*) 0xB8000;
 
 static usize terminal_row;
@@ -15,20 +17,157 @@ static usize terminal_column;
 static u8 terminal_color;
 static u16* terminal_buffer;
 
+// all drawing goes to the RAM shadow, VGA memory only sees flushes
+// shadow row of screen row y is (terminal_start + y) % VGA_HEIGHT
+static u16 terminal_shadow[VGA_HEIGHT * VGA_WIDTH];
+static usize terminal_start;
+
+// dirty span per shadow row, [dirty_lo, dirty_hi)
+static u8 terminal_dirty_lo[VGA_HEIGHT];
+static u8 terminal_dirty_hi[VGA_HEIGHT];
+static bool terminal_full_redraw;
+
+static terminal_flush_mode_t terminal_flush_mode;
+
+// zero filled = unlocked, usable before terminal_initialize
+static spinlock_t terminal_lock;
+
+// deferred writes reach the screen at most this late
+#define TERMINAL_FLUSH_DELAY_NS 20000000ULL
+// only started under terminal_lock, which serializes its starts
+static ktimer_t terminal_flush_timer;
+
+static inline u16* shadow_row(usize y)
+{
+	usize row = terminal_start + y;
+	if (row >= VGA_HEIGHT)
+	{
+		row -= VGA_HEIGHT;
+	}
+
+	return &terminal_shadow[row * VGA_WIDTH];
+}
+
+static inline void mark_dirty(usize y, usize x)
+{
+	usize row = terminal_start + y;
+	if (row >= VGA_HEIGHT)
+	{
+		row -= VGA_HEIGHT;
+	}
+
+	if (terminal_dirty_lo[row] > x)
+	{
+		terminal_dirty_lo[row] = x;
+	}
+	if (terminal_dirty_hi[row] < x + 1)
+	{
+		terminal_dirty_hi[row] = x + 1;
+	}
+}
+
+static inline void clear_dirty(usize row)
+{
+	terminal_dirty_lo[row] = VGA_WIDTH;
+	terminal_dirty_hi[row] = 0;
+}
+
+// VGA is uncached MMIO, move dwords instead of single cells
+// counts are u32, rep movsl takes its count in ecx
+static inline void vga_copy(u16* dst, const u16* src, u32 cells)
+{
+	u32 dwords = cells / 2;
+	asm volatile (
+		"rep movsl"
+		: "+D"(dst), "+S"(src), "+c"(dwords)
+		:
+		: "memory"
+	);
+
+	if (cells & 1)
+	{
+		*dst = *src;
+	}
+}
+
+static void flush_locked()
+{
+	if (terminal_full_redraw)
+	{
+		// the ring is two contiguous pieces on screen
+		usize top = VGA_HEIGHT - terminal_start;
+		vga_copy(
+			terminal_buffer,
+			&terminal_shadow[terminal_start * VGA_WIDTH],
+			top * VGA_WIDTH
+		);
+		vga_copy(
+			&terminal_buffer[top * VGA_WIDTH],
+			terminal_shadow,
+			terminal_start * VGA_WIDTH
+		);
+
+		for (usize row = 0; row < VGA_HEIGHT; row++)
+		{
+			clear_dirty(row);
+		}
+		terminal_full_redraw = false;
+		
+		return;
+	}
+
+	for (usize row = 0; row < VGA_HEIGHT; row++)
+	{
+		if (terminal_dirty_lo[row] >= terminal_dirty_hi[row])
+		{
+			continue;
+		}
+
+		usize y = row >= terminal_start
+			? row - terminal_start
+			: row + VGA_HEIGHT - terminal_start;
+
+		usize lo = terminal_dirty_lo[row];
+		vga_copy(
+			&terminal_buffer[y * VGA_WIDTH + lo],
+			&terminal_shadow[row * VGA_WIDTH + lo],
+			terminal_dirty_hi[row] - lo
+		);
+
+		clear_dirty(row);
+	}
+}
+
+static void flush_timer_fn(ktimer_t* timer, void* ctx)
+{
+	(void)timer;
+	(void)ctx;
+
+	spinlock_lock(&terminal_lock);
+	flush_locked();
+	spinlock_unlock(&terminal_lock);
+}
+
 void terminal_initialize(void) 
 {
 	terminal_row = 0;
 	terminal_column = 0;
+	terminal_start = 0;
 	terminal_color = vga_entry_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
 	terminal_buffer = VGA_MEMORY;
+	terminal_flush_mode = TERMINAL_FLUSH_IMMEDIATE;
+	ktimer_init(&terminal_flush_timer, flush_timer_fn, NULL);
 	for (usize y = 0; y < VGA_HEIGHT; y++) 
 	{
 		for (usize x = 0; x < VGA_WIDTH; x++) 
 		{
 			const usize index = y * VGA_WIDTH + x;
-			terminal_buffer[index] = vga_entry(' ', terminal_color);
+			terminal_shadow[index] = vga_entry(' ', terminal_color);
 		}
 	}
+
+	terminal_full_redraw = true;
+	flush_locked();
 }
 
 void terminal_setcolor(u8 color) 
@@ -38,27 +177,30 @@ void terminal_setcolor(u8 color)
 
 void terminal_putentryat(unsigned char c, u8 color, usize x, usize y) 
 {
-	const usize index = y * VGA_WIDTH + x;
-	terminal_buffer[index] = vga_entry(c, color);
+	shadow_row(y)[x] = vga_entry(c, color);
+	mark_dirty(y, x);
 }
+
 void terminal_scroll() 
 {
-	// Scroll all lines up by one
-	for (usize row = 0; row < VGA_HEIGHT; row++) 
+	// the old top row becomes the new bottom row
+	u16* last = &terminal_shadow[terminal_start * VGA_WIDTH];
+
+	terminal_start++;
+	if (terminal_start == VGA_HEIGHT)
 	{
-		for (usize col = 0; col < VGA_WIDTH; col++) 
-		{
-			terminal_buffer[row * VGA_WIDTH + col] =
-				terminal_buffer[(row + 1) * VGA_WIDTH + col];
-		}
+		terminal_start = 0;
 	}
 
 	// Clear the last line
+	const u16 blank = vga_entry(' ', terminal_color);
 	for (usize col = 0; col < VGA_WIDTH; col++) 
 	{
-		terminal_buffer[(VGA_HEIGHT - 1) * VGA_WIDTH + col] =
-			vga_entry(' ', terminal_color);
+		last[col] = blank;
 	}
+
+	// every screen row moved
+	terminal_full_redraw = true;
 }
 
 
@@ -76,7 +218,7 @@ void terminal_nextline()
 	}
 }
 
-void terminal_putchar(char c) 
+static void putchar_locked(char c)
 {
 	if (c == '\n')
 	{
@@ -96,12 +238,71 @@ void terminal_putchar(char c)
 	}
 }
 
+void terminal_putchar(char c) 
+{
+	terminal_write(&c, 1);
+}
+
 void terminal_write(const char* data, usize_ptr size) 
 {
+	// printing from irq handlers and other CPUs is allowed
+	spinlock_lock(&terminal_lock);
+
 	for (usize_ptr i = 0; i < size; i++)
 	{
-		terminal_putchar(data[i]);
+		putchar_locked(data[i]);
+	}
+
+	if (terminal_flush_mode == TERMINAL_FLUSH_IMMEDIATE)
+	{
+		flush_locked();
+	}
+	else if (!ktimer_pending(&terminal_flush_timer))
+	{
+		ktimer_start_in(&terminal_flush_timer, TERMINAL_FLUSH_DELAY_NS);
+	}
+
+	spinlock_unlock(&terminal_lock);
+}
+
+// the whole shadow, touching none of the dirty state
+static void redraw_unlocked()
+{
+	usize start = terminal_start;
+	usize top = VGA_HEIGHT - start;
+
+	vga_copy(terminal_buffer, &terminal_shadow[start * VGA_WIDTH], top * VGA_WIDTH);
+	vga_copy(&terminal_buffer[top * VGA_WIDTH], terminal_shadow, start * VGA_WIDTH);
+}
+
+void terminal_flush(void)
+{
+	// abort path may hold the lock already, don't deadlock on it, the
+	// screen gets the shadow as it stands instead
+	if (!spinlock_try_lock(&terminal_lock))
+	{
+		redraw_unlocked();
+		return;
 	}
+
+	flush_locked();
+
+	spinlock_unlock(&terminal_lock);
+}
+
+void terminal_set_flush_mode(terminal_flush_mode_t mode)
+{
+	spinlock_lock(&terminal_lock);
+
+	terminal_flush_mode = mode;
+
+	if (mode == TERMINAL_FLUSH_IMMEDIATE)
+	{
+		ktimer_cancel(&terminal_flush_timer);
+		flush_locked();
+	}
+
+	spinlock_unlock(&terminal_lock);
 }
 
 void terminal_writestring(const char* data) 
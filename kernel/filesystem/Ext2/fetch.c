@@ -36,10 +36,10 @@ inode_t* ext2_fetch_inode(superblock_t* sb, u32 inode)
     if (cache_inode)
         return cache_inode;
 
+    // read from disk unlocked, a racing fetch may cache it first
     inode_t* new_inode = make_init_inode(sb, inode);
-    inode_cache_insert(sb, new_inode);
 
-    return new_inode;
+    return inode_cache_insert(sb, new_inode);
 }
 
 
@@ -1,9 +1,9 @@
 #include "filesystem/drivers/Ext2/internal.h"
-#include "kernel/core/cpu.h"
 #include "memory/virt/virt_alloc.h"
 #include "memory/virt/virt_region.h"
 #include "services/block/device.h"
 #include "services/block/request.h"
+#include "services/threads/wait_queue.h"
 #include "core/defs.h"
 #include <string.h>
 
@@ -11,8 +11,7 @@ static void ext2_read_cb(block_request_t* request, i64 result)
 {
     assert(result >= 0);
 
-    bool* done = request->ctx;
-    *done = true;
+    complete(request->ctx);
 }
 
 void fs_read_bytes(
@@ -20,7 +19,8 @@ void fs_read_bytes(
     void* data, usize_ptr length, 
     usize offset)
 {
-    bool done = false;
+    completion_t done;
+    completion_init(&done);
 
     usize unnecessary = offset % sb->device->block_size;
 
@@ -44,7 +44,7 @@ void fs_read_bytes(
         ext2_read_cb, &done
     );
 
-    while (!done) cpu_relax();
+    wait_for_completion(&done);
 
     memcpy(
         data, 
@@ -6,6 +6,7 @@
 #include "filesystem/drivers/Ext2/fs_instance.h"
 #include "filesystem/drivers/Ext2/internal.h"
 #include "kernel/core/cpu.h"
+#include "services/threads/wait_queue.h"
 #include "memory/heap/heap.h"
 #include "vfs/core/superblock.h"
 #include "vfs/inode/inode.h"
@@ -16,8 +17,7 @@ void ext2_disk_done_cb(struct block_request* request, i64 result)
 {
     assert(result >= 0);
     
-    bool* done = request->ctx;
-    *done = true;
+    complete(request->ctx);
 }
 
 static u32 ext2_get_block_group(superblock_t* sb, u32 inode_num)
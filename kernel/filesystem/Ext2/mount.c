@@ -13,6 +13,7 @@
 #include "vfs/inode/inode.h"
 #include "vfs/inode/inode_cache.h"
 #include "core/defs.h"
+#include "utils/hash/fast_hash.h"
 #include <string.h>
 
 static  u64 ext2_hash_inode(const u8* inode_num_ptr, u64 length)
@@ -21,7 +22,8 @@ static  u64 ext2_hash_inode(const u8* inode_num_ptr, u64 length)
 
     u32* data = (u32*)inode_num_ptr;
 
-    return *data;
+    // inode numbers are sequential, spread them over the whole table
+    return hash_u32(*data);
 }
 
 static void ext2_destroy_cb(void* data, void* key_data, usize_ptr key_length)
@@ -1,6 +1,9 @@
 #include <firmware/acpi/fadt.h>
 #include <firmware/acpi/rsdp.h>
 #include <firmware/acpi/rsdt.h>
+#include <string.h>
+
+#define ACPI_SIGNATURE_LEN 4
 
 bool valid_checksum(acpi_sdt_header_t* table_header)
 {
@@ -13,3 +16,33 @@ bool valid_checksum(acpi_sdt_header_t* table_header)
 
     return sum == 0;
 }
+
+acpi_sdt_header_t* find_sdt_by_rsdt(rsdt_t* rsdt, const char* signature)
+{
+    u32 entries = (rsdt->header.length - sizeof(rsdt->header)) / sizeof(u32);
+
+    for (u32 i = 0; i < entries; i++)
+    {
+        acpi_sdt_header_t* h = (acpi_sdt_header_t*)rsdt->pointer_sdts[i];
+
+        if (!strncmp(h->signature, signature, ACPI_SIGNATURE_LEN) && valid_checksum(h))
+            return h;
+    }
+
+    return NULL;
+}
+
+acpi_sdt_header_t* find_sdt_by_xsdt(xsdt_t* xsdt, const char* signature)
+{
+    u32 entries = (xsdt->header.length - sizeof(xsdt->header)) / sizeof(u64);
+
+    for (u32 i = 0; i < entries; i++)
+    {
+        acpi_sdt_header_t* h = (acpi_sdt_header_t*)(usize_ptr)xsdt->pointer_sdts[i];
+
+        if (!strncmp(h->signature, signature, ACPI_SIGNATURE_LEN) && valid_checksum(h))
+            return h;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,130 @@
+#include <firmware/acpi/madt.h>
+
+static madt_info_t madt_info;
+
+static void add_cpu(madt_lapic_t* lapic)
+{
+    // disabled and not online capable, firmware says don't touch it
+    if ((lapic->flags & (MADT_LAPIC_ENABLED | MADT_LAPIC_ONLINE_CAPABLE)) == 0)
+    {
+        return;
+    }
+
+    if (madt_info.cpu_count >= MAX_CPUS)
+    {
+        madt_info.cpus_ignored++;
+        return;
+    }
+
+    madt_cpu_t* cpu = &madt_info.cpus[madt_info.cpu_count++];
+    cpu->apic_id = lapic->apic_id;
+    cpu->acpi_id = lapic->acpi_processor_id;
+}
+
+static void add_ioapic(madt_ioapic_t* ioapic)
+{
+    if (madt_info.ioapic_count >= MADT_MAX_IOAPICS)
+    {
+        return;
+    }
+
+    madt_ioapic_info_t* info = &madt_info.ioapics[madt_info.ioapic_count++];
+    info->id = ioapic->ioapic_id;
+    info->address = ioapic->address;
+    info->gsi_base = ioapic->gsi_base;
+}
+
+static void add_override(madt_iso_t* iso)
+{
+    // only ISA (bus 0) overrides are defined
+    if (iso->bus != 0 || madt_info.override_count >= MADT_MAX_OVERRIDES)
+    {
+        return;
+    }
+
+    madt_override_t* override = &madt_info.overrides[madt_info.override_count++];
+    override->source = iso->source;
+    override->gsi = iso->gsi;
+    override->flags = iso->flags;
+}
+
+void madt_parse(madt_t* madt)
+{
+    madt_info.present = true;
+    madt_info.pcat_compat = (madt->flags & MADT_FLAG_PCAT_COMPAT) != 0;
+    madt_info.lapic_address = madt->lapic_address;
+
+    u8* entry = madt->entries;
+    u8* end = (u8*)madt + madt->header.length;
+
+    while (entry + sizeof(madt_entry_header_t) <= end)
+    {
+        madt_entry_header_t* header = (madt_entry_header_t*)entry;
+
+        // a zero length entry would loop forever
+        if (header->length < sizeof(madt_entry_header_t) || entry + header->length > end)
+        {
+            break;
+        }
+
+        switch (header->type)
+        {
+            case MADT_ENTRY_LAPIC:
+                add_cpu((madt_lapic_t*)entry);
+                break;
+
+            case MADT_ENTRY_IOAPIC:
+                add_ioapic((madt_ioapic_t*)entry);
+                break;
+
+            case MADT_ENTRY_ISO:
+                add_override((madt_iso_t*)entry);
+                break;
+
+            case MADT_ENTRY_LAPIC_OVERRIDE:
+            {
+                // 64 bit address, only usable when it fits
+                u64 address = ((madt_lapic_override_t*)entry)->address;
+                if (address <= 0xFFFFFFFF)
+                {
+                    madt_info.lapic_address = (usize_ptr)address;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        entry += header->length;
+    }
+}
+
+const madt_info_t* madt_get_info()
+{
+    return &madt_info;
+}
+
+u32 madt_isa_to_gsi(u8 isa_irq, u16* flags)
+{
+    for (u32 i = 0; i < madt_info.override_count; i++)
+    {
+        if (madt_info.overrides[i].source == isa_irq)
+        {
+            if (flags)
+            {
+                *flags = madt_info.overrides[i].flags;
+            }
+
+            return madt_info.overrides[i].gsi;
+        }
+    }
+
+    // ISA defaults, active high edge
+    if (flags)
+    {
+        *flags = 0;
+    }
+
+    return isa_irq;
+}
@@ -0,0 +1,65 @@
+#ifndef __CPUID_H__
+#define __CPUID_H__
+
+#include "core/num_defs.h"
+#include <stdbool.h>
+
+#define CPUID_LEAF_FEATURES     0x00000001
+#define CPUID_LEAF_EXT_MAX      0x80000000
+#define CPUID_LEAF_EXT_POWER    0x80000007
+
+#define CPUID_FEAT_EDX_TSC      (1 << 4)
+#define CPUID_FEAT_EDX_MSR      (1 << 5)
+#define CPUID_FEAT_EDX_APIC     (1 << 9)
+#define CPUID_FEAT_ECX_TSC_DEADLINE (1 << 24)
+#define CPUID_POWER_EDX_INV_TSC (1 << 8)
+
+typedef struct cpuid_regs
+{
+    u32 eax;
+    u32 ebx;
+    u32 ecx;
+    u32 edx;
+} cpuid_regs_t;
+
+static inline cpuid_regs_t cpuid(u32 leaf, u32 subleaf)
+{
+    cpuid_regs_t regs;
+
+    asm volatile (
+        "cpuid"
+        : "=a"(regs.eax), "=b"(regs.ebx), "=c"(regs.ecx), "=d"(regs.edx)
+        : "a"(leaf), "c"(subleaf)
+    );
+
+    return regs;
+}
+
+static inline bool cpuid_has_tsc()
+{
+    return (cpuid(CPUID_LEAF_FEATURES, 0).edx & CPUID_FEAT_EDX_TSC) != 0;
+}
+
+static inline bool cpuid_has_apic()
+{
+    return (cpuid(CPUID_LEAF_FEATURES, 0).edx & CPUID_FEAT_EDX_APIC) != 0;
+}
+
+// LAPIC timer can fire at an absolute TSC value
+static inline bool cpuid_has_tsc_deadline()
+{
+    return (cpuid(CPUID_LEAF_FEATURES, 0).ecx & CPUID_FEAT_ECX_TSC_DEADLINE) != 0;
+}
+
+// constant rate in every P/C state, safe to use as a clock
+static inline bool cpuid_has_invariant_tsc()
+{
+    if (cpuid(CPUID_LEAF_EXT_MAX, 0).eax < CPUID_LEAF_EXT_POWER)
+    {
+        return false;
+    }
+
+    return (cpuid(CPUID_LEAF_EXT_POWER, 0).edx & CPUID_POWER_EDX_INV_TSC) != 0;
+}
+
+#endif // __CPUID_H__
@@ -64,4 +64,10 @@ typedef struct gdt_description
     u32 offset;
 } __attribute__((packed)) gdt_description_t ;
 
+#define GDT_SELECTOR_CODE_PL0 0x08
+#define GDT_SELECTOR_DATA_PL0 0x10
+
+// boot GDT, the template every CPU's own copy starts from
+extern gdt_entry_t gdt_entries[DESCRIPTORS_AMOUNT];
+
 #endif // __GDT_H__
\ No newline at end of file
@@ -86,6 +86,11 @@ extern void isr45();
 extern void isr46();
 extern void isr47();
 
+extern void isr239();
+extern void isr240();
+extern void isr254();
+extern void isr255();
+
 void early_set_interrupt_c_callback(u8 entry_index, void (*callback) (u32 error_code));
 void early_set_idt_callback(u16 index, void (*handler_addr));
 void early_set_idt_entry(u32 entry_index, void (*handler_addr), u16 selector, u8 type_attr);
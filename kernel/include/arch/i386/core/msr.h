@@ -0,0 +1,32 @@
+#ifndef __MSR_H__
+#define __MSR_H__
+
+#include "core/num_defs.h"
+
+#define MSR_APIC_BASE    0x0000001B
+#define MSR_TSC_DEADLINE 0x000006E0
+
+#define MSR_APIC_BASE_BSP    (1 << 8)
+#define MSR_APIC_BASE_ENABLE (1 << 11)
+#define MSR_APIC_BASE_MASK   0xFFFFF000
+
+static inline u64 rdmsr(u32 msr)
+{
+    u32 low, high;
+
+    asm volatile ("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+
+    return ((u64)high << 32) | low;
+}
+
+static inline void wrmsr(u32 msr, u64 value)
+{
+    asm volatile (
+        "wrmsr"
+        :
+        : "c"(msr), "a"((u32)value), "d"((u32)(value >> 32))
+        : "memory"
+    );
+}
+
+#endif // __MSR_H__
@@ -0,0 +1,41 @@
+#ifndef __ARCH_PERCPU_H__
+#define __ARCH_PERCPU_H__
+
+#include "core/num_defs.h"
+
+// Per CPU variables are addressed through GS. Each CPU's GS base is the
+// distance from the linked .bss.percpu template to its own copy, so
+// %gs:var hits this CPU's instance. The BSP's copy is the template itself
+// (base 0), which also makes every access valid before SMP bring up.
+
+// Single instruction read-modify-writes, atomic against irqs on the same
+// CPU without a lock prefix. Sizes 1, 2 and 4 only.
+
+#define __percpu_read(var)                                                  \
+    ({                                                                      \
+        __typeof__(var) __percpu_ret;                                       \
+        asm volatile ("mov %%gs:%1, %0" : "=r"(__percpu_ret) : "m"(var));  \
+        __percpu_ret;                                                       \
+    })
+
+#define __percpu_write(var, value)                                          \
+    do                                                                      \
+    {                                                                       \
+        __typeof__(var) __percpu_val = (value);                             \
+        asm volatile ("mov %1, %%gs:%0"                                     \
+            : "=m"(var) : "r"(__percpu_val) : "memory");                    \
+    } while (0)
+
+#define __percpu_add(var, value)                                            \
+    do                                                                      \
+    {                                                                       \
+        __typeof__(var) __percpu_val = (value);                             \
+        asm volatile ("add %1, %%gs:%0"                                     \
+            : "+m"(var) : "r"(__percpu_val) : "memory", "cc");              \
+    } while (0)
+
+// Gives cpu its own zeroed copy of the template, before the CPU starts.
+// Its GS base is percpu_offset_of(cpu) from then on.
+bool percpu_setup_cpu(u32 cpu);
+
+#endif // __ARCH_PERCPU_H__
@@ -0,0 +1,45 @@
+#ifndef __ARCH_SMP_H__
+#define __ARCH_SMP_H__
+
+#include "core/atomic_defs.h"
+#include <arch/i386/core/gdt.h>
+#include <kernel/core/smp.h>
+
+// fixed real mode page the APs start in, below 1 MiB, same value as
+// smp_trampoline.asm
+#define SMP_TRAMPOLINE_BASE 0x8000
+
+// GS segment of each CPU, based at its per CPU area
+#define SMP_GDT_PERCPU        DESCRIPTORS_AMOUNT
+#define SMP_GDT_ENTRIES       (DESCRIPTORS_AMOUNT + 1)
+#define GDT_SELECTOR_PERCPU   (SMP_GDT_PERCPU * sizeof(gdt_entry_t))
+
+// boot stack of an AP, becomes its idle thread's stack
+#define SMP_AP_STACK_PAGES 4
+
+// filled by the BSP before each AP's SIPI, layout shared with the asm
+typedef struct smp_trampoline_params
+{
+    u32 cr3;
+    u32 stack_top;
+    u32 entry;
+} __attribute__((packed)) smp_trampoline_params_t;
+
+// per CPU data, one cache line aligned slot per CPU
+typedef struct cpu
+{
+    u32 index;
+    u8 apic_id;
+    u8 acpi_id;
+    atom_bool online;
+
+    // boot GDT plus the CPU's own per CPU data segment
+    gdt_entry_t gdt[SMP_GDT_ENTRIES] __attribute__((aligned(8)));
+
+    void* stack;
+} __attribute__((aligned(64))) cpu_t;
+
+cpu_t* smp_get_cpu(u32 index);
+cpu_t* this_cpu();
+
+#endif // __ARCH_SMP_H__
@@ -0,0 +1,15 @@
+#ifndef __TSC_H__
+#define __TSC_H__
+
+#include "core/num_defs.h"
+
+static inline u64 rdtsc()
+{
+    u32 low, high;
+
+    asm volatile ("rdtsc" : "=a"(low), "=d"(high));
+
+    return ((u64)high << 32) | low;
+}
+
+#endif // __TSC_H__
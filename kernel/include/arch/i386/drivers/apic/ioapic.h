@@ -0,0 +1,28 @@
+#ifndef __IOAPIC_H__
+#define __IOAPIC_H__
+
+#include "core/num_defs.h"
+#include <stdbool.h>
+
+// indirect register window, select then read/write the data
+#define IOAPIC_REG_SELECT 0x00
+#define IOAPIC_REG_WINDOW 0x10
+
+#define IOAPIC_ID         0x00
+#define IOAPIC_VERSION    0x01
+// two 32 bit halves per redirection entry
+#define IOAPIC_REDIR_BASE 0x10
+
+#define IOAPIC_REDIR_ACTIVE_LOW (1 << 13)
+#define IOAPIC_REDIR_LEVEL      (1 << 15)
+#define IOAPIC_REDIR_MASKED     (1 << 16)
+
+// Takes the ISA IRQs over from the 8259 at the same vectors (PIC_IRQ_OFFSET
+// + irq), drivers keep their vector numbers. Needs the BSP's LAPIC enabled.
+bool init_ioapic();
+bool ioapic_present();
+
+// Routes the ISA IRQ behind vector to the CPU, false if not an IO APIC vector
+bool ioapic_set_affinity(u32 vector, u32 cpu);
+
+#endif // __IOAPIC_H__
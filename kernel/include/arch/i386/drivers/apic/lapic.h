@@ -0,0 +1,52 @@
+#ifndef __LAPIC_H__
+#define __LAPIC_H__
+
+#include "core/num_defs.h"
+#include <stdbool.h>
+
+// register offsets from the MMIO base
+#define LAPIC_REG_ID          0x020
+#define LAPIC_REG_VERSION     0x030
+#define LAPIC_REG_TPR         0x080
+#define LAPIC_REG_EOI         0x0B0
+#define LAPIC_REG_SVR         0x0F0
+#define LAPIC_REG_ESR         0x280
+#define LAPIC_REG_ICR_LOW     0x300
+#define LAPIC_REG_ICR_HIGH    0x310
+#define LAPIC_REG_LVT_TIMER   0x320
+#define LAPIC_REG_LVT_LINT0   0x350
+#define LAPIC_REG_LVT_LINT1   0x360
+#define LAPIC_REG_LVT_ERROR   0x370
+#define LAPIC_REG_TIMER_INIT  0x380
+#define LAPIC_REG_TIMER_CUR   0x390
+#define LAPIC_REG_TIMER_DIV   0x3E0
+
+#define LAPIC_LVT_MASKED (1 << 16)
+
+// CPU local vectors, above everything routed from the IO side
+#define LAPIC_VECTOR_TIMER    0xEF
+#define LAPIC_VECTOR_RESCHED  0xF0
+#define LAPIC_VECTOR_ERROR    0xFE
+#define LAPIC_VECTOR_SPURIOUS 0xFF
+
+#define LAPIC_VECTOR_FIRST LAPIC_VECTOR_TIMER
+
+// Maps the LAPIC page and claims the local vectors, BSP only
+bool init_lapic(usize_ptr pa);
+bool lapic_present();
+
+// Software enables the calling CPU's LAPIC, every CPU runs it once
+void lapic_enable();
+
+u32 lapic_read(u32 reg);
+void lapic_write(u32 reg, u32 value);
+
+u8 lapic_id();
+void lapic_eoi();
+
+void lapic_send_init(u8 apic_id);
+// AP starts in real mode at page << 12
+void lapic_send_startup(u8 apic_id, u8 page);
+void lapic_send_ipi(u8 apic_id, u8 vector);
+
+#endif // __LAPIC_H__
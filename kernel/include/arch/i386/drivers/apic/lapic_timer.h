@@ -0,0 +1,42 @@
+#ifndef __LAPIC_TIMER_H__
+#define __LAPIC_TIMER_H__
+
+#include "core/num_defs.h"
+#include <stdbool.h>
+
+// LVT timer mode, bits 18:17
+#define LAPIC_TIMER_LVT_ONESHOT      (0 << 17)
+#define LAPIC_TIMER_LVT_PERIODIC     (1 << 17)
+#define LAPIC_TIMER_LVT_TSC_DEADLINE (2 << 17)
+
+// divide configuration encoding for /16
+#define LAPIC_TIMER_DIV_16 0x3
+
+typedef enum lapic_timer_mode
+{
+    LAPIC_TIMER_ONESHOT,
+    LAPIC_TIMER_PERIODIC,
+    LAPIC_TIMER_TSC_DEADLINE,
+} lapic_timer_mode_t;
+
+// Measures the timer rate against the clocksource on the calling CPU,
+// every CPU's timer runs off the same bus clock. Needs init_clock().
+bool init_lapic_timer();
+bool lapic_timer_present();
+
+// Programs the calling CPU's LVT timer, the best one-shot mode available
+// (TSC-deadline if the TSC is the clocksource) unless periodic is asked for
+void lapic_timer_init_cpu(lapic_timer_mode_t mode);
+lapic_timer_mode_t lapic_timer_mode();
+
+void lapic_timer_set_handler(void (*handler)());
+
+// One-shot/TSC-deadline: fires once delta_ns from now.
+// Periodic: fires every delta_ns from now on.
+void lapic_timer_program_ns(u64 delta_ns);
+void lapic_timer_stop();
+u64 lapic_timer_max_delta_ns();
+
+u64 lapic_timer_hz();
+
+#endif // __LAPIC_TIMER_H__
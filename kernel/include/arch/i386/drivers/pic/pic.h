@@ -17,6 +17,9 @@ u16 pic_get_irr(void);
 u16 pic_get_isr(void);
 void pic_send_eoi_vector(u8 vector);
 void pic_unmask_vector(u8 vector);
+void pic_mask_vector(u8 vector);
 void setup_pic();
+// masks every line, once the IO APIC took over
+void pic_disable();
 
 #endif // __PIC_H__
\ No newline at end of file
@@ -4,8 +4,16 @@
 
 #define IRQ_TIMER_VEC   0x20 
 
-extern int_timer_callback_t pit_callback;
-void pit_timer_dispatch(irq_frame_t* frame) ;
-void load_pit(u32 desired_hz);
-void set_pit_vars(u32 desired_hz);
-void pit_update_callback(int_timer_callback_t callback);
+// 16 bit counter, ~54.9ms at 1.193182 MHz
+#define PIT_MAX_COUNTS 0xFFFF
+
+bool pit_timer_dispatch(irq_frame_t* frame, void* ctx);
+// Starts channel 0 in one-shot mode (mode 0)
+void load_pit();
+void pit_set_handler(void (*handler)());
+// Arms the one-shot, clamped to [1, PIT_MAX_COUNTS] counts
+void pit_program_ns(u64 delta_ns);
+u64 pit_max_delta_ns();
+// Counts accumulated across every programming, valid while the
+// one-shot is rearmed at least once per PIT_MAX_COUNTS
+u64 pit_now_ns();
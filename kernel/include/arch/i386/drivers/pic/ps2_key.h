@@ -9,5 +9,5 @@ extern key_event_cb_t key_event_callback;;
 #define PS2_IRQ_VECTOR 0x21
 
 void ps2_init();
-void ps2_key_dispatch(irq_frame_t* frame);
+bool ps2_key_dispatch(irq_frame_t* frame, void* ctx);
 
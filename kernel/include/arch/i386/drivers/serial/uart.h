@@ -0,0 +1,27 @@
+#ifndef __UART_H__
+#define __UART_H__
+
+#include <core/defs.h>
+#include <kernel/interrupts/irq.h>
+
+#define UART_COM1_PORT       0x3F8
+#define UART_COM1_IRQ_VECTOR 0x24 // IRQ4
+
+#define UART_CLOCK_HZ 115200
+
+// Size of the software TX ring (2^n)
+#define UART_TX_RING_SIZE STOR_4KiB
+
+// Probes and programs the 16550 at port (8N1, FIFO on, THRE irq off until needed)
+bool uart_init(u16 port, u32 baud);
+
+// Queues bytes in the TX ring, the THRE interrupt drains it
+// only spins on the line status if the ring is full
+void uart_write(const char* data, usize_ptr size);
+
+// Synchronously drains the TX ring (abort paths, irqs disabled)
+void uart_flush();
+
+bool uart_dispatch(irq_frame_t* frame, void* ctx);
+
+#endif // __UART_H__
@@ -27,4 +27,6 @@ typedef struct __attribute__((packed)) irq_frame
 
 } irq_frame_t;
 
-void init_irq();
\ No newline at end of file
+void init_irq();
+// Loads the shared IDT on the calling CPU, init_irq does it for the BSP
+void irq_init_cpu();
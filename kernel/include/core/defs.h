@@ -9,10 +9,17 @@
 #define max(a, b) (a > b ? a : b)
 #define min(a, b) (a < b ? a : b)
 
+// stddef.h may have it already (num_defs.h pulls it in)
+#ifndef NULL
 #define NULL ((void*)0)
+#endif
 
 #define BIT_TO_BYTE 8
 
+#define CACHE_LINE_SIZE 64
+// starts a field on its own cache line, away from what precedes it
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+
 #define STOR_1KiB   0x00000400
 #define STOR_2KiB   0x00000800
 #define STOR_4KiB   0x00001000
@@ -66,6 +73,20 @@ static inline usize div_up(usize a, usize b)
     return (a + (b-1)) / b;
 }
 
+// (a * mul) >> shift with a 96 bit intermediate, shift <= 32
+static inline u64 mul_u64_u32_shr(u64 a, u32 mul, u32 shift)
+{
+    u64 low  = (u64)(u32)a * mul;
+    u64 high = (a >> 32) * mul;
+
+    if (shift == 0)
+    {
+        return low + (high << 32);
+    }
+
+    return (low >> shift) + (high << (32 - shift));
+}
+
 static inline usize_ptr align_up_n(usize_ptr value, usize_ptr alignment/*2^n*/)
 {
     assert((alignment & (alignment-1)) == 0);
@@ -0,0 +1,26 @@
+#ifndef __CONSOLE_H__
+#define __CONSOLE_H__
+
+#include "core/num_defs.h"
+
+enum console_backend
+{
+    CONSOLE_BACKEND_VGA    = 1 << 0,
+    CONSOLE_BACKEND_SERIAL = 1 << 1,
+};
+
+// serial first, VGA kept as a mirror for the screen
+#ifndef CONSOLE_DEFAULT_BACKENDS
+#define CONSOLE_DEFAULT_BACKENDS (CONSOLE_BACKEND_SERIAL | CONSOLE_BACKEND_VGA)
+#endif // CONSOLE_DEFAULT_BACKENDS
+
+// Backends that failed to initialize are silently ignored
+void console_set_backends(u32 backends);
+u32 console_get_backends();
+
+void console_write(const char* data, usize_ptr size);
+
+// Pushes out anything still buffered (abort paths)
+void console_flush();
+
+#endif // __CONSOLE_H__
@@ -3,10 +3,23 @@
 
 #include "core/num_defs.h"
 
+typedef enum terminal_flush_mode
+{
+    // every write reaches VGA memory before returning
+    TERMINAL_FLUSH_IMMEDIATE,
+    // writes stay in the shadow buffer until terminal_flush() or a
+    // flush timer a few ms later, only usable after init_timers
+    TERMINAL_FLUSH_DEFERRED,
+} terminal_flush_mode_t;
+
 void terminal_initialize(void);
 void terminal_putchar(char c);
 void terminal_write(const char* data, usize_ptr size);
 void terminal_writestring(const char* data);
 
+// Copies dirty lines of the shadow buffer into VGA memory
+void terminal_flush(void);
+void terminal_set_flush_mode(terminal_flush_mode_t mode);
+
 
 #endif // __TTY_H__
\ No newline at end of file
@@ -29,7 +29,13 @@ typedef struct acpi_timer acpi_timer_t;
 
 bool valid_checksum(acpi_sdt_header_t* table_header);
 
+// PM timer runs at a fixed 3.579545 MHz
+#define ACPI_PM_TIMER_HZ 3579545
+
 u64 get_acpi_time();
+bool acpi_timer_present();
+// counter width, the PM timer wraps at 24 or 32 bits
+u32 acpi_timer_mask();
 
 void init_acpi();
 
@@ -0,0 +1,139 @@
+#ifndef __MADT_H__
+#define __MADT_H__
+
+#include <core/defs.h>
+#include <firmware/acpi/acpi.h>
+#include <kernel/core/cpu.h>
+
+// MADT - Multiple APIC Description Table
+// Lists the interrupt controllers: one local APIC per CPU, the IO APICs
+// and how legacy ISA IRQs are wired to their inputs
+
+#define MADT_SIGNATURE "APIC"
+
+#define MADT_MAX_IOAPICS   4
+#define MADT_MAX_OVERRIDES 16
+#define MADT_ISA_IRQS      16
+
+enum madt_entry_type
+{
+    MADT_ENTRY_LAPIC          = 0,
+    MADT_ENTRY_IOAPIC         = 1,
+    MADT_ENTRY_ISO            = 2,
+    MADT_ENTRY_NMI_SOURCE     = 3,
+    MADT_ENTRY_LAPIC_NMI      = 4,
+    MADT_ENTRY_LAPIC_OVERRIDE = 5,
+};
+
+// madt_t.flags
+#define MADT_FLAG_PCAT_COMPAT (1 << 0) // 8259 pair installed too
+
+// madt_lapic_t.flags
+#define MADT_LAPIC_ENABLED        (1 << 0)
+#define MADT_LAPIC_ONLINE_CAPABLE (1 << 1)
+
+// madt_iso_t.flags, MPS INTI polarity/trigger
+#define MADT_ISO_POLARITY_MASK 0x3
+#define MADT_ISO_POLARITY_HIGH 0x1
+#define MADT_ISO_POLARITY_LOW  0x3
+#define MADT_ISO_TRIGGER_MASK  0xC
+#define MADT_ISO_TRIGGER_EDGE  0x4
+#define MADT_ISO_TRIGGER_LEVEL 0xC
+
+typedef struct madt
+{
+    acpi_sdt_header_t header;
+    u32 lapic_address;
+    u32 flags;
+    u8 entries[];
+} __attribute__((packed)) madt_t;
+
+typedef struct madt_entry_header
+{
+    u8 type;
+    u8 length;
+} __attribute__((packed)) madt_entry_header_t;
+
+typedef struct madt_lapic
+{
+    madt_entry_header_t header;
+    u8 acpi_processor_id;
+    u8 apic_id;
+    u32 flags;
+} __attribute__((packed)) madt_lapic_t;
+
+typedef struct madt_ioapic
+{
+    madt_entry_header_t header;
+    u8 ioapic_id;
+    u8 reserved;
+    u32 address;
+    u32 gsi_base;
+} __attribute__((packed)) madt_ioapic_t;
+
+typedef struct madt_iso
+{
+    madt_entry_header_t header;
+    u8 bus;
+    u8 source;
+    u32 gsi;
+    u16 flags;
+} __attribute__((packed)) madt_iso_t;
+
+typedef struct madt_lapic_override
+{
+    madt_entry_header_t header;
+    u16 reserved;
+    u64 address;
+} __attribute__((packed)) madt_lapic_override_t;
+
+// parsed form, kept after the table walk
+
+typedef struct madt_cpu
+{
+    u8 apic_id;
+    u8 acpi_id;
+} madt_cpu_t;
+
+typedef struct madt_ioapic_info
+{
+    u8 id;
+    usize_ptr address;
+    u32 gsi_base;
+} madt_ioapic_info_t;
+
+typedef struct madt_override
+{
+    u8 source;
+    u32 gsi;
+    u16 flags;
+} madt_override_t;
+
+typedef struct madt_info
+{
+    bool present;
+    bool pcat_compat;
+
+    usize_ptr lapic_address;
+
+    u32 cpu_count;
+    madt_cpu_t cpus[MAX_CPUS];
+    // enabled CPUs beyond MAX_CPUS
+    u32 cpus_ignored;
+
+    u32 ioapic_count;
+    madt_ioapic_info_t ioapics[MADT_MAX_IOAPICS];
+
+    u32 override_count;
+    madt_override_t overrides[MADT_MAX_OVERRIDES];
+} madt_info_t;
+
+void madt_parse(madt_t* madt);
+
+// zeroed (present = false) when the firmware has no MADT
+const madt_info_t* madt_get_info();
+
+// GSI and MPS flags an ISA IRQ is wired to, identity if not overridden
+u32 madt_isa_to_gsi(u8 isa_irq, u16* flags);
+
+#endif // __MADT_H__
@@ -19,4 +19,9 @@ typedef struct xsdt
     acpi_sdt_header_t header;
     u64 pointer_sdts[]; // count (header.length - sizeof(header)) / 8
 } __attribute__((packed)) xsdt_t;
+
+// first table with a matching 4 char signature and a valid checksum
+acpi_sdt_header_t* find_sdt_by_rsdt(rsdt_t* rsdt, const char* signature);
+acpi_sdt_header_t* find_sdt_by_xsdt(xsdt_t* xsdt, const char* signature);
+
 #endif // __RSDT_H__
\ No newline at end of file
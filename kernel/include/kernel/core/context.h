@@ -0,0 +1,14 @@
+#ifndef __CONTEXT_H__
+#define __CONTEXT_H__
+
+#include "core/num_defs.h"
+
+// Saves the callee-saved registers on the current stack, stores the
+// stack pointer in *prev_sp and resumes the context saved at next_sp
+void context_switch(usize_ptr* prev_sp, usize_ptr next_sp);
+
+// Builds a fresh context on a new stack that starts executing entry
+// (entry must never return), returns the stack pointer to resume
+usize_ptr context_init_stack(void* stack_top, void (*entry)());
+
+#endif // __CONTEXT_H__
@@ -1,8 +1,20 @@
 #ifndef __CPU_H__
 #define __CPU_H__
 
+#include "core/num_defs.h"
+
+#define MAX_CPUS 8
+
 void cpu_init();
 void cpu_halt();
 void cpu_relax();
+// Enables interrupts and halts in one go (sti; hlt), returns after an irq
+void cpu_idle();
+
+// index of the executing CPU, always < MAX_CPUS
+u32 cpu_id();
+
+// free running cycle counter of the executing CPU, for profiling only
+u64 cpu_cycles();
 
 #endif // __CPU_H__
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef __PERCPU_H__
+#define __PERCPU_H__
+
+#include "core/num_defs.h"
+#include <core/atomic_defs.h>
+#include <arch/i386/core/percpu.h>
+
+// Per CPU variables start zeroed on every CPU, anything else has to be
+// set up at runtime by the CPU (or for it before it starts).
+#define PERCPU_SECTION __attribute__((section(".bss.percpu")))
+
+#define DEFINE_PER_CPU(type, name)  PERCPU_SECTION type name
+#define DECLARE_PER_CPU(type, name) extern type name
+
+// Accessors for 1, 2 and 4 byte variables, one instruction each, so an irq
+// on the same CPU can't tear them. A thread may still move CPUs between
+// two accesses, keep irqs disabled when several must hit the same CPU.
+#define this_cpu_read(var)         __percpu_read(var)
+#define this_cpu_write(var, value) __percpu_write(var, value)
+#define this_cpu_add(var, value)   __percpu_add(var, value)
+#define this_cpu_inc(var)          this_cpu_add(var, 1)
+
+// distance from the template to the executing CPU's copy
+DECLARE_PER_CPU(usize_ptr, percpu_offset);
+
+// Plain pointers to an instance, the executing CPU's one is only stable
+// while irqs are disabled
+#define this_cpu_ptr(var) \
+    ((__typeof__(&(var)))((u8*)&(var) + this_cpu_read(percpu_offset)))
+#define per_cpu_ptr(var, cpu) \
+    ((__typeof__(&(var)))((u8*)&(var) + percpu_offset_of(cpu)))
+
+usize_ptr percpu_offset_of(u32 cpu);
+
+// Zero filled per CPU storage carved from the template at runtime, never
+// freed. Access it through this_cpu_ptr/per_cpu_ptr like a static one.
+void* percpu_alloc(usize_ptr size, usize_ptr align);
+
+// Counter with a per CPU delta, folded into the shared value once it
+// reaches batch. Updates touch only the local CPU's cache line.
+typedef struct percpu_counter
+{
+    atom_i64 count;
+    i32 batch;
+    // per CPU storage, template address
+    i32* local;
+} percpu_counter_t;
+
+#define PERCPU_COUNTER_BATCH 32
+
+void percpu_counter_init(percpu_counter_t* counter, i64 value, i32 batch);
+void percpu_counter_add(percpu_counter_t* counter, i32 amount);
+// Folded value only, off by at most batch per CPU
+i64 percpu_counter_read(percpu_counter_t* counter);
+// Folded value plus every CPU's delta, walks all CPUs
+i64 percpu_counter_sum(percpu_counter_t* counter);
+
+#endif // __PERCPU_H__
@@ -0,0 +1,18 @@
+#ifndef __SMP_H__
+#define __SMP_H__
+
+#include "core/num_defs.h"
+#include <stdbool.h>
+
+// Starts every CPU the firmware lists, needs the heap, clock and scheduler.
+// Without a usable local APIC the kernel stays on the boot CPU.
+void init_smp();
+
+// CPUs that reached the scheduler, the boot CPU included
+u32 smp_cpu_count();
+bool smp_cpu_online(u32 cpu);
+
+// Makes cpu pass through schedule() soon, no-op for the calling CPU
+void smp_send_reschedule(u32 cpu);
+
+#endif // __SMP_H__
@@ -0,0 +1,31 @@
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#include "core/num_defs.h"
+
+typedef enum clock_source_type
+{
+    CLOCK_SOURCE_NONE = 0,
+    CLOCK_SOURCE_TSC,
+    CLOCK_SOURCE_ACPI_PM,
+    CLOCK_SOURCE_PIT,
+} clock_source_type_t;
+
+// Picks the best clocksource: invariant TSC (calibrated against the
+// PM timer), then the ACPI PM timer, then the PIT.
+// Must run after init_acpi() and init_int_timer_device()
+void init_clock();
+
+// Nanoseconds since init_clock(), never goes backwards
+u64 clock_monotonic_ns();
+
+clock_source_type_t clock_source();
+const char* clock_source_name();
+
+// Measured TSC frequency, 0 if the TSC is not the clocksource
+u64 clock_tsc_hz();
+
+// Busy waits, usable before interrupts are enabled
+void clock_spin_delay_ns(u64 ns);
+
+#endif // __CLOCK_H__
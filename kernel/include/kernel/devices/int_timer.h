@@ -2,6 +2,8 @@
 #define __INT_TIMER_H__
 
 #include "core/num_defs.h"
+#include <stdbool.h>
+
 typedef struct int_timer_event 
 {
     u64 timestamp_ns;
@@ -11,8 +13,27 @@ typedef struct int_timer_event
 
 typedef void (*int_timer_callback_t) (int_timer_event_t);
 
-// Uses the interval timer to get the current amount of time
+// called from the timer irq whenever the one-shot expires
+typedef void (*int_timer_handler_t) ();
+
+// Brings up the one-shot interval timer (clockevent)
+void init_int_timer_device();
+// Moves the clockevent to a per CPU timer if the hardware has one,
+// the global device keeps serving otherwise. Needs init_clock().
+bool init_int_timer_local();
+// Arms the calling CPU's own timer, every AP runs it once
+void int_timer_init_cpu();
+// True once each CPU has its own clockevent
+bool int_timer_per_cpu();
+
+void int_timer_set_handler(int_timer_handler_t handler);
+
+// Arms the calling CPU's one-shot delta_ns from now, clamped to the
+// hardware range
+void int_timer_program_ns(u64 delta_ns);
+u64 int_timer_max_delta_ns();
+
+// Periodic callback at hz, built on top of a kernel timer
 void init_int_timer(const u64 hz, int_timer_callback_t callback);
 u64 int_timer_now_ns();
-void pit_update_callback(int_timer_callback_t callback);
-#endif // __INT_TIMER_H__
\ No newline at end of file
+#endif // __INT_TIMER_H__
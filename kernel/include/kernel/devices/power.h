@@ -0,0 +1,12 @@
+#ifndef __POWER_H__
+#define __POWER_H__
+
+#include "core/num_defs.h"
+
+// Flushes the serial port and turns the machine off. Under QEMU with
+// -device isa-debug-exit,iobase=0xf4,iosize=0x04 the emulator exits with
+// status (exit_code << 1) | 1, otherwise the ACPI S5 ports QEMU and Bochs
+// use are tried. Halts forever if nothing took it.
+void power_off(u8 exit_code);
+
+#endif // __POWER_H__
@@ -0,0 +1,19 @@
+#ifndef __SERIAL_H__
+#define __SERIAL_H__
+
+#include "core/num_defs.h"
+#include <stdbool.h>
+
+#define SERIAL_DEFAULT_BAUD 115200
+
+// Brings up the primary serial port, false if no UART answered
+bool init_serial(u32 baud);
+
+bool serial_present();
+
+void serial_write(const char* data, usize_ptr size);
+
+// Blocks until every queued byte left the ring
+void serial_flush();
+
+#endif // __SERIAL_H__
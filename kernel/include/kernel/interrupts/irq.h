@@ -1,8 +1,49 @@
+#ifndef __KERNEL_IRQ_H__
+#define __KERNEL_IRQ_H__
+
 #include <core/defs.h>
 
 struct irq_frame;
 typedef struct irq_frame irq_frame_t;
 
+// returns true if the device on the line actually raised it
+typedef bool (*irq_handler_t)(irq_frame_t* frame, void* ctx);
+
+// one handler on a (possibly shared) vector, storage owned by the driver
+typedef struct irq_action
+{
+    irq_handler_t handler;
+    void* ctx;
+    const char* name;
+    struct irq_action* next;
+} irq_action_t;
+
+// interrupt controller operations, the core sends EOI after the chain
+typedef struct irq_chip
+{
+    const char* name;
+    void (*mask)(u32 vector);
+    void (*unmask)(u32 vector);
+    void (*eoi)(u32 vector);
+    // optional, true = drop the interrupt (handles its own EOI rules)
+    bool (*spurious)(u32 vector);
+    // optional, false if the line can't be steered to that CPU
+    bool (*set_affinity)(u32 vector, u32 cpu);
+} irq_chip_t;
+
+#define IRQ_HIST_BUCKETS 32
+
+// handler chain time in TSC cycles, hist[n] counts runs in [2^n, 2^(n+1))
+typedef struct irq_stats
+{
+    u64 count;
+    u64 unhandled;
+    u64 spurious;
+    u64 cycles_total;
+    u32 cycles_max;
+    u32 hist[IRQ_HIST_BUCKETS];
+} irq_stats_t;
+
 void irq_enable();
 void irq_disable();
 
@@ -11,9 +52,23 @@ bool irq_is_enabled();
 usize_ptr irq_save();
 void irq_restore(usize_ptr flags);
 
+// CPU exceptions/traps, single handler per vector
 void irq_register_handler(u32 vector, void (*handle)(irq_frame_t*));
-void irq_dispatch();
+
+// Hardware interrupts, appends to the vector's chain and unmasks it
+void irq_request(u32 vector, irq_action_t* action, irq_handler_t handler, void* ctx, const char* name);
+// Masks the vector again once the chain is empty
+void irq_release(u32 vector, irq_action_t* action);
+
+// Lines already requested are masked on the old chip and unmasked on the new
+void irq_set_chip(u32 first_vector, u32 count, irq_chip_t* chip);
+
+// Delivers the vector to cpu from now on, false if its chip can't
+bool irq_set_affinity(u32 vector, u32 cpu);
+
+const irq_stats_t* irq_get_stats(u32 vector);
+void irq_print_stats();
 
 usize_ptr irq_frame_get_error(irq_frame_t* frame);
 
-// callback = function called after
\ No newline at end of file
+#endif // __KERNEL_IRQ_H__
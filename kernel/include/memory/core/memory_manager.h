@@ -12,6 +12,11 @@ enum mm_alloc_type
     ALLOC_FRAME,
 };
 
+// One recursive lock over the heap, frame allocator, virtual regions and
+// kernel page tables; they call into each other in every direction.
+void mm_lock();
+void mm_unlock();
+
 void mm_ensure_memory(usize_ptr count);
 void mm_reclaim_memory(usize_ptr count);
 
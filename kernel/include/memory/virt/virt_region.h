@@ -19,6 +19,8 @@ enum virt_region_type
     VREGION_ACPI          ,
     VREGION_DRIVER        ,
     VREGION_BIO_BUFFER    ,
+    VREGION_STACK         ,
+    VREGION_PERCPU        ,
 };
 
 const char* vregion_to_str(enum virt_region_type region);
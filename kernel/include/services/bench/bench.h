@@ -0,0 +1,69 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "core/num_defs.h"
+#include "services/block/device.h"
+#include "vfs/core/mount.h"
+
+// Built with -DKERNEL_BENCH only (make bench). Every result is one JSON
+// object per line on the console, the serial log is grepped for them and
+// kept per commit.
+
+// what the benchmarks run against, either may be NULL
+typedef struct bench_env
+{
+    block_device_t* device;
+    vfs_mount_map_t* vfs;
+} bench_env_t;
+
+typedef struct bench
+{
+    const char* name;
+    void (*run)(const bench_env_t* env);
+} bench_t;
+
+typedef struct bench_timer
+{
+    u64 ns;
+    u64 cycles;
+} bench_timer_t;
+
+bench_timer_t bench_start();
+
+// Reports ops operations since start as case name of bench. param is what
+// the case ran at (size, pages, queue depth), bytes the data it moved;
+// either is 0 if it doesn't apply.
+void bench_stop(
+    const bench_timer_t* start,
+    const char* bench,
+    const char* name,
+    u64 param,
+    u64 ops,
+    u64 bytes
+);
+
+// xorshift32, the same sequence every run
+static inline u32 bench_rand(u32* state)
+{
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+void bench_skip(const char* bench, const char* reason);
+
+// Runs every registered benchmark, then powers the machine off
+void bench_run_all(const bench_env_t* env);
+
+// the registry
+void bench_heap(const bench_env_t* env);
+void bench_paging(const bench_env_t* env);
+void bench_hash(const bench_env_t* env);
+void bench_block(const bench_env_t* env);
+void bench_vfs(const bench_env_t* env);
+
+#endif // __BENCH_H__
@@ -34,6 +34,9 @@ typedef struct block_request
     block_request_cb cb;
     void* ctx;
 
+    // for the device layer to queue it on
+    struct block_request* next;
+
 } block_request_t;
 
 typedef void (*fn_block_submit_t)(
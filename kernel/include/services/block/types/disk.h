@@ -2,14 +2,34 @@
 #define __BLOCK_DISK_H__
 
 #include "drivers/storage.h"
-#include "utils/data_structs/ring_queue.h"
+#include "utils/data_structs/mpmc_ring.h"
+#include "services/threads/locks/spinlock.h"
+#include "services/threads/workqueue.h"
+#include "services/threads/wait_queue.h"
+
+#define BLOCK_DISK_QUEUE_CAPACITY 256
 
 typedef struct block_device block_device_t;
 
 typedef struct block_dev_disk
 {
     stor_device_t* hw_device;
-    ring_queue_t queue;
+
+    // requests waiting for a hardware slot, pushed by any submitter and
+    // popped by whoever finds a slot free (submit or completion path)
+    mpmc_ring_t queue;
+    // requests handed to hw_device, at most its max_requests
+    atom_u32 in_flight;
+
+    // Requests that found the queue full, in order. overflow_work feeds
+    // them in as completions make room, later submits line up behind.
+    spinlock_t overflow_lock;
+    struct block_request* overflow_head;
+    struct block_request** overflow_tail;
+    atom_u32 overflow_count;
+    work_t overflow_work;
+    // overflow_work sleeps here while the queue is full, completions wake it
+    wait_queue_t overflow_room;
 
 } block_dev_disk_t;
 
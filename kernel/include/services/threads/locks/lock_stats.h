@@ -0,0 +1,68 @@
+#ifndef __LOCK_STATS_H__
+#define __LOCK_STATS_H__
+
+#include "core/num_defs.h"
+#include "kernel/core/cpu.h"
+
+// Per lock contention counters, only updated when built with LOCK_STATS.
+// Written by the holder right after acquiring, so plain fields are enough.
+typedef struct lock_stats
+{
+    u64 acquisitions;
+    // acquisitions that found the lock taken
+    u64 contended;
+    // cycles spent waiting (spinning or asleep) across all contended
+    // acquisitions
+    u64 spin_cycles;
+    u64 max_spin_cycles;
+
+    // exclusive holds only, shared (reader) holds are not timed
+    u64 hold_cycles;
+    u64 max_hold_cycles;
+    u64 hold_start;
+} lock_stats_t;
+
+static inline void lock_stats_reset(lock_stats_t* stats)
+{
+    stats->acquisitions = 0;
+    stats->contended = 0;
+    stats->spin_cycles = 0;
+    stats->max_spin_cycles = 0;
+    stats->hold_cycles = 0;
+    stats->max_hold_cycles = 0;
+    stats->hold_start = 0;
+}
+
+// holder only
+static inline void lock_stats_record(lock_stats_t* stats, u64 spin_cycles)
+{
+    stats->acquisitions++;
+
+    if (spin_cycles)
+    {
+        stats->contended++;
+        stats->spin_cycles += spin_cycles;
+
+        if (spin_cycles > stats->max_spin_cycles)
+        {
+            stats->max_spin_cycles = spin_cycles;
+        }
+    }
+
+    stats->hold_start = cpu_cycles();
+}
+
+// holder only, right before it lets go
+static inline void lock_stats_record_release(lock_stats_t* stats)
+{
+    u64 held = cpu_cycles() - stats->hold_start;
+
+    stats->hold_cycles += held;
+
+    if (held > stats->max_hold_cycles)
+    {
+        stats->max_hold_cycles = held;
+    }
+}
+
+#endif // __LOCK_STATS_H__
@@ -0,0 +1,39 @@
+#ifndef __MCS_LOCK_H__
+#define __MCS_LOCK_H__
+
+#include "core/atomic_defs.h"
+#include "services/threads/locks/lock_stats.h"
+
+// One per acquisition, usually on the caller's stack. Each waiter spins
+// on its own node, so a handoff only touches the next waiter's line.
+typedef struct mcs_node
+{
+    struct mcs_node* _Atomic next;
+    atom_bool locked;
+    uptr irq_data;
+} mcs_node_t;
+
+// Queue lock for heavily contended paths, FIFO like the ticket spinlock.
+// Zero filled is unlocked.
+typedef struct mcs_lock
+{
+    mcs_node_t* _Atomic tail;
+
+#ifdef LOCK_STATS
+    lock_stats_t stats;
+#endif
+} mcs_lock_t;
+
+void mcs_lock_init(mcs_lock_t* lock);
+
+// node must stay alive until the matching mcs_unlock
+void mcs_lock(mcs_lock_t* lock, mcs_node_t* node);
+bool mcs_try_lock(mcs_lock_t* lock, mcs_node_t* node);
+void mcs_unlock(mcs_lock_t* lock, mcs_node_t* node);
+
+bool mcs_is_locked(mcs_lock_t* lock);
+
+// NULL unless built with LOCK_STATS
+const lock_stats_t* mcs_get_stats(mcs_lock_t* lock);
+
+#endif // __MCS_LOCK_H__
@@ -0,0 +1,40 @@
+#ifndef __MUTEX_H__
+#define __MUTEX_H__
+
+#include "core/atomic_defs.h"
+#include "services/threads/locks/lock_stats.h"
+#include "services/threads/wait_queue.h"
+
+// Sleeping lock for long holds, interrupts stay enabled while it is held.
+// Thread context only, never from irqs or with a spinlock held.
+typedef struct mutex
+{
+    // MUTEX_UNLOCKED, MUTEX_LOCKED or MUTEX_CONTENDED
+    atom_u32 state;
+
+    wait_queue_t wait;
+
+#ifdef LOCK_STATS
+    lock_stats_t stats;
+#endif
+} mutex_t;
+
+#define MUTEX_UNLOCKED  0
+#define MUTEX_LOCKED    1
+// locked, and someone may be asleep on it
+#define MUTEX_CONTENDED 2
+
+void mutex_init(mutex_t* mutex);
+
+// With more than one CPU, polls the lock a bounded number of times
+// (MUTEX_SPIN_LIMIT) before sleeping, the owner is not tracked
+void mutex_lock(mutex_t* mutex);
+bool mutex_try_lock(mutex_t* mutex);
+void mutex_unlock(mutex_t* mutex);
+
+bool mutex_is_locked(mutex_t* mutex);
+
+// NULL unless built with LOCK_STATS
+const lock_stats_t* mutex_get_stats(mutex_t* mutex);
+
+#endif // __MUTEX_H__
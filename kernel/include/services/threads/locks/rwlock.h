@@ -0,0 +1,41 @@
+#ifndef __RWLOCK_H__
+#define __RWLOCK_H__
+
+#include "core/atomic_defs.h"
+#include "services/threads/locks/lock_stats.h"
+
+// Spinning reader-writer lock, usable from irq context. Interrupts are off
+// while it is held like with spinlock_t, so keep the sections short.
+// A waiting writer holds back new readers.
+// Zero filled is unlocked.
+typedef struct rwlock
+{
+    // reader count plus the RWLOCK_WRITER/RWLOCK_WRITER_WAITING bits
+    atom_u32 value;
+
+    // the writer's saved irq state, readers keep theirs
+    uptr irq_data;
+
+#ifdef LOCK_STATS
+    // writer side only
+    lock_stats_t stats;
+#endif
+} rwlock_t;
+
+#define RWLOCK_WRITER         (1u << 31)
+#define RWLOCK_WRITER_WAITING (1u << 30)
+
+void rwlock_init(rwlock_t* lock);
+
+// Returns the irq state for the matching unlock
+uptr rwlock_read_lock(rwlock_t* lock);
+void rwlock_read_unlock(rwlock_t* lock, uptr irq_state);
+
+void rwlock_write_lock(rwlock_t* lock);
+bool rwlock_write_try_lock(rwlock_t* lock);
+void rwlock_write_unlock(rwlock_t* lock);
+
+// NULL unless built with LOCK_STATS
+const lock_stats_t* rwlock_get_stats(rwlock_t* lock);
+
+#endif // __RWLOCK_H__
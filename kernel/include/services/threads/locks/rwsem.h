@@ -0,0 +1,43 @@
+#ifndef __RWSEM_H__
+#define __RWSEM_H__
+
+#include "core/atomic_defs.h"
+#include "services/threads/locks/lock_stats.h"
+#include "services/threads/wait_queue.h"
+
+// Sleeping reader-writer lock for read-mostly data. Readers share it with
+// a single atomic add, a writer waits for them to drain. Waiting writers
+// hold back new readers, so a stream of readers can't starve them.
+// Thread context only, interrupts stay enabled while it is held.
+typedef struct rw_semaphore
+{
+    // reader count, RWSEM_WRITER while a writer holds it
+    atom_u32 count;
+    // writers asleep or about to sleep
+    atom_u32 writers_waiting;
+
+    wait_queue_t read_wait;
+    wait_queue_t write_wait;
+
+#ifdef LOCK_STATS
+    // writer side only
+    lock_stats_t stats;
+#endif
+} rw_semaphore_t;
+
+#define RWSEM_WRITER (1u << 31)
+
+void rwsem_init(rw_semaphore_t* sem);
+
+void rwsem_read_lock(rw_semaphore_t* sem);
+bool rwsem_read_try_lock(rw_semaphore_t* sem);
+void rwsem_read_unlock(rw_semaphore_t* sem);
+
+void rwsem_write_lock(rw_semaphore_t* sem);
+bool rwsem_write_try_lock(rw_semaphore_t* sem);
+void rwsem_write_unlock(rw_semaphore_t* sem);
+
+// NULL unless built with LOCK_STATS
+const lock_stats_t* rwsem_get_stats(rw_semaphore_t* sem);
+
+#endif // __RWSEM_H__
@@ -1,9 +1,30 @@
+#ifndef __SPINLOCK_H__
+#define __SPINLOCK_H__
+
 #include "core/atomic_defs.h"
+#include "services/threads/locks/lock_stats.h"
 
+// Ticket lock, callers get the lock in the order they asked for it.
+// Zero filled is unlocked, so static and copied locks stay valid.
 typedef struct spinlock
 {
-    atom_bool locked;
+    union
+    {
+        // both halves, for try_lock's single compare exchange
+        atom_u32 ticket;
+        struct
+        {
+            // little endian, owner is the low half
+            atom_u16 owner;
+            atom_u16 next;
+        };
+    };
+
     uptr irq_data;
+
+#ifdef LOCK_STATS
+    lock_stats_t stats;
+#endif
 } spinlock_t;
 
 void spinlock_initlock(spinlock_t* lock, bool start_locked);
@@ -15,3 +36,9 @@ bool spinlock_try_lock(spinlock_t* lock);
 bool spinlock_is_locked(spinlock_t* lock);
 
 void spinlock_unlock(spinlock_t* lock);
+
+// NULL unless built with LOCK_STATS
+const lock_stats_t* spinlock_get_stats(spinlock_t* lock);
+void spinlock_reset_stats(spinlock_t* lock);
+
+#endif // __SPINLOCK_H__
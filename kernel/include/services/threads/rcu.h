@@ -0,0 +1,75 @@
+#ifndef __RCU_H__
+#define __RCU_H__
+
+#include <core/defs.h>
+#include <core/atomic_defs.h>
+#include <kernel/core/percpu.h>
+#include <kernel/interrupts/irq.h>
+
+// Read-copy-update. Readers take no lock and never write shared memory,
+// writers publish new versions with rcu_assign_pointer and free the old
+// ones once every CPU passed a quiescent state (a grace period).
+//
+// Read sections run with irqs disabled and must not sleep, so a CPU is
+// quiescent whenever it takes an interrupt, switches threads or idles.
+
+struct rcu_head;
+typedef void (*rcu_callback_t)(struct rcu_head* head);
+
+// embedded in the object to free, storage owned by the caller
+typedef struct rcu_head
+{
+    struct rcu_head* next;
+    rcu_callback_t fn;
+} rcu_head_t;
+
+DECLARE_PER_CPU(u32, rcu_nesting);
+DECLARE_PER_CPU(usize_ptr, rcu_irq_flags);
+
+static inline void rcu_read_lock()
+{
+    usize_ptr irq_flags = irq_save();
+
+    if (this_cpu_read(rcu_nesting) == 0)
+    {
+        this_cpu_write(rcu_irq_flags, irq_flags);
+    }
+    this_cpu_inc(rcu_nesting);
+}
+
+static inline void rcu_read_unlock()
+{
+    this_cpu_add(rcu_nesting, -1);
+
+    if (this_cpu_read(rcu_nesting) == 0)
+    {
+        irq_restore(this_cpu_read(rcu_irq_flags));
+    }
+}
+
+static inline bool rcu_read_lock_held()
+{
+    return this_cpu_read(rcu_nesting) != 0;
+}
+
+// Pointer loads and stores of RCU protected data, the load sees the
+// pointed to object fully initialized by the matching store
+#define rcu_dereference(p)          __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define rcu_assign_pointer(p, v)    __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+// Queues the callbacks that were waiting for init_workqueue(), needs it
+void init_rcu();
+
+// Returns once every read section that started before the call ended.
+// Threads yield while waiting, not from a read section.
+void synchronize_rcu();
+
+// Runs fn(head) on a worker after a grace period, safe from any context
+// including read sections and irqs
+void call_rcu(rcu_head_t* head, rcu_callback_t fn);
+
+// Reports this CPU quiescent, called by the irq exit, scheduler and idle
+// paths (never inside a read section)
+void rcu_note_qs();
+
+#endif // __RCU_H__
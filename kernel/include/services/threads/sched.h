@@ -0,0 +1,116 @@
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+#include <core/defs.h>
+#include <services/threads/locks/spinlock.h>
+#include <services/time/timer.h>
+
+// 16KiB kernel stacks
+#define THREAD_STACK_PAGES 4
+
+// preemption quantum while other threads are runnable
+#define SCHED_SLICE_NS 10000000ULL
+
+typedef enum thread_state
+{
+    THREAD_READY,
+    THREAD_RUNNING,
+    THREAD_BLOCKED,
+    THREAD_DEAD,
+} thread_state_t;
+
+typedef void (*thread_fn_t)(void* arg);
+
+typedef struct thread
+{
+    // saved by context_switch, must stay first
+    usize_ptr sp;
+
+    void* stack;
+
+    u32 id;
+    const char* name;
+    thread_state_t state;
+    // still on its CPU's stack, cleared once the switch away completes
+    atom_bool on_cpu;
+
+    // run queue the thread belongs to
+    u32 cpu;
+    // never stolen by another CPU
+    bool pinned;
+
+    // run queue links, a blocked thread may reuse next for its wait queue
+    struct thread* next;
+    struct thread* prev;
+
+    thread_fn_t fn;
+    void* arg;
+
+    u64 runtime_ns;
+    u64 switched_in_ns;
+} thread_t;
+
+// per CPU run queue, FIFO, owner pops the head and thieves take the tail
+typedef struct run_queue
+{
+    spinlock_t lock;
+    u32 cpu;
+
+    thread_t* head;
+    thread_t* tail;
+    atom_u32 count;
+
+    thread_t* current;
+    // boot flow of the CPU, runs when nothing else is ready
+    thread_t* idle;
+
+    thread_t* dead;
+    // previous thread of the last switch, finish_switch releases it
+    thread_t* switched_from;
+
+    ktimer_t slice_timer;
+    bool need_resched;
+    u64 switches;
+} run_queue_t;
+
+// Turns the calling flow into this CPU's idle thread, needs the heap and timers
+void init_sched();
+// Same for an AP, once its own irq and timer state is up
+void sched_init_cpu();
+bool sched_ready();
+
+// Starts on the least loaded CPU, idle CPUs may steal it later
+thread_t* thread_create(const char* name, thread_fn_t fn, void* arg);
+// Runs on cpu only, for per CPU service threads
+thread_t* thread_create_on(u32 cpu, const char* name, thread_fn_t fn, void* arg);
+void thread_yield();
+__attribute__((noreturn)) void thread_exit();
+
+thread_t* thread_current();
+
+// Picks the next thread and switches to it, current thread state must
+// already be set (READY/RUNNING requeue it, BLOCKED/DEAD don't)
+void schedule();
+
+// BLOCKED -> READY on its run queue, safe from irq context
+void sched_wake(thread_t* thread);
+
+// False for the idle thread and before init_sched, those can't sleep
+bool sched_can_block();
+
+// Marks the current thread BLOCKED without switching yet, a sched_wake
+// between this and schedule() is not lost
+void sched_block_prepare();
+// Undoes sched_block_prepare when the wait ended without sleeping
+void sched_block_cancel();
+
+// Makes this CPU reschedule on its next irq exit, for the reschedule IPI
+void sched_request_resched();
+
+// Preempts on the way out of an interrupt if a reschedule is pending
+void sched_irq_exit();
+
+// Idle loop for the boot flow, halts until a thread becomes ready
+__attribute__((noreturn)) void sched_idle();
+
+#endif // __SCHED_H__
@@ -0,0 +1,55 @@
+#ifndef __SOFTIRQ_H__
+#define __SOFTIRQ_H__
+
+#include <core/defs.h>
+
+// lower number runs first
+typedef enum softirq_type
+{
+    SOFTIRQ_TASKLET = 0,
+
+    SOFTIRQ_COUNT,
+} softirq_type_t;
+
+typedef void (*softirq_fn_t)();
+
+typedef void (*tasklet_fn_t)(void* ctx);
+
+// deferred work item, storage owned by the caller
+typedef struct tasklet
+{
+    struct tasklet* next;
+    tasklet_fn_t fn;
+    void* ctx;
+    // set while queued, a second schedule before it runs is a no-op
+    atom_bool scheduled;
+    // set while fn runs, another CPU finding it set queues it again
+    // rather than run it alongside
+    atom_bool running;
+} tasklet_t;
+
+void init_softirq();
+
+void softirq_register(softirq_type_t type, softirq_fn_t fn);
+
+// Marks type pending on this CPU, safe from hard irq context
+void softirq_raise(softirq_type_t type);
+
+// Runs pending softirqs with interrupts enabled, called by the irq
+// core on the way out of the outermost hardware interrupt
+void softirq_irq_exit();
+
+// Softirqs raised on this CPU that haven't run yet
+bool softirq_pending();
+
+// Runs them outside an irq, for a CPU about to idle. Must be entered
+// with interrupts disabled, leaves them disabled.
+void softirq_run_pending();
+
+bool softirq_in_progress();
+
+void tasklet_init(tasklet_t* tasklet, tasklet_fn_t fn, void* ctx);
+// Queues the tasklet on this CPU, it runs once after the current irq
+void tasklet_schedule(tasklet_t* tasklet);
+
+#endif // __SOFTIRQ_H__
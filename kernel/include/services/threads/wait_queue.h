@@ -0,0 +1,81 @@
+#ifndef __WAIT_QUEUE_H__
+#define __WAIT_QUEUE_H__
+
+#include <core/defs.h>
+#include <services/threads/locks/spinlock.h>
+
+struct thread;
+
+// one sleeper, lives on the waiting thread's stack
+typedef struct wait_entry
+{
+    struct thread* thread;
+    struct wait_entry* next;
+    struct wait_entry** pprev;
+} wait_entry_t;
+
+// FIFO of sleeping threads, woken from any context including irqs
+typedef struct wait_queue
+{
+    spinlock_t lock;
+
+    wait_entry_t* head;
+    wait_entry_t** tail;
+} wait_queue_t;
+
+// counts complete() calls, each one releases a single waiter
+typedef struct completion
+{
+    // under wait.lock
+    u32 done;
+    wait_queue_t wait;
+} completion_t;
+
+void wait_queue_init(wait_queue_t* queue);
+
+// Interrupts are disabled between wait_begin and wait_end, so a condition
+// checked in between can't miss an irq that sets it on this CPU.
+// Without a thread to put to sleep (no scheduler yet, or the idle thread)
+// wait_sleep falls back to sti;hlt until the next interrupt.
+usize_ptr wait_begin(wait_queue_t* queue, wait_entry_t* entry);
+void wait_prepare(wait_queue_t* queue, wait_entry_t* entry);
+void wait_sleep(wait_queue_t* queue, wait_entry_t* entry);
+void wait_end(wait_queue_t* queue, wait_entry_t* entry, usize_ptr irq_flags);
+
+// Sleeps on queue until condition is true, condition is re-evaluated
+// after every wakeup
+#define wait_event(queue, condition)                                 \
+    do                                                               \
+    {                                                                \
+        wait_entry_t __wait_entry;                                   \
+        usize_ptr __wait_flags = wait_begin((queue), &__wait_entry); \
+        while (true)                                                 \
+        {                                                            \
+            wait_prepare((queue), &__wait_entry);                    \
+            if (condition)                                           \
+            {                                                        \
+                break;                                               \
+            }                                                        \
+            wait_sleep((queue), &__wait_entry);                      \
+        }                                                            \
+        wait_end((queue), &__wait_entry, __wait_flags);              \
+    } while (0)
+
+// Returns true if a sleeper was woken
+bool wake_up_one(wait_queue_t* queue);
+// Returns the number of sleepers woken
+u32 wake_up_all(wait_queue_t* queue);
+
+void completion_init(completion_t* completion);
+
+// Sleeps until a complete() that no other waiter consumed
+void wait_for_completion(completion_t* completion);
+// Consumes a pending complete() without sleeping
+bool try_wait_for_completion(completion_t* completion);
+
+// Safe from irq and softirq context
+void complete(completion_t* completion);
+// Releases every current and future waiter
+void complete_all(completion_t* completion);
+
+#endif // __WAIT_QUEUE_H__
@@ -0,0 +1,50 @@
+#ifndef __WORKQUEUE_H__
+#define __WORKQUEUE_H__
+
+#include <core/defs.h>
+#include <core/atomic_defs.h>
+
+// per CPU deque slots, power of 2, a full deque spills to a shared list
+#define WORK_DEQUE_SIZE 256
+
+struct work;
+typedef void (*work_fn_t)(struct work* work);
+
+// storage owned by the submitter, must stay valid until flush_work returns
+// (or the work ran, if nobody flushes it)
+typedef struct work
+{
+    work_fn_t fn;
+    void* ctx;
+
+    // queued and not yet picked up
+    atom_bool pending;
+    // instances currently inside fn
+    atom_u32 running;
+
+    // overflow list link
+    struct work* next;
+} work_t;
+
+// index range of a parallel_for chunk, [start, end)
+typedef void (*parallel_for_fn_t)(u32 start, u32 end, void* ctx);
+
+// Starts one pinned worker per online CPU, needs init_smp()
+void init_workqueue();
+
+void work_init(work_t* work, work_fn_t fn, void* ctx);
+
+// Queues on the calling CPU's deque, idle workers on any CPU steal it.
+// False if it was already pending. Safe from irq context.
+bool queue_work(work_t* work);
+
+// Returns once work is neither pending nor running. Threads sleep,
+// contexts that can't (boot flow, idle) run queued work meanwhile.
+void flush_work(work_t* work);
+bool work_busy(work_t* work);
+
+// Calls fn over [0, count) in chunks of at most grain indices, spread over
+// the workers and the caller, returns when every chunk is done
+void parallel_for(u32 count, u32 grain, parallel_for_fn_t fn, void* ctx);
+
+#endif // __WORKQUEUE_H__
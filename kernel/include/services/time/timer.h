@@ -0,0 +1,59 @@
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include <core/defs.h>
+
+// wheel granularity, 2^20 ns ~= 1.05ms per tick
+#define KTIMER_TICK_SHIFT 20
+
+#define KTIMER_LEVEL_BITS  6
+#define KTIMER_LEVEL_SLOTS (1 << KTIMER_LEVEL_BITS)
+#define KTIMER_LEVEL_MASK  (KTIMER_LEVEL_SLOTS - 1)
+#define KTIMER_LEVELS      4
+
+// longest the hardware stays unarmed even with no timers pending,
+// keeps narrow clocksources (24 bit PM timer) from wrapping unseen
+#define KTIMER_MAX_IDLE_NS 1000000000ULL
+
+struct ktimer;
+typedef void (*ktimer_fn_t)(struct ktimer* timer, void* ctx);
+
+typedef struct ktimer
+{
+    // slot list links, pprev == NULL when not queued
+    struct ktimer* next;
+    struct ktimer** pprev;
+
+    u64 expires_ns;
+    // 0 = one-shot
+    u64 period_ns;
+
+    ktimer_fn_t fn;
+    void* ctx;
+
+    u8 level;
+    u8 slot;
+    // wheel it is (or was last) queued on
+    u8 cpu;
+} ktimer_t;
+
+// Hooks the timer core to the interval timer, needs init_clock()
+void init_timers();
+// Gives the calling CPU its own wheel on its own clockevent, after
+// int_timer_init_cpu(). Timers it starts from then on fire on it.
+// No-op while the clockevent is global.
+void ktimer_init_cpu();
+
+void ktimer_init(ktimer_t* timer, ktimer_fn_t fn, void* ctx);
+
+// Arms (or re-arms) timer at an absolute clock_monotonic_ns() time
+void ktimer_start(ktimer_t* timer, u64 expires_ns);
+void ktimer_start_in(ktimer_t* timer, u64 delay_ns);
+// First expiry one period from now, then every period_ns
+void ktimer_start_periodic(ktimer_t* timer, u64 period_ns);
+
+// True if the timer was pending
+bool ktimer_cancel(ktimer_t* timer);
+bool ktimer_pending(ktimer_t* timer);
+
+#endif // __TIMER_H__
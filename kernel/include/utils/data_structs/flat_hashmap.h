@@ -2,6 +2,7 @@
 #define __UTILS_FLAT_HASHMAP_H__
 
 #include "core/num_defs.h"
+#include "core/atomic_defs.h"
 #include <stdbool.h>
 
 typedef struct flat_hashmap_result
@@ -10,25 +11,39 @@ typedef struct flat_hashmap_result
     bool succeed;
 } flat_hashmap_result_t;
 
+// Copied keys up to this size live in the slot itself, longer ones on the
+// heap. Override at build time, every slot pays for it.
+#ifndef FHASHMAP_INLINE_KEY_SIZE
+#define FHASHMAP_INLINE_KEY_SIZE 24
+#endif
+
+// Slot payload, whether it is in use lives in the control byte
 typedef struct flat_hashmap_entry
 {
-    u64 hash;
-
-    void* key_data;
-    u64 key_length;
-
+    union
+    {
+        void* key_data;
+        u8 inline_key[FHASHMAP_INLINE_KEY_SIZE];
+    };
     void* data;
 
-    u8 state;
+    // low half of the hash, picks the probe start and the control tag
+    u32 hash;
+    u32 key_length;
 
-    u8 flags; // is key allocted here
+    u8 flags; // is key allocted here, or inline
 } flat_hashmap_entry_t;
 
 typedef u64 (*fmap_hash_func)(const u8* data, u64 length);
 typedef void (*fmap_destroy_cb_func)(void* data, void* key_data, usize_ptr key_length);
 
+// Swiss table: one control byte per slot (empty, deleted or a 7 bit hash
+// tag) next to the entries. Probing compares a whole group of control
+// bytes at once and only touches entries whose tag matched.
 typedef struct flat_hashmap
 {
+    // capacity control bytes, entries follows in the same allocation
+    u8* ctrl;
     flat_hashmap_entry_t* entries;
 
     u64 empty_count;
@@ -40,6 +55,20 @@ typedef struct flat_hashmap
     fmap_hash_func hash;
     fmap_destroy_cb_func destroy_cb;
 
+    // table being drained into ctrl/entries by a rehash, NULL otherwise.
+    // Each insert moves a few of its slots, lookups probe both tables.
+    u8* old_ctrl;
+    flat_hashmap_entry_t* old_entries;
+    u64 old_capacity;
+    u64 old_used_count;
+    // next old slot to move
+    u64 migrate_pos;
+
+    // RCU mode, see fhashmap_set_rcu
+    bool rcu;
+    // odd while the table pointers and capacities are being replaced
+    atom_u32 table_seq;
+
 } flat_hashmap_t;
 
 flat_hashmap_t init_fhashmap             (void);
@@ -49,8 +78,16 @@ flat_hashmap_t init_fhashmap_destroy_hash(fmap_hash_func hash, fmap_destroy_cb_f
 flat_hashmap_t init_fhashmap_destroy     (fmap_destroy_cb_func destroy_cb);
 flat_hashmap_t init_fhashmap_hash        (fmap_hash_func hash);
 
+// RCU mode, set on a fresh map before it is shared. fhashmap_get_data may
+// then run inside rcu_read_lock concurrently with one writer (writers still
+// serialize among themselves). Replaced tables, deleted keys and destroy_cb
+// run after a grace period, tombstones are only dropped by a rehash.
+void fhashmap_set_rcu(flat_hashmap_t* hashmap);
+
+// live entries across both tables
+u64 fhashmap_count(flat_hashmap_t* hashmap);
 
-#define FHASHMAP_INS_FLAG_KEY_COPY   (1<<0)  // hashmap allocates + copies key
+#define FHASHMAP_INS_FLAG_KEY_COPY   (1<<0)  // hashmap copies key (inline or allocated)
 #define FHASHMAP_INS_FLAG_OVERWRITE  (1<<1)  // overwrite value if key already exists
 
 isize_ptr fhashmap_insert(flat_hashmap_t* hashmap, void* key_data, u64 key_length, void* data, u8 flags);
@@ -0,0 +1,49 @@
+#ifndef __UTILS_MPMC_RING_H__
+#define __UTILS_MPMC_RING_H__
+
+#include <stdbool.h>
+#include "core/defs.h"
+
+// one slot, seq says whose turn it is: == pos when free for the producer
+// that claims pos, == pos + 1 once that item is in for the consumer
+typedef struct mpmc_ring_cell
+{
+    atom_usize_ptr seq;
+    void* item;
+} mpmc_ring_cell_t;
+
+// Fixed capacity, lock free ring of non NULL pointers for any number of
+// producers and consumers (Vyukov's bounded queue). Safe from irq context,
+// a side never waits on another, it only retries a lost claim.
+typedef struct mpmc_ring
+{
+    atom_usize_ptr enqueue_pos CACHE_ALIGNED;
+    atom_usize_ptr dequeue_pos CACHE_ALIGNED;
+
+    mpmc_ring_cell_t* cells CACHE_ALIGNED;
+    usize_ptr mask;
+} mpmc_ring_t;
+
+// capacity = 2^n
+void mpmc_ring_init(mpmc_ring_t* ring, usize_ptr capacity);
+void mpmc_ring_free(mpmc_ring_t* ring);
+
+// False when full
+bool mpmc_ring_push(mpmc_ring_t* ring, void* item);
+// Claims as many consecutive free slots as it can (up to count) in one
+// go and fills them with the head of items; returns how many went in.
+usize_ptr mpmc_ring_push_batch(mpmc_ring_t* ring, void* const* items, usize_ptr count);
+
+// NULL when empty
+void* mpmc_ring_pop(mpmc_ring_t* ring);
+// Claims up to max_count consecutive ready items in one go, returns how many
+usize_ptr mpmc_ring_pop_batch(mpmc_ring_t* ring, void** items, usize_ptr max_count);
+
+// A snapshot, may be stale by the time it returns. Counts slots producers
+// claimed but are still filling.
+usize_ptr mpmc_ring_count(mpmc_ring_t* ring);
+// True if a pop right now would find nothing ready, never waits for a
+// producer that is mid push
+bool mpmc_ring_is_empty(mpmc_ring_t* ring);
+
+#endif // __UTILS_MPMC_RING_H__
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include "core/num_defs.h"
+#include "core/defs.h"
 
 typedef struct __attribute__((aligned(sizeof(usize_ptr)))) rb_node {
 
@@ -21,9 +22,17 @@ typedef struct rb_tree
 	rb_node_t* root;
 	rb_cmp_t cmp;
 	rb_augment_t augment;
+
+	// first and last node, only kept up by rb_init_tree_cached trees
+	rb_node_t* leftmost;
+	rb_node_t* rightmost;
+	bool cached;
 } rb_tree_t;
 
 void rb_init_tree(rb_tree_t *tree, rb_cmp_t cmp, rb_augment_t augment);
+// Same, but rb_min / rb_max are O(1) for a pointer compare per insert and
+// an rb_next / rb_prev when an end is removed
+void rb_init_tree_cached(rb_tree_t *tree, rb_cmp_t cmp, rb_augment_t augment);
 
 static inline bool rb_empty(const rb_tree_t *tree) { return tree->root == NULL; }
 
@@ -32,6 +41,11 @@ rb_node_t* rb_remove_key (rb_tree_t* tree, rb_node_t* key);
 rb_node_t* rb_remove_node(rb_tree_t* tree, rb_node_t* node);
 rb_node_t* rb_search     (rb_tree_t* tree, rb_node_t* key);
 
+// Links node at *link under parent, as found by a descent that ended on
+// an empty link, then rebalances. For callers searching with their own
+// comparator (see RB_DEFINE_TYPED).
+void rb_insert_linked(rb_tree_t* tree, rb_node_t* node, rb_node_t* parent, rb_node_t** link);
+
 void rb_free_tree(rb_tree_t* tree, rb_free_t free_callback);
 
 rb_node_t* rb_min (rb_tree_t* tree);
@@ -44,4 +58,168 @@ rb_node_t* rb_upper_bound(rb_tree_t* tree, rb_node_t* key);
 
 #define rb_for_each(tree, node) for (node = rb_min(tree); node; node = rb_next(node))
 
+// In order walk that keeps the successor ahead of the current node, so the
+// current node may be removed (not the next one). A whole walk crosses each
+// edge twice, so advancing is O(1) amortized.
+typedef struct rb_iter
+{
+	rb_node_t* node;
+	rb_node_t* next;
+} rb_iter_t;
+
+static inline rb_node_t* rb_iter_at(rb_iter_t* iter, rb_node_t* node)
+{
+	iter->node = node;
+	iter->next = node ? rb_next(node) : NULL;
+
+	return node;
+}
+
+static inline rb_node_t* rb_iter_first(rb_tree_t* tree, rb_iter_t* iter)
+{
+	return rb_iter_at(iter, rb_min(tree));
+}
+
+// Starts at the first node not ordered before key
+static inline rb_node_t* rb_iter_from(rb_tree_t* tree, rb_iter_t* iter, rb_node_t* key)
+{
+	return rb_iter_at(iter, rb_lower_bound(tree, key));
+}
+
+static inline rb_node_t* rb_iter_next(rb_iter_t* iter)
+{
+	return rb_iter_at(iter, iter->next);
+}
+
+#define rb_for_each_safe(tree, iter, node) \
+	for (node = rb_iter_first(tree, iter); node; node = rb_iter_next(iter))
+
+// Generates name_* wrappers for a tree of `type` linked through `member`.
+// cmp(const type* a, const type* b) is called directly, so it inlines into
+// the descents instead of going through tree->cmp; name_cmp_nodes is the
+// rb_cmp_t to init the tree with, for the generic calls still made on it.
+#define RB_DEFINE_TYPED(name, type, member, cmp)                                \
+                                                                                \
+static inline type* name##_entry(rb_node_t* node)                               \
+{                                                                               \
+	return node ? container_of(node, type, member) : NULL;                      \
+}                                                                               \
+                                                                                \
+static inline isize_ptr name##_cmp_nodes(const rb_node_t* a, const rb_node_t* b)\
+{                                                                               \
+	return cmp(container_of(a, const type, member),                             \
+	           container_of(b, const type, member));                            \
+}                                                                               \
+                                                                                \
+/* NULL if an equal item is already in */                                       \
+static inline type* name##_insert(rb_tree_t* tree, type* item)                  \
+{                                                                               \
+	rb_node_t** link = &tree->root;                                             \
+	rb_node_t* parent = NULL;                                                   \
+                                                                                \
+	while (*link)                                                               \
+	{                                                                           \
+		parent = *link;                                                         \
+		isize_ptr result = cmp(name##_entry(parent), item);                     \
+                                                                                \
+		if (result > 0)                                                         \
+			link = &parent->left;                                               \
+		else if (result < 0)                                                    \
+			link = &parent->right;                                              \
+		else                                                                    \
+			return NULL;                                                        \
+	}                                                                           \
+                                                                                \
+	rb_insert_linked(tree, &item->member, parent, link);                        \
+	return item;                                                                \
+}                                                                               \
+                                                                                \
+static inline type* name##_search(rb_tree_t* tree, const type* key)             \
+{                                                                               \
+	rb_node_t* node = tree->root;                                               \
+                                                                                \
+	while (node)                                                                \
+	{                                                                           \
+		isize_ptr result = cmp(name##_entry(node), key);                        \
+                                                                                \
+		if (result > 0)                                                         \
+			node = node->left;                                                  \
+		else if (result < 0)                                                    \
+			node = node->right;                                                 \
+		else                                                                    \
+			return name##_entry(node);                                          \
+	}                                                                           \
+                                                                                \
+	return NULL;                                                                \
+}                                                                               \
+                                                                                \
+/* smallest item >= key */                                                      \
+static inline type* name##_lower_bound(rb_tree_t* tree, const type* key)        \
+{                                                                               \
+	rb_node_t* node = tree->root;                                               \
+	rb_node_t* result = NULL;                                                   \
+                                                                                \
+	while (node)                                                                \
+	{                                                                           \
+		if (cmp(key, name##_entry(node)) <= 0)                                  \
+		{                                                                       \
+			result = node;                                                      \
+			node = node->left;                                                  \
+		}                                                                       \
+		else                                                                    \
+		{                                                                       \
+			node = node->right;                                                 \
+		}                                                                       \
+	}                                                                           \
+                                                                                \
+	return name##_entry(result);                                                \
+}                                                                               \
+                                                                                \
+/* largest item <= key */                                                       \
+static inline type* name##_upper_bound(rb_tree_t* tree, const type* key)        \
+{                                                                               \
+	rb_node_t* node = tree->root;                                               \
+	rb_node_t* result = NULL;                                                   \
+                                                                                \
+	while (node)                                                                \
+	{                                                                           \
+		if (cmp(key, name##_entry(node)) >= 0)                                  \
+		{                                                                       \
+			result = node;                                                      \
+			node = node->right;                                                 \
+		}                                                                       \
+		else                                                                    \
+		{                                                                       \
+			node = node->left;                                                  \
+		}                                                                       \
+	}                                                                           \
+                                                                                \
+	return name##_entry(result);                                                \
+}                                                                               \
+                                                                                \
+static inline type* name##_remove(rb_tree_t* tree, type* item)                  \
+{                                                                               \
+	return name##_entry(rb_remove_node(tree, &item->member));                   \
+}                                                                               \
+                                                                                \
+static inline type* name##_first(rb_tree_t* tree)                               \
+{                                                                               \
+	return name##_entry(rb_min(tree));                                          \
+}                                                                               \
+                                                                                \
+static inline type* name##_last(rb_tree_t* tree)                                \
+{                                                                               \
+	return name##_entry(rb_max(tree));                                          \
+}                                                                               \
+                                                                                \
+static inline type* name##_next(type* item)                                     \
+{                                                                               \
+	return name##_entry(rb_next(&item->member));                                \
+}                                                                               \
+                                                                                \
+static inline type* name##_prev(type* item)                                     \
+{                                                                               \
+	return name##_entry(rb_prev(&item->member));                                \
+}
+
 #endif // __UTILS_TREE_INT_H__
\ No newline at end of file
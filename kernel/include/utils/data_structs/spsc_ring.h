@@ -0,0 +1,43 @@
+#ifndef __UTILS_SPSC_RING_H__
+#define __UTILS_SPSC_RING_H__
+
+#include <stdbool.h>
+#include "core/defs.h"
+
+// Fixed capacity, lock free ring of non NULL pointers for exactly one
+// producer and one consumer, e.g. an irq handing work to a tasklet. Each
+// side only writes its own index, the two sit on separate cache lines.
+typedef struct spsc_ring
+{
+    // producer side, the consumer's head as of its last look
+    atom_usize_ptr tail CACHE_ALIGNED;
+    usize_ptr cached_head;
+
+    // consumer side, the producer's tail as of its last look
+    atom_usize_ptr head CACHE_ALIGNED;
+    usize_ptr cached_tail;
+
+    void** slots CACHE_ALIGNED;
+    usize_ptr mask;
+} spsc_ring_t;
+
+// capacity = 2^n
+void spsc_ring_init(spsc_ring_t* ring, usize_ptr capacity);
+void spsc_ring_free(spsc_ring_t* ring);
+
+// Producer only. False when full.
+bool spsc_ring_push(spsc_ring_t* ring, void* item);
+// Producer only. Pushes the longest prefix of items that fits, one index
+// publish for all of them; returns how many went in.
+usize_ptr spsc_ring_push_batch(spsc_ring_t* ring, void* const* items, usize_ptr count);
+
+// Consumer only. NULL when empty.
+void* spsc_ring_pop(spsc_ring_t* ring);
+// Consumer only. Pops up to max_count items, returns how many.
+usize_ptr spsc_ring_pop_batch(spsc_ring_t* ring, void** items, usize_ptr max_count);
+
+// Exact from either side about its own end, a snapshot otherwise
+usize_ptr spsc_ring_count(spsc_ring_t* ring);
+bool spsc_ring_is_empty(spsc_ring_t* ring);
+
+#endif // __UTILS_SPSC_RING_H__
@@ -0,0 +1,126 @@
+#ifndef __UTILS_XARRAY_H__
+#define __UTILS_XARRAY_H__
+
+#include <stdbool.h>
+#include "core/defs.h"
+#include <services/threads/rcu.h>
+
+// index bits each level resolves, 64 slots per node
+#define XA_CHUNK_SHIFT 6
+#define XA_CHUNK_SIZE  (1 << XA_CHUNK_SHIFT)
+#define XA_CHUNK_MASK  (XA_CHUNK_SIZE - 1)
+
+// Per entry flags, searchable with xa_find_tag
+typedef enum xa_tag
+{
+    XA_TAG_DIRTY,
+    XA_TAG_WRITEBACK,
+    XA_TAG_ACCESSED,
+
+    XA_TAG_COUNT
+} xa_tag_t;
+
+typedef struct xa_node
+{
+    // entries in a leaf (shift 0), child nodes above it
+    void* slots[XA_CHUNK_SIZE];
+
+    // a bit per slot: the entry is tagged, or something under the child is
+    u64 tags[XA_TAG_COUNT];
+
+    struct xa_node* parent;
+    // index bits below this level
+    u8 shift;
+    // slot in the parent
+    u8 offset;
+    // non NULL slots
+    u8 count;
+
+    rcu_head_t rcu;
+} xa_node_t;
+
+// Radix tree of non NULL pointers indexed by a usize_ptr, for dense
+// indices like page offsets or LBAs. Only as tall as the largest index
+// needs, empty nodes are dropped as soon as their last entry goes.
+typedef struct xarray
+{
+    xa_node_t* root;
+
+    // RCU mode, see xa_set_rcu
+    bool rcu;
+} xarray_t;
+
+void init_xarray(xarray_t* xa);
+
+// RCU mode, set on a fresh array before it is shared. xa_load and the
+// find calls may then run inside rcu_read_lock concurrently with one
+// writer (writers still serialize among themselves), and nodes are freed
+// after a grace period. Tags a reader sees may lag behind the entries.
+void xa_set_rcu(xarray_t* xa);
+
+// Frees the nodes, not the entries
+void xa_destroy(xarray_t* xa);
+
+void* xa_load(xarray_t* xa, usize_ptr index);
+
+// Returns the entry it replaced (tags stay), storing NULL erases
+void* xa_store(xarray_t* xa, usize_ptr index, void* entry);
+// Returns the erased entry, its tags go with it
+void* xa_erase(xarray_t* xa, usize_ptr index);
+
+// Only present entries can be tagged
+void xa_set_tag  (xarray_t* xa, usize_ptr index, xa_tag_t tag);
+void xa_clear_tag(xarray_t* xa, usize_ptr index, xa_tag_t tag);
+bool xa_get_tag  (xarray_t* xa, usize_ptr index, xa_tag_t tag);
+
+// true if any entry carries tag, O(1)
+static inline bool xa_tagged(xarray_t* xa, xa_tag_t tag)
+{
+    xa_node_t* root = rcu_dereference(xa->root);
+
+    return root && root->tags[tag] != 0;
+}
+
+// First entry with *index <= its index <= last, *index is set to where it
+// was found. Whole empty or untagged subtrees are skipped at once.
+void* xa_find    (xarray_t* xa, usize_ptr* index, usize_ptr last);
+void* xa_find_tag(xarray_t* xa, usize_ptr* index, usize_ptr last, xa_tag_t tag);
+
+// Same, strictly after *index
+static inline void* xa_find_after(xarray_t* xa, usize_ptr* index, usize_ptr last)
+{
+    if (*index >= last)
+    {
+        return NULL;
+    }
+
+    (*index)++;
+    return xa_find(xa, index, last);
+}
+
+static inline void* xa_find_tag_after(xarray_t* xa, usize_ptr* index, usize_ptr last, xa_tag_t tag)
+{
+    if (*index >= last)
+    {
+        return NULL;
+    }
+
+    (*index)++;
+    return xa_find_tag(xa, index, last, tag);
+}
+
+// Every entry in [first, last] in index order, the current one may be erased
+#define xa_for_each_range(xa, index, entry, first, last)            \
+    for (index = (first), entry = xa_find(xa, &index, last);        \
+         entry;                                                     \
+         entry = xa_find_after(xa, &index, last))
+
+#define xa_for_each(xa, index, entry) \
+    xa_for_each_range(xa, index, entry, 0, (usize_ptr)-1)
+
+#define xa_for_each_tag(xa, index, entry, tag)                                 \
+    for (index = 0, entry = xa_find_tag(xa, &index, (usize_ptr)-1, tag);       \
+         entry;                                                                \
+         entry = xa_find_tag_after(xa, &index, (usize_ptr)-1, tag))
+
+#endif // __UTILS_XARRAY_H__
@@ -0,0 +1,35 @@
+#ifndef __UTILS_FAST_HASH_H__
+#define __UTILS_FAST_HASH_H__
+
+#include "core/num_defs.h"
+
+// xxHash32 (https://github.com/Cyan4973/xxHash), 32 bit native: word sized
+// unaligned loads and 32 bit multiplies only, cheap on i386 where
+// murmur2_hash64 pays for every 64 bit multiply.
+u32 xxhash32_seed(const u8* data, u32 length, u32 seed);
+u32 xxhash32     (const u8* data, u32 length);
+
+// fmap_hash_func shaped xxhash32, the maps only use the low 32 bits
+u64 fast_hash    (const u8* data, u64 length);
+
+// Avalanches a single word (murmur3's finalizer), for integer keys. A raw
+// number is a bad map hash, its low and high bits pick the slot.
+static inline u32 hash_u32(u32 value)
+{
+    value ^= value >> 16;
+    value *= 0x85EBCA6B;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35;
+    value ^= value >> 16;
+
+    return value;
+}
+
+// Mixes value into hash, for composite keys hashed a field at a time.
+// Order matters, combine(combine(h, a), b) != combine(combine(h, b), a).
+static inline u32 hash_combine(u32 hash, u32 value)
+{
+    return hash_u32(hash ^ (value + 0x9E3779B9 + (hash << 6) + (hash >> 2)));
+}
+
+#endif // __UTILS_FAST_HASH_H__
@@ -1,13 +1,17 @@
 #ifndef __DIR_ENTRY_CACHE_H__
 #define __DIR_ENTRY_CACHE_H__
 
+#include "services/threads/locks/spinlock.h"
 #include "utils/data_structs/flat_hashmap.h"
 #include "vfs/core/dir_entry.h"
 #include "vfs/core/superblock.h"
 
+// Lookups are lock free under rcu_read_lock, updates take lock and free
+// dropped entries after a grace period
 typedef struct dir_entry_cache 
 {
     flat_hashmap_t map; // key → dir_entry_t*
+    spinlock_t lock;
 } dir_entry_cache_t;
 
 void init_dir_entry_cache(dir_entry_cache_t* cache);
@@ -19,13 +23,16 @@ dir_entry_t* dir_entry_create(
     struct inode* inode
 );
 
+// Caller holds rcu_read_lock, the result stays valid until it drops it
 dir_entry_t* dir_entry_cache_lookup(
     dir_entry_cache_t* cache,
     dir_entry_t* parent,
     const char* child_name
 );
 
-void dir_entry_cache_insert(
+// Returns the cached entry, entry itself unless another CPU cached the
+// same name first (entry is freed then)
+dir_entry_t* dir_entry_cache_insert(
     dir_entry_cache_t* cache,
     dir_entry_t* entry
 );
@@ -1,6 +1,7 @@
 #ifndef __VFS_MOUNT_H__
 #define __VFS_MOUNT_H__
 
+#include "services/threads/locks/spinlock.h"
 #include "utils/data_structs/flat_hashmap.h"
 #include "vfs/core/dir_entry.h"
 #include "vfs/core/dir_entry_cache.h"
@@ -19,11 +20,14 @@ typedef struct vfs_mountpoint
     superblock_t* sb;
 } vfs_mountpoint_t;
 
+// mounts and dcache are read lock free under rcu_read_lock, mount_lock
+// serializes mount updates
 typedef struct vfs_mount_tree
 {
     dir_entry_t* root; 
     flat_hashmap_t mounts;
     dir_entry_cache_t dcache;
+    spinlock_t mount_lock;
 } vfs_mount_map_t;
 
 void vfs_mount_register(
@@ -33,6 +37,8 @@ void vfs_mount_register(
     dir_entry_t* root
 );
 
+// Root of the filesystem mounted on target, NULL if none. Caller holds
+// rcu_read_lock.
 dir_entry_t* vfs_mount_resolve(
     vfs_mount_map_t* data, 
     dir_entry_t* target
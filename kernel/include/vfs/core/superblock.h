@@ -3,6 +3,7 @@
 
 #include "core/num_defs.h"
 #include "services/block/device.h"
+#include "services/threads/locks/rwsem.h"
 #include "utils/data_structs/flat_hashmap.h"
 #include "vfs/core/dir_entry.h"
 #include "vfs/inode/fs_driver.h"
@@ -23,6 +24,8 @@ typedef struct superblock
     void* fs_data;
 
     flat_hashmap_t inode_cache;
+    // lookups share it, inserts and drops take it exclusively
+    rw_semaphore_t inode_cache_lock;
 
 } superblock_t;
 
@@ -5,7 +5,9 @@
 #include "vfs/inode/inode.h"
 #include "vfs/core/superblock.h"
 
-void inode_cache_insert(superblock_t* sb, inode_t* node);
+// Returns the cached inode, node itself unless another thread cached the
+// same fs_id first (node is destroyed then)
+inode_t* inode_cache_insert(superblock_t* sb, inode_t* node);
 
 inode_t* inode_cache_fetch(
     superblock_t* sb, 
@@ -13,12 +13,50 @@
 #include "memory/virt/virt_region.h"
 #include "memory/virt/virt_map.h"
 #include <stdio.h>
+#include <kernel/core/cpu.h>
+#include <services/threads/locks/spinlock.h>
+#include <stdatomic.h>
 
 #define MM_AREA_VIRT   0xD0000000
 #define KERNEL_ADDR    0x00100000
 #define KERNEL_VIRT_ADDR 0xC0000000
 #define HEAP_MAX_SIZE  STOR_256MiB
 
+#define MM_NO_OWNER ((u32)-1)
+
+static spinlock_t mm_spinlock;
+static atom_u32 mm_owner = MM_NO_OWNER;
+static u32 mm_depth;
+
+void mm_lock()
+{
+    // only the owner can see itself here, and it runs with irqs off
+    if (atomic_load_explicit(&mm_owner, memory_order_relaxed) == cpu_id())
+    {
+        mm_depth++;
+        return;
+    }
+
+    spinlock_lock(&mm_spinlock);
+
+    atomic_store_explicit(&mm_owner, cpu_id(), memory_order_relaxed);
+    mm_depth = 1;
+}
+
+void mm_unlock()
+{
+    assert(mm_depth > 0);
+
+    if (--mm_depth)
+    {
+        return;
+    }
+
+    atomic_store_explicit(&mm_owner, MM_NO_OWNER, memory_order_relaxed);
+
+    spinlock_unlock(&mm_spinlock);
+}
+
 void mm_ensure_memory(usize_ptr count)
 {
     assert(pfn_page_free_count() > count);
@@ -38,13 +76,19 @@ void mm_set_allocator_type(enum mm_alloc_type new_alloc_type)
 
 void* mm_alloc_pagetable()
 {
+    void* table;
+
     switch (alloc_type) 
     {
         case ALLOC_BITMAP:
             return bitmap_alloc_page();
 
         case ALLOC_FRAME:
-            return pfn_to_pa( frame_alloc_phys_pages(1) );
+            mm_lock();
+            table = pfn_to_pa( frame_alloc_phys_pages(1) );
+            mm_unlock();
+
+            return table;
 
         // Can't allocate if it's not bitmap or frame
         default:
@@ -55,6 +99,8 @@ void* mm_alloc_pagetable()
 
 page_t* mm_alloc_pages(usize_ptr count)
 {
+    mm_lock();
+
     page_t* result = frame_alloc_phys_pages(count);
     
     page_t* desc = result;
@@ -65,19 +111,27 @@ page_t* mm_alloc_pages(usize_ptr count)
         desc->ref_count = 1;
         desc++;
     }
+
+    mm_unlock();
     
     return result;
 }
 
 void mm_get_page(page_t* desc)
 {
+    mm_lock();
+
     assert(desc->type != PAGETYPE_UNUSED);
     assert(desc->ref_count != 0);
     desc->ref_count++;
+
+    mm_unlock();
 }
 
 void mm_put_page(page_t* desc)
 {
+    mm_lock();
+
     assert(desc->ref_count != 0);
     desc->ref_count--;
 
@@ -87,10 +141,14 @@ void mm_put_page(page_t* desc)
             desc, 1
         );
     }
+
+    mm_unlock();
 }
 
 void mm_get_range(page_t* begin, usize_ptr count)
 {
+    mm_lock();
+
     page_t* desc = begin;
     for (usize_ptr i = 0; i < count; ++i) 
     {
@@ -100,6 +158,8 @@ void mm_get_range(page_t* begin, usize_ptr count)
 
         desc++;
     }
+
+    mm_unlock();
 }
 
 void mm_put_range(page_t* begin, usize_ptr count)
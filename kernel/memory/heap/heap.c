@@ -186,7 +186,7 @@ static void add_heap_region(usize_ptr add_size)
     page_t* page = mm_alloc_pages(add_size/PAGE_SIZE);
     vmap_pages(
         heap.cur_max_addr, 
-        pfn_to_pa(page), 
+        page, 
         VREGION_HEAP, 
         add_size/PAGE_SIZE
     );
@@ -562,8 +562,8 @@ void free_slab(void* addr)
     free_buddy((void*)slab_start_addr);
 }
 
-// Allocate abstraction for slab
-void* kmalloc(usize_ptr size)
+// Allocate abstraction for slab, mm lock held
+static void* heap_alloc(usize_ptr size)
 {
     if (size > (1 << SLAB_EXPON_MAX))
     {
@@ -590,6 +590,15 @@ void* kmalloc(usize_ptr size)
     return alloc_slab(&heap.free_slabs[order]);
 }
 
+void* kmalloc(usize_ptr size)
+{
+    mm_lock();
+    void* addr = heap_alloc(size);
+    mm_unlock();
+
+    return addr;
+}
+
 void *kmalloc_aligned(usize_ptr alignment, usize_ptr size) 
 { 
     // the size is always the alignment
@@ -617,11 +626,11 @@ static usize_ptr get_buddy_size(void* buddy_addr)
     return 1 << expon;
 }
 
-void* krealloc(void* addr, usize_ptr new_size)
+static void* heap_realloc(void* addr, usize_ptr new_size)
 {
     if (!addr)
     {
-        return kmalloc(new_size);
+        return heap_alloc(new_size);
     }
     
     page_t* desc = pa_to_pfn( virt_to_phys(addr) );
@@ -685,14 +694,27 @@ void* krealloc(void* addr, usize_ptr new_size)
     }
 }
 
+void* krealloc(void* addr, usize_ptr new_size)
+{
+    mm_lock();
+    void* new_addr = heap_realloc(addr, new_size);
+    mm_unlock();
+
+    return new_addr;
+}
+
 void kfree(void* addr)
 {
+    mm_lock();
+
     page_t* desc = pa_to_pfn( virt_to_phys(addr) );
 
     if (desc->u.heap.flags & HEAPFLAG_BUDDY)
         free_buddy(addr);
     else
         free_slab(addr);
+
+    mm_unlock();
 }
 
 heap_slab_cache_t* kcreate_slab_cache(usize_ptr obj_size, const char* slab_name)
@@ -714,7 +736,11 @@ heap_slab_cache_t* kcreate_slab_cache(usize_ptr obj_size, const char* slab_name)
 
 void* kalloc_cache(heap_slab_cache_t* cache)
 {
-    return alloc_slab(&cache->order);
+    mm_lock();
+    void* addr = alloc_slab(&cache->order);
+    mm_unlock();
+
+    return addr;
 }
 
 void kfree_slab_cache(heap_slab_cache_t* slab_cache)
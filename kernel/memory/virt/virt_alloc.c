@@ -7,11 +7,15 @@ void* kvalloc_pages(
     usize_ptr count, 
     enum virt_region_type vregion)
 {
+    mm_lock();
+
     void* va = kvregion_reserve(count, vregion, vregion_to_str(vregion));
 
     page_t* page = mm_alloc_pages(count);
     vmap_pages(va, page, vregion, count);
 
+    mm_unlock();
+
     return va;
 }
 
@@ -33,6 +33,10 @@ static u16 vregion_to_vflags(enum virt_region_type region)
         case VREGION_BIO_BUFFER:
             return VFLAG_READ | VFLAG_WRITE;
 
+        case VREGION_STACK:
+        case VREGION_PERCPU:
+            return VFLAG_READ | VFLAG_WRITE;
+
         case VREGION_DRIVER:
             return VFLAG_READ | VFLAG_WRITE | VFLAG_SHARED;
 
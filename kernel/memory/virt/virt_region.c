@@ -1,4 +1,5 @@
 #include "arch/i386/memory/paging_utils.h"
+#include "memory/core/memory_manager.h"
 #include "memory/core/pfn_desc.h"
 #include "memory/virt/virt_region.h"
 #include <core/defs.h>
@@ -47,6 +48,10 @@ const char* vregion_to_str(enum virt_region_type vregion)
             return "CACHE";
         case VREGION_BIO_BUFFER:
             return "BIO BUFFER";
+        case VREGION_STACK:
+            return "STACK";
+        case VREGION_PERCPU:
+            return "PERCPU";
         case VREGION_MMIO:
             return "MMIO";
         case VREGION_KERNELIMG:
@@ -57,10 +62,24 @@ const char* vregion_to_str(enum virt_region_type vregion)
     return NULL;
 }
 
+static isize_ptr interval_cmp(const virt_interval_t* int_a, const virt_interval_t* int_b)
+{
+    if (int_a->to <= int_b->from) 
+        return -1;
+
+    if (int_b->to <= int_a->from) 
+        return 1;
+    
+    return 0;
+}
+
+RB_DEFINE_TYPED(interval_tree, virt_interval_t, node, interval_cmp)
+
 static void* find_gap_start(rb_tree_t* tree, usize_ptr size, usize_ptr min_addr, usize_ptr max_inclusive_addr)
 {
-    rb_node_t* cur_node = rb_min(tree);
-    if (cur_node == NULL) 
+    // cached leftmost, no descent
+    virt_interval_t* cur = interval_tree_first(tree);
+    if (cur == NULL) 
     {
         if ((max_inclusive_addr - min_addr + 1) >= size) 
         {
@@ -68,8 +87,6 @@ static void* find_gap_start(rb_tree_t* tree, usize_ptr size, usize_ptr min_addr,
         }
         return NULL;
     }
-    virt_interval_t* cur = container_of(cur_node, virt_interval_t, node);
-
 
     assert(cur->from >= min_addr);
 
@@ -80,31 +97,14 @@ static void* find_gap_start(rb_tree_t* tree, usize_ptr size, usize_ptr min_addr,
     }
 
     // Check if there is a free interval between something
-    rb_node_t* next_node = rb_next(cur_node);
-    if (!next_node)
+    for (virt_interval_t* next = interval_tree_next(cur); next; next = interval_tree_next(cur))
     {
-        if ((max_inclusive_addr - cur->to + 1) >= size)
-        {
-            return (void*)cur->to;
-        }
-        else
-        {
-            return NULL;
-        }
-    }
-    virt_interval_t* next = container_of(next_node, virt_interval_t, node);
-    while (next_node != NULL)
-    {
-        cur  = container_of(cur_node , virt_interval_t, node);
-        next = container_of(next_node, virt_interval_t, node);
-
         if (next->from - cur->to >= size)
         {
             return (void*)cur->to;
         }
 
-        cur_node = next_node;
-        next_node = rb_next(cur_node);
+        cur = next;
     }
 
     // Free interval between end and max_addr
@@ -123,18 +123,13 @@ static inline virt_interval_t* search_interval_addr(rb_tree_t* tree, void* va_pt
         .to   = (usize_ptr)va_ptr + PAGE_SIZE
     };
 
-    rb_node_t* node = rb_search(tree, &asked_interval.node);
-    if (node == NULL)
-    {
-        return NULL;
-    }
-
-    virt_interval_t* interval = container_of(node, virt_interval_t, node);
-    return interval;
+    return interval_tree_search(tree, &asked_interval);
 }
 
 void kvregion_mark(void* from, usize_ptr count, enum virt_region_type vregion, const char* name)
 {
+    mm_lock();
+
     virt_interval_t* new_interval = kalloc_cache(interval_cache);
     assert(new_interval);
     
@@ -143,37 +138,42 @@ void kvregion_mark(void* from, usize_ptr count, enum virt_region_type vregion, c
     new_interval->name = name;
     new_interval->vregion = vregion;
 
-    rb_insert(&virt_kernel_tree, &new_interval->node);
+    interval_tree_insert(&virt_kernel_tree, new_interval);
+
+    mm_unlock();
 }
 
 void kvregion_release(void* va)
 {
+    mm_lock();
+
     virt_interval_t* cur_interval = search_interval_addr(
         &virt_kernel_tree,
         va
     );
     assert(cur_interval);
 
-    rb_remove_node(
-        &virt_kernel_tree, 
-        &cur_interval->node
-    );
+    interval_tree_remove(&virt_kernel_tree, cur_interval);
+
+    mm_unlock();
 }
 
 void* kvregion_reserve(usize_ptr count, enum virt_region_type vregion, const char* name)
 {
     usize_ptr size = count * PAGE_SIZE;
 
+    mm_lock();
+
     void* gap_start = find_gap_start(&virt_kernel_tree, size, HIGH_VADDR, MAX_VADDR);
-    if (!gap_start)
+    if (gap_start)
     {
-        return NULL;
+        kvregion_mark(
+            gap_start,  count, 
+            vregion, name ? name : RESERVE_PAGES_NAME
+        );
     }
 
-    kvregion_mark(
-        gap_start,  count, 
-        vregion, name ? name : RESERVE_PAGES_NAME
-    );
+    mm_unlock();
 
     return gap_start;
 }
@@ -192,9 +192,11 @@ bool kvregion_is_free(void* va)
         .to   = (usize_ptr)va + PAGE_SIZE
     };
 
-    rb_node_t* node = rb_search(&virt_kernel_tree, &probe.node);
+    mm_lock();
+    virt_interval_t* interval = interval_tree_search(&virt_kernel_tree, &probe);
+    mm_unlock();
 
-    return (node == NULL);
+    return (interval == NULL);
 }
 
 usize_ptr  kvregion_count(void* va)
@@ -204,31 +206,16 @@ usize_ptr  kvregion_count(void* va)
         .to   = (usize_ptr)va + PAGE_SIZE
     };
 
-    rb_node_t* node = rb_search(&virt_kernel_tree, &probe.node);
-
-    virt_interval_t* interval = container_of(node, virt_interval_t, node);
+    mm_lock();
+    virt_interval_t* interval = interval_tree_search(&virt_kernel_tree, &probe);
+    mm_unlock();
 
     return (interval->to - interval->from);
 }
 
-static int interval_cmp(const rb_node_t* node_a, const rb_node_t* node_b)
-{
-    const virt_interval_t* int_a = container_of(node_a, virt_interval_t, node);
-    const virt_interval_t* int_b = container_of(node_b, virt_interval_t, node);
-
-    if (int_a->to <= int_b->from) 
-        return -1;
-
-    if (int_b->to <= int_a->from) 
-        return 1;
-    
-    return 0;
-}
-
-
 void init_virt_region()
 {
-    rb_init_tree(&virt_kernel_tree, interval_cmp, NULL);
+    rb_init_tree_cached(&virt_kernel_tree, interval_tree_cmp_nodes, NULL);
     
     interval_cache = kcreate_slab_cache(
         sizeof(virt_interval_t), 
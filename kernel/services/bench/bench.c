@@ -0,0 +1,93 @@
+#ifdef KERNEL_BENCH
+
+#include "services/bench/bench.h"
+#include <kernel/core/cpu.h>
+#include <kernel/devices/clock.h>
+#include <kernel/devices/power.h>
+#include <stdio.h>
+
+// make bench passes the commit the image was built from
+#ifndef BENCH_COMMIT
+#define BENCH_COMMIT "unknown"
+#endif
+
+static const bench_t benches[] = {
+    { "heap",   bench_heap   },
+    { "paging", bench_paging },
+    { "hash",   bench_hash   },
+    { "block",  bench_block  },
+    { "vfs",    bench_vfs    },
+};
+
+bench_timer_t bench_start()
+{
+    return (bench_timer_t){
+        .ns = clock_monotonic_ns(),
+        .cycles = cpu_cycles(),
+    };
+}
+
+void bench_stop(
+    const bench_timer_t* start,
+    const char* bench,
+    const char* name,
+    u64 param,
+    u64 ops,
+    u64 bytes)
+{
+    u64 cycles = cpu_cycles() - start->cycles;
+    u64 ns = clock_monotonic_ns() - start->ns;
+
+    // printf has no floats, rates are whole numbers
+    u64 safe_ns = ns ? ns : 1;
+    u64 safe_ops = ops ? ops : 1;
+
+    printf(
+        "{\"bench\":\"%s\",\"case\":\"%s\",\"param\":%llu,\"ops\":%llu,"
+        "\"ns\":%llu,\"cycles\":%llu,\"ns_per_op\":%llu,\"cycles_per_op\":%llu,"
+        "\"ops_per_sec\":%llu,\"bytes\":%llu,\"kib_per_sec\":%llu}\n",
+        bench,
+        name,
+        param,
+        ops,
+        ns,
+        cycles,
+        ns / safe_ops,
+        cycles / safe_ops,
+        ops * 1000000000ULL / safe_ns,
+        bytes,
+        bytes * (1000000000ULL / 1024) / safe_ns
+    );
+}
+
+void bench_skip(const char* bench, const char* reason)
+{
+    printf("{\"bench\":\"%s\",\"skipped\":\"%s\"}\n", bench, reason);
+}
+
+void bench_run_all(const bench_env_t* env)
+{
+    printf(
+        "{\"meta\":\"start\",\"commit\":\"%s\",\"clocksource\":\"%s\",\"tsc_hz\":%llu}\n",
+        BENCH_COMMIT,
+        clock_source_name(),
+        clock_tsc_hz()
+    );
+
+    u64 start = clock_monotonic_ns();
+
+    for (u32 i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        benches[i].run(env);
+    }
+
+    printf(
+        "{\"meta\":\"done\",\"benches\":%llu,\"ns\":%llu}\n",
+        (u64)(sizeof(benches) / sizeof(benches[0])),
+        clock_monotonic_ns() - start
+    );
+
+    power_off(0);
+}
+
+#endif // KERNEL_BENCH
@@ -0,0 +1,128 @@
+#ifdef KERNEL_BENCH
+
+#include "memory/virt/virt_alloc.h"
+#include "services/bench/bench.h"
+#include "services/block/device.h"
+#include "services/threads/wait_queue.h"
+#include <core/atomic_defs.h>
+
+#define SEQ_TOTAL_BYTES STOR_4MiB
+#define RANDOM_READS    1024
+#define MAX_QUEUE_DEPTH 8
+
+static const usize_ptr seq_sizes[] = { STOR_4KiB, STOR_16KiB, STOR_64KiB, STOR_256KiB };
+static const u32 queue_depths[] = { 1, 4, MAX_QUEUE_DEPTH };
+
+// one batch of requests in flight, the last completion wakes the waiter
+typedef struct bench_batch
+{
+    atom_u32 pending;
+    completion_t done;
+} bench_batch_t;
+
+static void bench_block_cb(block_request_t* request, i64 result)
+{
+    assert(result >= 0);
+
+    bench_batch_t* batch = request->ctx;
+    if (atomic_fetch_sub(&batch->pending, 1) == 1)
+    {
+        complete(&batch->done);
+    }
+}
+
+static void read_batch(
+    block_device_t* device,
+    u8* buffer,
+    usize_ptr block_count,
+    const usize* offsets,
+    u32 count)
+{
+    bench_batch_t batch;
+    atomic_store(&batch.pending, count);
+    completion_init(&batch.done);
+
+    for (u32 i = 0; i < count; i++)
+    {
+        block_submit(
+            device,
+            BLOCK_IO_READ,
+            buffer + i * block_count * device->block_size,
+            block_count,
+            offsets[i],
+            bench_block_cb, &batch
+        );
+    }
+
+    wait_for_completion(&batch.done);
+}
+
+// one request at a time, throughput per request size
+static void bench_sequential(block_device_t* device, u8* buffer, usize_ptr size)
+{
+    usize_ptr block_count = size / device->block_size;
+    usize_ptr total = min(SEQ_TOTAL_BYTES, device->block_count * device->block_size);
+    u32 ops = total / size;
+
+    bench_timer_t timer = bench_start();
+    for (u32 i = 0; i < ops; i++)
+    {
+        usize offset = i * block_count;
+        read_batch(device, buffer, block_count, &offset, 1);
+    }
+    bench_stop(&timer, "block", "seq_read", size, ops, (u64)ops * size);
+}
+
+// page sized (or one block, if larger) reads at random offsets,
+// queue_depth of them in flight
+static void bench_random(block_device_t* device, u8* buffer, u32 queue_depth)
+{
+    usize_ptr block_count = max(PAGE_SIZE / device->block_size, 1);
+    usize_ptr read_size = block_count * device->block_size;
+    usize_ptr positions = device->block_count / block_count;
+    usize offsets[MAX_QUEUE_DEPTH];
+    u32 seed = 0xB10C;
+
+    bench_timer_t timer = bench_start();
+    for (u32 done = 0; done < RANDOM_READS; done += queue_depth)
+    {
+        for (u32 i = 0; i < queue_depth; i++)
+        {
+            offsets[i] = (bench_rand(&seed) % positions) * block_count;
+        }
+
+        read_batch(device, buffer, block_count, offsets, queue_depth);
+    }
+    bench_stop(&timer, "block", "random_read", queue_depth,
+        RANDOM_READS, (u64)RANDOM_READS * read_size);
+}
+
+void bench_block(const bench_env_t* env)
+{
+    block_device_t* device = env->device;
+    if (!device)
+    {
+        bench_skip("block", "no block device");
+        return;
+    }
+
+    usize_ptr buffer_size = max(STOR_256KiB, MAX_QUEUE_DEPTH * max(PAGE_SIZE, device->block_size));
+    u8* buffer = kvalloc_pages(buffer_size / PAGE_SIZE, VREGION_BIO_BUFFER);
+
+    for (u32 i = 0; i < sizeof(seq_sizes) / sizeof(seq_sizes[0]); i++)
+    {
+        if (seq_sizes[i] >= device->block_size)
+        {
+            bench_sequential(device, buffer, seq_sizes[i]);
+        }
+    }
+
+    for (u32 i = 0; i < sizeof(queue_depths) / sizeof(queue_depths[0]); i++)
+    {
+        bench_random(device, buffer, queue_depths[i]);
+    }
+
+    kvfree_pages(buffer);
+}
+
+#endif // KERNEL_BENCH
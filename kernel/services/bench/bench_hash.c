@@ -0,0 +1,93 @@
+#ifdef KERNEL_BENCH
+
+#include "services/bench/bench.h"
+#include <utils/hash/fast_hash.h>
+#include <utils/hash/murmur2_hash.h>
+
+#define BENCH_ITERATIONS 4096
+#define BENCH_MAX_LENGTH 256
+
+typedef struct hash_bench_func
+{
+    const char* name;
+    u64 (*hash)(const u8* data, u64 length);
+} hash_bench_func_t;
+
+static u64 bench_murmur2_32(const u8* data, u64 length)
+{
+    return murmur2_hash32(data, length);
+}
+
+// the old dentry_hash, murmur2_hash64 of the parent xor'd with the name's
+static u64 bench_murmur2_pair(const u8* data, u64 length)
+{
+    u64 hash = murmur2_hash64(data, sizeof(uptr));
+    return hash ^ murmur2_hash64(data + sizeof(uptr), length - sizeof(uptr));
+}
+
+// the new dentry_hash
+static u64 bench_combine_pair(const u8* data, u64 length)
+{
+    uptr parent;
+    __builtin_memcpy(&parent, data, sizeof(parent));
+
+    return hash_combine(xxhash32(data + sizeof(uptr), length - sizeof(uptr)), (u32)parent);
+}
+
+static const hash_bench_func_t funcs[] = {
+    { "murmur2_hash32", bench_murmur2_32   },
+    { "murmur2_hash64", murmur2_hash64     },
+    { "xxhash32",       fast_hash          },
+    { "murmur2_pair",   bench_murmur2_pair },
+    { "combine_pair",   bench_combine_pair },
+};
+
+// inode numbers, pointers, dentry keys of short and long names, blocks
+static const u32 lengths[] = { 4, 8, 12, 16, 32, 64, 256 };
+
+// one byte in, every word load is unaligned
+static u8 buffer[BENCH_MAX_LENGTH + 1];
+
+static volatile u64 sink;
+
+static void bench_one(const hash_bench_func_t* func, u32 length)
+{
+    const u8* data = buffer + 1;
+    u64 acc = 0;
+
+    // warm the caches and the branch predictor first
+    for (u32 i = 0; i < BENCH_ITERATIONS / 16; i++)
+    {
+        acc += func->hash(data, length);
+    }
+
+    bench_timer_t timer = bench_start();
+    for (u32 i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        acc += func->hash(data, length);
+    }
+    bench_stop(&timer, "hash", func->name, length,
+        BENCH_ITERATIONS, (u64)BENCH_ITERATIONS * length);
+
+    sink = acc;
+}
+
+void bench_hash(const bench_env_t* env)
+{
+    (void)env;
+
+    for (u32 i = 0; i < sizeof(buffer); i++)
+    {
+        buffer[i] = (u8)(i * 131 + 7);
+    }
+
+    for (u32 f = 0; f < sizeof(funcs) / sizeof(funcs[0]); f++)
+    {
+        for (u32 l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+        {
+            bench_one(&funcs[f], lengths[l]);
+        }
+    }
+}
+
+#endif // KERNEL_BENCH
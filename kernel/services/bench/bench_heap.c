@@ -0,0 +1,89 @@
+#ifdef KERNEL_BENCH
+
+#include "memory/heap/heap.h"
+#include "services/bench/bench.h"
+
+#define PAIR_OPS    100000
+#define BATCH_COUNT 4096
+#define CHURN_SLOTS 1024
+#define CHURN_OPS   100000
+
+static const usize_ptr sizes[] = { 16, 64, 256, 1024, 4096, STOR_64KiB, STOR_256KiB };
+
+static void* batch[BATCH_COUNT];
+static void* churn[CHURN_SLOTS];
+
+// one object alive at a time, the slab or buddy fast path
+static void bench_pairs(usize_ptr size)
+{
+    bench_timer_t timer = bench_start();
+    for (u32 i = 0; i < PAIR_OPS; i++)
+    {
+        kfree(kmalloc(size));
+    }
+    bench_stop(&timer, "heap", "kmalloc_kfree", size, PAIR_OPS, 0);
+}
+
+// many objects alive, slabs fill up and drain again
+static void bench_batch(usize_ptr size)
+{
+    bench_timer_t timer = bench_start();
+    for (u32 i = 0; i < BATCH_COUNT; i++)
+    {
+        batch[i] = kmalloc(size);
+    }
+    bench_stop(&timer, "heap", "batch_kmalloc", size, BATCH_COUNT, 0);
+
+    timer = bench_start();
+    for (u32 i = 0; i < BATCH_COUNT; i++)
+    {
+        kfree(batch[i]);
+    }
+    bench_stop(&timer, "heap", "batch_kfree", size, BATCH_COUNT, 0);
+}
+
+// random sizes replaced at random, the mix a running kernel sees
+static void bench_churn()
+{
+    u32 seed = 0x1234567;
+
+    for (u32 i = 0; i < CHURN_SLOTS; i++)
+    {
+        churn[i] = kmalloc(8 + bench_rand(&seed) % 2048);
+    }
+
+    bench_timer_t timer = bench_start();
+    for (u32 i = 0; i < CHURN_OPS; i++)
+    {
+        u32 slot = bench_rand(&seed) % CHURN_SLOTS;
+
+        kfree(churn[slot]);
+        churn[slot] = kmalloc(8 + bench_rand(&seed) % 2048);
+    }
+    bench_stop(&timer, "heap", "random_churn", CHURN_SLOTS, CHURN_OPS, 0);
+
+    for (u32 i = 0; i < CHURN_SLOTS; i++)
+    {
+        kfree(churn[i]);
+    }
+}
+
+void bench_heap(const bench_env_t* env)
+{
+    (void)env;
+
+    for (u32 i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        bench_pairs(sizes[i]);
+    }
+
+    // the buddy sizes would take BATCH_COUNT times 64KiB and up
+    for (u32 i = 0; sizes[i] <= PAGE_SIZE; i++)
+    {
+        bench_batch(sizes[i]);
+    }
+
+    bench_churn();
+}
+
+#endif // KERNEL_BENCH
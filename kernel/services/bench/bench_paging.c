@@ -0,0 +1,47 @@
+#ifdef KERNEL_BENCH
+
+#include "memory/virt/virt_alloc.h"
+#include "services/bench/bench.h"
+#include <kernel/memory/paging.h>
+
+#define MAP_OPS 20000
+
+static const usize_ptr page_counts[] = { 1, 16, 256 };
+
+// same frames unmapped and mapped back, page table and TLB cost only
+static void bench_map_unmap(usize_ptr count)
+{
+    void* va = kvalloc_pages(count, VREGION_DRIVER);
+    void* pa = virt_to_phys(va);
+
+    u16 flags = PAGING_FLAG_READ | PAGING_FLAG_WRITE | PAGING_FLAG_NOEXEC;
+    u32 ops = MAP_OPS / count ? MAP_OPS / count : 1;
+
+    bench_timer_t timer = bench_start();
+    for (u32 i = 0; i < ops; i++)
+    {
+        paging_unmap_pages(va, count);
+        paging_map_pages(pa, va, count, flags);
+    }
+    bench_stop(&timer, "paging", "unmap_map", count, ops, 0);
+
+    // a remap that lost a page faults here rather than later
+    for (usize_ptr i = 0; i < count; i++)
+    {
+        ((volatile u8*)va)[i * PAGE_SIZE] = (u8)i;
+    }
+
+    kvfree_pages(va);
+}
+
+void bench_paging(const bench_env_t* env)
+{
+    (void)env;
+
+    for (u32 i = 0; i < sizeof(page_counts) / sizeof(page_counts[0]); i++)
+    {
+        bench_map_unmap(page_counts[i]);
+    }
+}
+
+#endif // KERNEL_BENCH
@@ -0,0 +1,98 @@
+#ifdef KERNEL_BENCH
+
+#include "memory/heap/heap.h"
+#include "services/bench/bench.h"
+#include "vfs/core/path.h"
+#include "vfs/inode/inode.h"
+
+// make bench puts a file of zeroes here in the Ext2 root
+#ifndef BENCH_FILE
+#define BENCH_FILE "/bench.dat"
+#endif
+
+#define LOOKUP_HIT_OPS  100000
+#define LOOKUP_MISS_OPS 256
+#define RANDOM_READS    1024
+#define RANDOM_SIZE     512
+
+static const usize_ptr chunk_sizes[] = { STOR_4KiB, STOR_64KiB };
+
+static void bench_lookup(vfs_mount_map_t* vfs, const char* path, const char* name, u32 ops)
+{
+    dir_entry_t* entry;
+
+    bench_timer_t timer = bench_start();
+    for (u32 i = 0; i < ops; i++)
+    {
+        vfs_lookup_path(vfs, path, &entry);
+    }
+    bench_stop(&timer, "vfs", name, 0, ops, 0);
+}
+
+static void bench_seq_read(inode_t* inode, u8* buffer, usize_ptr chunk)
+{
+    u32 ops = 0;
+
+    bench_timer_t timer = bench_start();
+    for (usize offset = 0; offset + chunk <= inode->size; offset += chunk, ops++)
+    {
+        inode->ops->read(inode, buffer, chunk, offset);
+    }
+    bench_stop(&timer, "vfs", "ext2_seq_read", chunk, ops, (u64)ops * chunk);
+}
+
+static void bench_random_read(inode_t* inode, u8* buffer)
+{
+    u32 seed = 0xE872;
+
+    bench_timer_t timer = bench_start();
+    for (u32 i = 0; i < RANDOM_READS; i++)
+    {
+        usize offset = bench_rand(&seed) % (inode->size - RANDOM_SIZE);
+        inode->ops->read(inode, buffer, RANDOM_SIZE, offset);
+    }
+    bench_stop(&timer, "vfs", "ext2_random_read", RANDOM_SIZE,
+        RANDOM_READS, (u64)RANDOM_READS * RANDOM_SIZE);
+}
+
+void bench_vfs(const bench_env_t* env)
+{
+    if (!env->vfs)
+    {
+        bench_skip("vfs", "nothing mounted");
+        return;
+    }
+
+    dir_entry_t* entry = NULL;
+    if (vfs_lookup_path(env->vfs, BENCH_FILE, &entry) < 0 || !entry)
+    {
+        bench_skip("vfs", "no " BENCH_FILE);
+        return;
+    }
+
+    // the first lookup above filled the dcache, these are all hits
+    bench_lookup(env->vfs, "/", "lookup_root", LOOKUP_HIT_OPS);
+    bench_lookup(env->vfs, BENCH_FILE, "lookup_hit", LOOKUP_HIT_OPS);
+    // misses aren't cached, every one reads the directory
+    bench_lookup(env->vfs, "/no_such_file", "lookup_miss", LOOKUP_MISS_OPS);
+
+    inode_t* inode = entry->inode;
+    if (inode->size <= STOR_64KiB)
+    {
+        bench_skip("vfs", BENCH_FILE " too small to read");
+        return;
+    }
+
+    u8* buffer = kmalloc(STOR_64KiB);
+
+    for (u32 i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++)
+    {
+        bench_seq_read(inode, buffer, chunk_sizes[i]);
+    }
+
+    bench_random_read(inode, buffer);
+
+    kfree(buffer);
+}
+
+#endif // KERNEL_BENCH
@@ -23,6 +23,7 @@ block_request_t* block_req_generate(
     request->block_count  = block_count;
     request->block_vbuffer = block_vbuffer;
     request->io            = io;
+    request->next          = NULL;
     request->device        = device;
 
     return request;   
@@ -9,7 +9,8 @@
 #include "services/block/request.h"
 #include "services/block/device.h"
 #include "services/block/types/types.h"
-#include "utils/data_structs/ring_queue.h"
+#include "utils/data_structs/mpmc_ring.h"
+#include <stdatomic.h>
 #include <string.h>
 
 static void stor_disk_cb(stor_request_t* stor_request, i64 result);
@@ -60,52 +61,158 @@ static stor_request_t* block_disk_make_stor_request(block_request_t* block_reque
 
 
 
+static bool disk_claim_slot(block_dev_disk_t* disk)
+{
+    u32 in_flight = atomic_load(&disk->in_flight);
+
+    while (in_flight < disk->hw_device->max_requests)
+    {
+        if (atomic_compare_exchange_weak(&disk->in_flight, &in_flight, in_flight + 1))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void disk_release_slot(block_dev_disk_t* disk)
+{
+    atomic_fetch_sub(&disk->in_flight, 1);
+
+    // the release is visible before the queue is looked at again
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+// Hands queued requests to the hardware while it has free slots. Runs
+// after every push and every completion: a submitter fences between its
+// push and its slot check, a completion between freeing a slot and its
+// queue check, so at least one of them sees the other and nothing is
+// left queued with the hardware idle.
+static void disk_dispatch(block_dev_disk_t* disk)
+{
+    while (disk_claim_slot(disk))
+    {
+        block_request_t* request = mpmc_ring_pop(&disk->queue);
+
+        if (request)
+        {
+            stor_request_t* stor_request = block_disk_make_stor_request(request);
+            assert(stor_submit(stor_request));
+            continue;
+        }
+
+        disk_release_slot(disk);
+
+        // a push that landed after the pop saw this slot taken
+        if (mpmc_ring_is_empty(&disk->queue))
+        {
+            return;
+        }
+    }
+}
+
 static void stor_disk_cb(stor_request_t* stor_request, i64 result)
 {
     assert(result >= 0);
 
-    stor_device_t*    stor_dev       = stor_request->device;
     block_request_t*  block_request = (block_request_t*) stor_request->ctx;
-    block_device_t*   block_dev      = block_request->device;
-    block_dev_disk_t* disk_data      = &block_dev->data.disk;
-    ring_queue_t*     queue          = &disk_data->queue;
+    block_dev_disk_t* disk_data     = &block_request->device->data.disk;
+
+    // keep the hardware busy while the callback chain runs
+    disk_release_slot(disk_data);
+    disk_dispatch(disk_data);
+
+    // the dispatch made queue room, the overflow worker may be waiting on it
+    if (atomic_load(&disk_data->overflow_count) != 0)
+    {
+        wake_up_one(&disk_data->overflow_room);
+    }
 
     block_request->cb(block_request, result);
     block_req_cleanup(block_request);
+}
 
-    block_request = NULL;
+// Worker side of the overflow list. Process context, so it sleeps on a
+// full queue until a completion has dispatched from it. A non empty queue
+// always has requests in flight, so that completion comes.
+static void disk_overflow_work(work_t* work)
+{
+    block_dev_disk_t* disk_data = work->ctx;
 
-    spinlock_lock(&stor_dev->lock);
-    if (stor_dev->active_requests < stor_dev->max_requests && 
-        !ring_queue_is_empty(queue))
+    while (true)
     {
-        block_request_t* next = ring_queue_pop(queue);
-        stor_request_t*  next_stor_request = block_disk_make_stor_request(next);
-        assert(stor_submit(next_stor_request) ) ;
+        spinlock_lock(&disk_data->overflow_lock);
+
+        block_request_t* request = disk_data->overflow_head;
+        if (request)
+        {
+            disk_data->overflow_head = request->next;
+            if (disk_data->overflow_head == NULL)
+            {
+                disk_data->overflow_tail = &disk_data->overflow_head;
+            }
+        }
+
+        spinlock_unlock(&disk_data->overflow_lock);
+
+        if (request == NULL)
+        {
+            return;
+        }
+
+        if (!mpmc_ring_push(&disk_data->queue, request))
+        {
+            disk_dispatch(disk_data);
+
+            wait_event(&disk_data->overflow_room, mpmc_ring_push(&disk_data->queue, request));
+        }
+
+        // only now may new submits skip the list
+        atomic_fetch_sub(&disk_data->overflow_count, 1);
+
+        // the push is visible before the slot check
+        atomic_thread_fence(memory_order_seq_cst);
+
+        disk_dispatch(disk_data);
     }
-    spinlock_unlock(&stor_dev->lock);
+}
+
+// Only the completions free queue room, and they may be the ones
+// submitting (the IDE tasklet), so a full queue hands off to the
+// workqueue rather than wait
+static void disk_defer_submit(block_dev_disk_t* disk_data, block_request_t* request)
+{
+    request->next = NULL;
+
+    spinlock_lock(&disk_data->overflow_lock);
+
+    *disk_data->overflow_tail = request;
+    disk_data->overflow_tail = &request->next;
+    atomic_fetch_add(&disk_data->overflow_count, 1);
+
+    spinlock_unlock(&disk_data->overflow_lock);
+
+    queue_work(&disk_data->overflow_work);
 }
 
 static void block_submit_disk(block_request_t* block_request)
 {
     block_dev_disk_t* disk_data = &block_request->device->data.disk;
-    stor_device_t* hw_device = disk_data->hw_device;
-    
-    ring_queue_t* queue = &disk_data->queue;
 
-    spinlock_lock(&hw_device->lock);
-    bool can_add_request = hw_device->active_requests < hw_device->max_requests;
-    spinlock_unlock(&hw_device->lock);
-    
-    if (can_add_request)
-    {
-        stor_request_t* stor_request = block_disk_make_stor_request(block_request);        
-        stor_submit(stor_request);
-    }
-    else 
+    // always through the queue so requests reach the disk in order, and
+    // behind any that overflowed before
+    if (atomic_load(&disk_data->overflow_count) != 0 ||
+        !mpmc_ring_push(&disk_data->queue, block_request))
     {
-        ring_queue_push(queue, block_request);
+        disk_defer_submit(disk_data, block_request);
+        return;
     }
+
+    // the push is visible before the slot check
+    atomic_thread_fence(memory_order_seq_cst);
+
+    disk_dispatch(disk_data);
 }
 
 block_device_t* block_disk_generate(stor_device_t* stor_dev)
@@ -119,7 +226,16 @@ block_device_t* block_disk_generate(stor_device_t* stor_dev)
     block_device->block_count = stor_dev->disk_size / stor_dev->sector_size;
 
     block_device->data.disk.hw_device = stor_dev;
-    ring_queue_init(&block_device->data.disk.queue);
+    mpmc_ring_init(&block_device->data.disk.queue, BLOCK_DISK_QUEUE_CAPACITY);
+    atomic_init(&block_device->data.disk.in_flight, 0);
+
+    block_dev_disk_t* disk_data = &block_device->data.disk;
+    spinlock_initlock(&disk_data->overflow_lock, false);
+    disk_data->overflow_head = NULL;
+    disk_data->overflow_tail = &disk_data->overflow_head;
+    atomic_init(&disk_data->overflow_count, 0);
+    work_init(&disk_data->overflow_work, disk_overflow_work, disk_data);
+    wait_queue_init(&disk_data->overflow_room);
     
     return block_device;
 }
\ No newline at end of file
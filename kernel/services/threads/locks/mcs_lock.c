@@ -0,0 +1,132 @@
+#include "services/threads/locks/mcs_lock.h"
+#include "kernel/core/cpu.h"
+#include "kernel/interrupts/irq.h"
+#include <stdatomic.h>
+
+#ifdef LOCK_STATS
+#define mcs_record(lock, spin_cycles) lock_stats_record(&(lock)->stats, spin_cycles)
+#define mcs_record_release(lock) lock_stats_record_release(&(lock)->stats)
+#else
+#define mcs_record(lock, spin_cycles) ((void)(spin_cycles))
+#define mcs_record_release(lock) ((void)0)
+#endif
+
+void mcs_lock_init(mcs_lock_t* lock)
+{
+    lock->tail = NULL; // not atom on init
+
+#ifdef LOCK_STATS
+    lock_stats_reset(&lock->stats);
+#endif
+}
+
+void mcs_lock(mcs_lock_t* lock, mcs_node_t* node)
+{
+    uptr irq_state = irq_save();
+
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&node->locked, true, memory_order_relaxed);
+
+    mcs_node_t* prev = atomic_exchange_explicit(&lock->tail, node, memory_order_acq_rel);
+
+    u64 spin_cycles = 0;
+    if (prev)
+    {
+#ifdef LOCK_STATS
+        u64 start = cpu_cycles();
+#endif
+
+        atomic_store_explicit(&prev->next, node, memory_order_release);
+
+        // prev's unlock clears our flag, nobody else touches this line
+        while (atomic_load_explicit(&node->locked, memory_order_acquire))
+        {
+            cpu_relax();
+        }
+
+#ifdef LOCK_STATS
+        spin_cycles = cpu_cycles() - start;
+#endif
+        spin_cycles = spin_cycles ? spin_cycles : 1;
+    }
+
+    node->irq_data = irq_state;
+
+    mcs_record(lock, spin_cycles);
+}
+
+bool mcs_try_lock(mcs_lock_t* lock, mcs_node_t* node)
+{
+    uptr irq_state = irq_save();
+
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+
+    mcs_node_t* expected = NULL;
+    if (atomic_compare_exchange_strong_explicit(
+            &lock->tail,
+            &expected,
+            node,
+            memory_order_acquire,
+            memory_order_relaxed))
+    {
+        node->irq_data = irq_state;
+
+        mcs_record(lock, 0);
+
+        return true;
+    }
+
+    irq_restore(irq_state);
+
+    return false;
+}
+
+void mcs_unlock(mcs_lock_t* lock, mcs_node_t* node)
+{
+    mcs_record_release(lock);
+
+    uptr irq_state = node->irq_data;
+
+    mcs_node_t* next = atomic_load_explicit(&node->next, memory_order_acquire);
+
+    if (next == NULL)
+    {
+        // no successor yet, try to mark the lock free
+        mcs_node_t* expected = node;
+        if (atomic_compare_exchange_strong_explicit(
+                &lock->tail,
+                &expected,
+                NULL,
+                memory_order_release,
+                memory_order_relaxed))
+        {
+            irq_restore(irq_state);
+            return;
+        }
+
+        // a waiter swapped the tail but hasn't linked itself in yet
+        while ((next = atomic_load_explicit(&node->next, memory_order_acquire)) == NULL)
+        {
+            cpu_relax();
+        }
+    }
+
+    atomic_store_explicit(&next->locked, false, memory_order_release);
+
+    irq_restore(irq_state);
+}
+
+bool mcs_is_locked(mcs_lock_t* lock)
+{
+    return atomic_load(&lock->tail) != NULL;
+}
+
+const lock_stats_t* mcs_get_stats(mcs_lock_t* lock)
+{
+#ifdef LOCK_STATS
+    return &lock->stats;
+#else
+    (void)lock;
+    return NULL;
+#endif
+}
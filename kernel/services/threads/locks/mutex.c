@@ -0,0 +1,123 @@
+#include "services/threads/locks/mutex.h"
+#include "kernel/core/cpu.h"
+#include "kernel/core/smp.h"
+#include <stdatomic.h>
+
+// polls before going to sleep, a short hold on another CPU ends sooner
+// than a sleep and wakeup round trip
+#define MUTEX_SPIN_LIMIT 1000
+
+#ifdef LOCK_STATS
+#define mutex_record(mutex, wait_cycles) lock_stats_record(&(mutex)->stats, wait_cycles)
+#define mutex_record_release(mutex) lock_stats_record_release(&(mutex)->stats)
+#else
+#define mutex_record(mutex, wait_cycles) ((void)(wait_cycles))
+#define mutex_record_release(mutex) ((void)0)
+#endif
+
+void mutex_init(mutex_t* mutex)
+{
+    mutex->state = MUTEX_UNLOCKED; // not atom on init
+    wait_queue_init(&mutex->wait);
+
+#ifdef LOCK_STATS
+    lock_stats_reset(&mutex->stats);
+#endif
+}
+
+static bool mutex_try_acquire(mutex_t* mutex)
+{
+    u32 expected = MUTEX_UNLOCKED;
+
+    return atomic_compare_exchange_strong_explicit(
+        &mutex->state,
+        &expected,
+        MUTEX_LOCKED,
+        memory_order_acquire,
+        memory_order_relaxed
+    );
+}
+
+static void mutex_lock_slow(mutex_t* mutex)
+{
+    if (smp_cpu_count() > 1)
+    {
+        for (u32 i = 0; i < MUTEX_SPIN_LIMIT; i++)
+        {
+            if (atomic_load_explicit(&mutex->state, memory_order_relaxed) == MUTEX_UNLOCKED &&
+                mutex_try_acquire(mutex))
+            {
+                return;
+            }
+
+            cpu_relax();
+        }
+    }
+
+    // taken as CONTENDED from here on, so the unlock knows to wake us.
+    // A wakeup with nobody left asleep only costs that unlock a wake call.
+    wait_event(
+        &mutex->wait,
+        atomic_exchange_explicit(&mutex->state, MUTEX_CONTENDED, memory_order_acquire) == MUTEX_UNLOCKED
+    );
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+    if (mutex_try_acquire(mutex))
+    {
+        mutex_record(mutex, 0);
+        return;
+    }
+
+#ifdef LOCK_STATS
+    u64 start = cpu_cycles();
+#endif
+
+    mutex_lock_slow(mutex);
+
+#ifdef LOCK_STATS
+    u64 waited = cpu_cycles() - start;
+    mutex_record(mutex, waited ? waited : 1);
+#endif
+}
+
+bool mutex_try_lock(mutex_t* mutex)
+{
+    if (mutex_try_acquire(mutex) == false)
+    {
+        return false;
+    }
+
+    mutex_record(mutex, 0);
+
+    return true;
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+    mutex_record_release(mutex);
+
+    u32 state = atomic_exchange_explicit(&mutex->state, MUTEX_UNLOCKED, memory_order_release);
+    assert(state != MUTEX_UNLOCKED);
+
+    if (state == MUTEX_CONTENDED)
+    {
+        wake_up_one(&mutex->wait);
+    }
+}
+
+bool mutex_is_locked(mutex_t* mutex)
+{
+    return atomic_load(&mutex->state) != MUTEX_UNLOCKED;
+}
+
+const lock_stats_t* mutex_get_stats(mutex_t* mutex)
+{
+#ifdef LOCK_STATS
+    return &mutex->stats;
+#else
+    (void)mutex;
+    return NULL;
+#endif
+}
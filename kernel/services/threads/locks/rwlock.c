@@ -0,0 +1,143 @@
+#include "services/threads/locks/rwlock.h"
+#include "kernel/core/cpu.h"
+#include "kernel/interrupts/irq.h"
+#include <stdatomic.h>
+
+#ifdef LOCK_STATS
+#define rwlock_record(lock, spin_cycles) lock_stats_record(&(lock)->stats, spin_cycles)
+#define rwlock_record_release(lock) lock_stats_record_release(&(lock)->stats)
+#else
+#define rwlock_record(lock, spin_cycles) ((void)(spin_cycles))
+#define rwlock_record_release(lock) ((void)0)
+#endif
+
+void rwlock_init(rwlock_t* lock)
+{
+    lock->value = 0; // not atom on init
+    lock->irq_data = 0;
+
+#ifdef LOCK_STATS
+    lock_stats_reset(&lock->stats);
+#endif
+}
+
+uptr rwlock_read_lock(rwlock_t* lock)
+{
+    uptr irq_state = irq_save();
+
+    while (true)
+    {
+        u32 value = atomic_load_explicit(&lock->value, memory_order_relaxed);
+
+        if ((value & (RWLOCK_WRITER | RWLOCK_WRITER_WAITING)) == 0 &&
+            atomic_compare_exchange_weak_explicit(
+                &lock->value,
+                &value,
+                value + 1,
+                memory_order_acquire,
+                memory_order_relaxed))
+        {
+            return irq_state;
+        }
+
+        cpu_relax();
+    }
+}
+
+void rwlock_read_unlock(rwlock_t* lock, uptr irq_state)
+{
+    atomic_fetch_sub_explicit(&lock->value, 1, memory_order_release);
+
+    irq_restore(irq_state);
+}
+
+// takes the lock if no reader or writer has it, keeps the waiting bit of
+// other writers out of the way
+static bool rwlock_write_try_acquire(rwlock_t* lock)
+{
+    u32 value = atomic_load_explicit(&lock->value, memory_order_relaxed);
+
+    if ((value & ~RWLOCK_WRITER_WAITING) != 0)
+    {
+        return false;
+    }
+
+    return atomic_compare_exchange_strong_explicit(
+        &lock->value,
+        &value,
+        RWLOCK_WRITER,
+        memory_order_acquire,
+        memory_order_relaxed
+    );
+}
+
+void rwlock_write_lock(rwlock_t* lock)
+{
+    uptr irq_state = irq_save();
+
+    u64 spin_cycles = 0;
+    if (rwlock_write_try_acquire(lock) == false)
+    {
+#ifdef LOCK_STATS
+        u64 start = cpu_cycles();
+#endif
+
+        // the bit is cleared by whichever writer gets in next, the
+        // others set it again on their next round
+        while (rwlock_write_try_acquire(lock) == false)
+        {
+            atomic_fetch_or_explicit(&lock->value, RWLOCK_WRITER_WAITING, memory_order_relaxed);
+            cpu_relax();
+        }
+
+#ifdef LOCK_STATS
+        spin_cycles = cpu_cycles() - start;
+#endif
+        spin_cycles = spin_cycles ? spin_cycles : 1;
+    }
+
+    lock->irq_data = irq_state;
+
+    rwlock_record(lock, spin_cycles);
+}
+
+bool rwlock_write_try_lock(rwlock_t* lock)
+{
+    uptr irq_state = irq_save();
+
+    if (rwlock_write_try_acquire(lock))
+    {
+        lock->irq_data = irq_state;
+
+        rwlock_record(lock, 0);
+
+        return true;
+    }
+
+    irq_restore(irq_state);
+
+    return false;
+}
+
+void rwlock_write_unlock(rwlock_t* lock)
+{
+    rwlock_record_release(lock);
+
+    uptr irq_state = lock->irq_data;
+    lock->irq_data = 0;
+
+    // a writer that is still waiting sets its bit again
+    atomic_store_explicit(&lock->value, 0, memory_order_release);
+
+    irq_restore(irq_state);
+}
+
+const lock_stats_t* rwlock_get_stats(rwlock_t* lock)
+{
+#ifdef LOCK_STATS
+    return &lock->stats;
+#else
+    (void)lock;
+    return NULL;
+#endif
+}
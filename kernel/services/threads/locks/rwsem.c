@@ -0,0 +1,140 @@
+#include "services/threads/locks/rwsem.h"
+#include "kernel/core/cpu.h"
+#include <stdatomic.h>
+
+#ifdef LOCK_STATS
+#define rwsem_record(sem, wait_cycles) lock_stats_record(&(sem)->stats, wait_cycles)
+#define rwsem_record_release(sem) lock_stats_record_release(&(sem)->stats)
+#else
+#define rwsem_record(sem, wait_cycles) ((void)(wait_cycles))
+#define rwsem_record_release(sem) ((void)0)
+#endif
+
+void rwsem_init(rw_semaphore_t* sem)
+{
+    sem->count = 0; // not atom on init
+    sem->writers_waiting = 0;
+
+    wait_queue_init(&sem->read_wait);
+    wait_queue_init(&sem->write_wait);
+
+#ifdef LOCK_STATS
+    lock_stats_reset(&sem->stats);
+#endif
+}
+
+bool rwsem_read_try_lock(rw_semaphore_t* sem)
+{
+    u32 count = atomic_load_explicit(&sem->count, memory_order_relaxed);
+
+    while ((count & RWSEM_WRITER) == 0 &&
+           atomic_load_explicit(&sem->writers_waiting, memory_order_relaxed) == 0)
+    {
+        if (atomic_compare_exchange_weak_explicit(
+                &sem->count,
+                &count,
+                count + 1,
+                memory_order_acquire,
+                memory_order_relaxed))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void rwsem_read_lock(rw_semaphore_t* sem)
+{
+    if (rwsem_read_try_lock(sem))
+    {
+        return;
+    }
+
+    // the writer that clears the last blocking condition wakes us
+    wait_event(&sem->read_wait, rwsem_read_try_lock(sem));
+}
+
+void rwsem_read_unlock(rw_semaphore_t* sem)
+{
+    u32 count = atomic_fetch_sub_explicit(&sem->count, 1, memory_order_release) - 1;
+
+    if (count == 0 && atomic_load(&sem->writers_waiting))
+    {
+        wake_up_one(&sem->write_wait);
+    }
+}
+
+static bool rwsem_write_try_acquire(rw_semaphore_t* sem)
+{
+    u32 expected = 0;
+
+    return atomic_compare_exchange_strong_explicit(
+        &sem->count,
+        &expected,
+        RWSEM_WRITER,
+        memory_order_acquire,
+        memory_order_relaxed
+    );
+}
+
+bool rwsem_write_try_lock(rw_semaphore_t* sem)
+{
+    if (rwsem_write_try_acquire(sem) == false)
+    {
+        return false;
+    }
+
+    rwsem_record(sem, 0);
+
+    return true;
+}
+
+void rwsem_write_lock(rw_semaphore_t* sem)
+{
+    if (rwsem_write_try_lock(sem))
+    {
+        return;
+    }
+
+#ifdef LOCK_STATS
+    u64 start = cpu_cycles();
+#endif
+
+    // new readers back off from here on
+    atomic_fetch_add(&sem->writers_waiting, 1);
+
+    wait_event(&sem->write_wait, rwsem_write_try_acquire(sem));
+
+    atomic_fetch_sub(&sem->writers_waiting, 1);
+
+#ifdef LOCK_STATS
+    u64 waited = cpu_cycles() - start;
+    rwsem_record(sem, waited ? waited : 1);
+#endif
+}
+
+void rwsem_write_unlock(rw_semaphore_t* sem)
+{
+    rwsem_record_release(sem);
+
+    atomic_store_explicit(&sem->count, 0, memory_order_release);
+
+    // writers first, the last of them lets the readers in
+    if (atomic_load(&sem->writers_waiting) && wake_up_one(&sem->write_wait))
+    {
+        return;
+    }
+
+    wake_up_all(&sem->read_wait);
+}
+
+const lock_stats_t* rwsem_get_stats(rw_semaphore_t* sem)
+{
+#ifdef LOCK_STATS
+    return &sem->stats;
+#else
+    (void)sem;
+    return NULL;
+#endif
+}
@@ -3,47 +3,94 @@
 #include "kernel/interrupts/irq.h"
 #include <stdatomic.h>
 
+#ifdef LOCK_STATS
+#define spinlock_record(lock, spin_cycles) lock_stats_record(&(lock)->stats, spin_cycles)
+#define spinlock_record_release(lock) lock_stats_record_release(&(lock)->stats)
+#else
+#define spinlock_record(lock, spin_cycles) ((void)(spin_cycles))
+#define spinlock_record_release(lock) ((void)0)
+#endif
+
 void spinlock_initlock(spinlock_t* lock, bool start_locked)
 {
-    lock->locked = false; // not atom on init
-    
+    lock->ticket = 0; // not atom on init
+    lock->irq_data = 0;
+
+#ifdef LOCK_STATS
+    lock_stats_reset(&lock->stats);
+#endif
+
     if (start_locked)
     {
         spinlock_lock(lock);
     }
 }
 
+// spins on plain loads, the line stays shared until the owner hands off,
+// returns the cycles waited (at least 1)
+static u64 spinlock_wait(spinlock_t* lock, u16 ticket)
+{
+#ifdef LOCK_STATS
+    u64 start = cpu_cycles();
+#endif
+
+    u16 owner;
+    while ((owner = atomic_load_explicit(&lock->owner, memory_order_acquire)) != ticket)
+    {
+        // back off in proportion to our place in line
+        u16 ahead = ticket - owner;
+        for (u16 i = 0; i < ahead; i++)
+        {
+            cpu_relax();
+        }
+    }
+
+#ifdef LOCK_STATS
+    u64 waited = cpu_cycles() - start;
+    return waited ? waited : 1;
+#else
+    return 1;
+#endif
+}
+
 void spinlock_lock(spinlock_t* lock)
 {
     uptr irq_state = irq_save();
 
-    // acquire must as a "compiler hint"
-    // return old, while (it was true, cpu_relax())
-    while (atomic_exchange_explicit(
-        &lock->locked,
-        true,
-        memory_order_acquire))
+    u16 ticket = atomic_fetch_add_explicit(&lock->next, 1, memory_order_relaxed);
+
+    u64 spin_cycles = 0;
+    if (atomic_load_explicit(&lock->owner, memory_order_acquire) != ticket)
     {
-        cpu_relax();
+        spin_cycles = spinlock_wait(lock, ticket);
     }
 
     lock->irq_data = irq_state;
+
+    spinlock_record(lock, spin_cycles);
 }
 
 bool spinlock_try_lock(spinlock_t* lock)
 {
     uptr irq_state = irq_save();
 
-    bool was_locked = atomic_exchange_explicit(
-        &lock->locked,
-        true,
-        memory_order_acquire
-    );
+    u32 value = atomic_load_explicit(&lock->ticket, memory_order_relaxed);
+    u16 owner = value & 0xFFFF;
+    u16 next = value >> 16;
 
-    if (was_locked == false)
+    // take the next ticket only if it is served right away
+    if (owner == next && 
+        atomic_compare_exchange_strong_explicit(
+            &lock->ticket,
+            &value,
+            value + (1u << 16),
+            memory_order_acquire,
+            memory_order_relaxed))
     {
         lock->irq_data = irq_state;
 
+        spinlock_record(lock, 0);
+
         return true;
     }
 
@@ -54,18 +101,45 @@ bool spinlock_try_lock(spinlock_t* lock)
 
 bool spinlock_is_locked(spinlock_t* lock)
 {
-    return atomic_load(&lock->locked);
+    u32 value = atomic_load(&lock->ticket);
+
+    return (value & 0xFFFF) != (value >> 16);
 }
 
 void spinlock_unlock(spinlock_t *lock)
 {
+    spinlock_record_release(lock);
+
+    // the next holder overwrites irq_data as soon as it gets the lock
+    uptr irq_state = lock->irq_data;
+    lock->irq_data = 0;
+
+    // only the holder writes owner, no locked op needed
+    u16 owner = atomic_load_explicit(&lock->owner, memory_order_relaxed);
     atomic_store_explicit(
-        &lock->locked,
-        false,
+        &lock->owner,
+        (u16)(owner + 1),
         memory_order_release
     );
 
-    irq_restore(lock->irq_data);
+    irq_restore(irq_state);
+}
 
-    lock->irq_data = 0;
-}
\ No newline at end of file
+const lock_stats_t* spinlock_get_stats(spinlock_t* lock)
+{
+#ifdef LOCK_STATS
+    return &lock->stats;
+#else
+    (void)lock;
+    return NULL;
+#endif
+}
+
+void spinlock_reset_stats(spinlock_t* lock)
+{
+#ifdef LOCK_STATS
+    lock_stats_reset(&lock->stats);
+#else
+    (void)lock;
+#endif
+}
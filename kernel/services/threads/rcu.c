@@ -0,0 +1,152 @@
+#include <services/threads/rcu.h>
+#include <services/threads/sched.h>
+#include <services/threads/workqueue.h>
+#include <services/threads/locks/spinlock.h>
+#include <kernel/core/cpu.h>
+#include <kernel/core/smp.h>
+#include <stdatomic.h>
+
+DEFINE_PER_CPU(u32, rcu_nesting);
+DEFINE_PER_CPU(usize_ptr, rcu_irq_flags);
+
+// last grace period number this CPU saw while quiescent
+DEFINE_PER_CPU(u32, rcu_qs_seq);
+
+// bumped by every synchronize_rcu, wraps
+static atom_u32 gp_seq;
+
+// callbacks waiting for a grace period, LIFO
+static spinlock_t pending_lock;
+static rcu_head_t* pending;
+
+static work_t gp_work;
+static atom_bool rcu_ready;
+
+void rcu_note_qs()
+{
+    assert(this_cpu_read(rcu_nesting) == 0);
+
+    // the CPU's earlier reads complete before the report is visible
+    atomic_thread_fence(memory_order_release);
+
+    this_cpu_write(rcu_qs_seq, atomic_load_explicit(&gp_seq, memory_order_relaxed));
+}
+
+static bool cpu_passed(u32 cpu, u32 target)
+{
+    u32 seen = __atomic_load_n(per_cpu_ptr(rcu_qs_seq, cpu), __ATOMIC_ACQUIRE);
+
+    return (i32)(seen - target) >= 0;
+}
+
+void synchronize_rcu()
+{
+    assert(this_cpu_read(rcu_nesting) == 0);
+
+    u32 target = atomic_fetch_add(&gp_seq, 1) + 1;
+
+    if (smp_cpu_count() == 1)
+    {
+        // irqs enabled here means no reader is interrupted on this CPU
+        return;
+    }
+
+    // halted CPUs may not take an irq for a long time, wake them once
+    u32 kicked = 0;
+
+    while (true)
+    {
+        // the caller is quiescent on whichever CPU it runs now
+        rcu_note_qs();
+
+        bool done = true;
+        for (u32 cpu = 0; cpu < MAX_CPUS; cpu++)
+        {
+            if (smp_cpu_online(cpu) == false || cpu_passed(cpu, target))
+            {
+                continue;
+            }
+
+            done = false;
+
+            if ((kicked & (1u << cpu)) == 0)
+            {
+                kicked |= 1u << cpu;
+                smp_send_reschedule(cpu);
+            }
+        }
+
+        if (done)
+        {
+            return;
+        }
+
+        if (sched_can_block())
+        {
+            thread_yield();
+        }
+        else
+        {
+            cpu_relax();
+        }
+    }
+}
+
+static void gp_work_fn(work_t* work)
+{
+    (void)work;
+
+    spinlock_lock(&pending_lock);
+    rcu_head_t* batch = pending;
+    pending = NULL;
+    spinlock_unlock(&pending_lock);
+
+    if (batch == NULL)
+    {
+        return;
+    }
+
+    // one grace period for the whole batch
+    synchronize_rcu();
+
+    while (batch)
+    {
+        rcu_head_t* next = batch->next;
+        batch->fn(batch);
+        batch = next;
+    }
+}
+
+void init_rcu()
+{
+    work_init(&gp_work, gp_work_fn, NULL);
+
+    atomic_store(&rcu_ready, true);
+
+    spinlock_lock(&pending_lock);
+    bool queued = pending != NULL;
+    spinlock_unlock(&pending_lock);
+
+    if (queued)
+    {
+        queue_work(&gp_work);
+    }
+}
+
+void call_rcu(rcu_head_t* head, rcu_callback_t fn)
+{
+    assert(head && fn);
+
+    head->fn = fn;
+
+    spinlock_lock(&pending_lock);
+    head->next = pending;
+    pending = head;
+    spinlock_unlock(&pending_lock);
+
+    // a run already in progress took its batch, a new one is queued
+    if (atomic_load(&rcu_ready))
+    {
+        queue_work(&gp_work);
+    }
+}
@@ -0,0 +1,603 @@
+#include <services/threads/sched.h>
+#include <services/threads/softirq.h>
+#include <services/threads/rcu.h>
+#include <kernel/core/context.h>
+#include <kernel/core/cpu.h>
+#include <kernel/core/smp.h>
+#include <kernel/devices/clock.h>
+#include <kernel/interrupts/irq.h>
+#include <memory/heap/heap.h>
+#include <memory/virt/virt_alloc.h>
+#include <stdatomic.h>
+
+static run_queue_t run_queues[MAX_CPUS];
+static atom_u32 next_thread_id;
+static bool sched_initialized;
+
+static inline run_queue_t* this_rq()
+{
+    return &run_queues[cpu_id()];
+}
+
+// rq lock must be held
+static void rq_push_tail(run_queue_t* rq, thread_t* thread)
+{
+    thread->next = NULL;
+    thread->prev = rq->tail;
+
+    if (rq->tail)
+    {
+        rq->tail->next = thread;
+    }
+    else
+    {
+        rq->head = thread;
+    }
+    rq->tail = thread;
+
+    atomic_fetch_add(&rq->count, 1);
+}
+
+// rq lock must be held
+static thread_t* rq_pop_head(run_queue_t* rq)
+{
+    thread_t* thread = rq->head;
+    if (!thread)
+    {
+        return NULL;
+    }
+
+    rq->head = thread->next;
+    if (rq->head)
+    {
+        rq->head->prev = NULL;
+    }
+    else
+    {
+        rq->tail = NULL;
+    }
+
+    thread->next = NULL;
+    atomic_fetch_sub(&rq->count, 1);
+
+    return thread;
+}
+
+// rq lock must be held
+static thread_t* rq_pop_tail(run_queue_t* rq)
+{
+    thread_t* thread = rq->tail;
+    if (!thread)
+    {
+        return NULL;
+    }
+
+    rq->tail = thread->prev;
+    if (rq->tail)
+    {
+        rq->tail->next = NULL;
+    }
+    else
+    {
+        rq->head = NULL;
+    }
+
+    thread->prev = NULL;
+    atomic_fetch_sub(&rq->count, 1);
+
+    return thread;
+}
+
+// rq lock must be held
+static void rq_remove(run_queue_t* rq, thread_t* thread)
+{
+    if (thread->prev)
+    {
+        thread->prev->next = thread->next;
+    }
+    else
+    {
+        rq->head = thread->next;
+    }
+
+    if (thread->next)
+    {
+        thread->next->prev = thread->prev;
+    }
+    else
+    {
+        rq->tail = thread->prev;
+    }
+
+    thread->next = NULL;
+    thread->prev = NULL;
+    atomic_fetch_sub(&rq->count, 1);
+}
+
+// takes the most recently queued thread of the busiest other CPU
+static thread_t* steal_thread(u32 self)
+{
+    run_queue_t* victim = NULL;
+    u32 victim_count = 0;
+
+    for (u32 cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        u32 count = atomic_load_explicit(&run_queues[cpu].count, memory_order_relaxed);
+        if (cpu != self && count > victim_count)
+        {
+            victim = &run_queues[cpu];
+            victim_count = count;
+        }
+    }
+
+    if (!victim || !spinlock_try_lock(&victim->lock))
+    {
+        return NULL;
+    }
+
+    // a thread woken before it finished switching out still owns its stack
+    thread_t* thread = NULL;
+    if (victim->tail && !victim->tail->pinned && !atomic_load(&victim->tail->on_cpu))
+    {
+        thread = rq_pop_tail(victim);
+    }
+
+    spinlock_unlock(&victim->lock);
+
+    if (thread)
+    {
+        thread->cpu = self;
+    }
+
+    return thread;
+}
+
+// gets rq's CPU to look at its queue after something was pushed on it.
+// Only the owner starts its slice timer, another CPU gets an IPI and arms
+// it from the schedule() that follows.
+static void rq_kick(run_queue_t* rq)
+{
+    usize_ptr irq_flags = irq_save();
+
+    if (rq != this_rq() || rq->current == rq->idle)
+    {
+        rq->need_resched = true;
+        smp_send_reschedule(rq->cpu);
+    }
+    else if (!ktimer_pending(&rq->slice_timer))
+    {
+        ktimer_start_in(&rq->slice_timer, SCHED_SLICE_NS);
+    }
+
+    irq_restore(irq_flags);
+}
+
+// least loaded online CPU, an idle one wins outright
+static run_queue_t* pick_rq()
+{
+    run_queue_t* best = this_rq();
+    u32 best_count = atomic_load_explicit(&best->count, memory_order_relaxed);
+
+    for (u32 cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        run_queue_t* rq = &run_queues[cpu];
+        if (!smp_cpu_online(cpu) || rq->idle == NULL)
+        {
+            continue;
+        }
+
+        u32 count = atomic_load_explicit(&rq->count, memory_order_relaxed);
+        if (count == 0 && rq->current == rq->idle)
+        {
+            return rq;
+        }
+
+        if (count < best_count)
+        {
+            best = rq;
+            best_count = count;
+        }
+    }
+
+    return best;
+}
+
+static void slice_expired(ktimer_t* timer, void* ctx)
+{
+    (void)timer;
+
+    run_queue_t* rq = (run_queue_t*)ctx;
+
+    if (atomic_load(&rq->count))
+    {
+        rq->need_resched = true;
+
+        // the timer base fires on one CPU, the others need an IPI
+        smp_send_reschedule(rq->cpu);
+    }
+}
+
+static void free_thread(thread_t* thread)
+{
+    kvfree_pages(thread->stack);
+    kfree(thread);
+}
+
+// runs on the new thread's stack right after a switch
+static void finish_switch()
+{
+    run_queue_t* rq = this_rq();
+
+    if (rq->switched_from)
+    {
+        atomic_store(&rq->switched_from->on_cpu, false);
+        rq->switched_from = NULL;
+    }
+
+    thread_t* dead = rq->dead;
+    rq->dead = NULL;
+
+    if (dead)
+    {
+        free_thread(dead);
+    }
+}
+
+static void thread_start()
+{
+    finish_switch();
+
+    irq_enable();
+
+    thread_t* self = thread_current();
+    self->fn(self->arg);
+
+    thread_exit();
+}
+
+void init_sched()
+{
+    for (u32 cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        run_queue_t* rq = &run_queues[cpu];
+
+        spinlock_initlock(&rq->lock, false);
+        rq->cpu = cpu;
+        rq->head = NULL;
+        rq->tail = NULL;
+        rq->count = 0;
+        rq->current = NULL;
+        rq->idle = NULL;
+        rq->dead = NULL;
+        rq->switched_from = NULL;
+        rq->need_resched = false;
+        rq->switches = 0;
+
+        ktimer_init(&rq->slice_timer, slice_expired, rq);
+    }
+
+    sched_init_cpu();
+
+    sched_initialized = true;
+}
+
+void sched_init_cpu()
+{
+    run_queue_t* rq = this_rq();
+
+    // the boot flow becomes the idle thread, it keeps the boot stack
+    thread_t* idle = kmalloc(sizeof(thread_t));
+    assert(idle);
+
+    idle->sp = 0;
+    idle->stack = NULL;
+    idle->id = atomic_fetch_add(&next_thread_id, 1);
+    idle->name = "idle";
+    idle->state = THREAD_RUNNING;
+    idle->on_cpu = true;
+    idle->pinned = true;
+    idle->cpu = cpu_id();
+    idle->next = NULL;
+    idle->prev = NULL;
+    idle->fn = NULL;
+    idle->arg = NULL;
+    idle->runtime_ns = 0;
+    idle->switched_in_ns = clock_monotonic_ns();
+
+    rq->idle = idle;
+    rq->current = idle;
+}
+
+bool sched_ready()
+{
+    return sched_initialized;
+}
+
+thread_t* thread_current()
+{
+    if (!sched_initialized)
+    {
+        return NULL;
+    }
+
+    return this_rq()->current;
+}
+
+static thread_t* thread_alloc(const char* name, thread_fn_t fn, void* arg)
+{
+    assert(sched_initialized && fn);
+
+    thread_t* thread = kmalloc(sizeof(thread_t));
+    assert(thread);
+
+    thread->stack = kvalloc_pages(THREAD_STACK_PAGES, VREGION_STACK);
+    assert(thread->stack);
+
+    thread->sp = context_init_stack(
+        (u8*)thread->stack + THREAD_STACK_PAGES * PAGE_SIZE,
+        thread_start
+    );
+
+    thread->id = atomic_fetch_add(&next_thread_id, 1);
+    thread->name = name;
+    thread->state = THREAD_READY;
+    thread->on_cpu = false;
+    thread->pinned = false;
+    thread->fn = fn;
+    thread->arg = arg;
+    thread->runtime_ns = 0;
+    thread->switched_in_ns = 0;
+
+    return thread;
+}
+
+// irqs must be disabled, rq can't go stale between the pick and the push
+static void thread_enqueue(thread_t* thread, run_queue_t* rq)
+{
+    thread->cpu = rq->cpu;
+
+    spinlock_lock(&rq->lock);
+    rq_push_tail(rq, thread);
+    spinlock_unlock(&rq->lock);
+
+    rq_kick(rq);
+}
+
+thread_t* thread_create(const char* name, thread_fn_t fn, void* arg)
+{
+    thread_t* thread = thread_alloc(name, fn, arg);
+
+    usize_ptr irq_flags = irq_save();
+    thread_enqueue(thread, pick_rq());
+    irq_restore(irq_flags);
+
+    return thread;
+}
+
+thread_t* thread_create_on(u32 cpu, const char* name, thread_fn_t fn, void* arg)
+{
+    assert(smp_cpu_online(cpu));
+
+    thread_t* thread = thread_alloc(name, fn, arg);
+    thread->pinned = true;
+
+    usize_ptr irq_flags = irq_save();
+    thread_enqueue(thread, &run_queues[cpu]);
+    irq_restore(irq_flags);
+
+    return thread;
+}
+
+void schedule()
+{
+    usize_ptr irq_flags = irq_save();
+
+    run_queue_t* rq = this_rq();
+    thread_t* prev = rq->current;
+
+    rq->need_resched = false;
+
+    // read sections can't sleep, a switch is a quiescent state
+    rcu_note_qs();
+
+    spinlock_lock(&rq->lock);
+
+    if (prev->state == THREAD_RUNNING && prev != rq->idle)
+    {
+        prev->state = THREAD_READY;
+        rq_push_tail(rq, prev);
+    }
+
+    thread_t* next = rq_pop_head(rq);
+
+    // victims are only try-locked, holding ours meanwhile can't deadlock
+    if (!next)
+    {
+        next = steal_thread(cpu_id());
+    }
+
+    // Decided before the unlock: a blocked prev woken after it is queued
+    // by the waker and must not be resumed here as well. A prev that only
+    // yielded was requeued above and popped back if nothing else waits.
+    if (!next)
+    {
+        next = rq->idle;
+    }
+
+    next->state = THREAD_RUNNING;
+
+    spinlock_unlock(&rq->lock);
+
+    // keep slicing only while something else waits for the CPU
+    if (atomic_load(&rq->count))
+    {
+        ktimer_start_in(&rq->slice_timer, SCHED_SLICE_NS);
+    }
+    else
+    {
+        ktimer_cancel(&rq->slice_timer);
+    }
+
+    if (next == prev)
+    {
+        irq_restore(irq_flags);
+        return;
+    }
+
+    u64 now = clock_monotonic_ns();
+    prev->runtime_ns += now - prev->switched_in_ns;
+    next->switched_in_ns = now;
+
+    atomic_store(&next->on_cpu, true);
+    rq->current = next;
+    rq->switched_from = prev;
+    rq->switches++;
+
+    context_switch(&prev->sp, next->sp);
+
+    // back on prev's stack, possibly much later
+    finish_switch();
+
+    irq_restore(irq_flags);
+}
+
+void thread_yield()
+{
+    schedule();
+}
+
+void thread_exit()
+{
+    irq_disable();
+
+    run_queue_t* rq = this_rq();
+    thread_t* self = rq->current;
+
+    assert(self != rq->idle);
+
+    self->state = THREAD_DEAD;
+    // freed by whoever runs next, can't free the stack we stand on
+    rq->dead = self;
+
+    schedule();
+
+    // a dead thread is never picked again
+    abort();
+    __builtin_unreachable();
+}
+
+void sched_wake(thread_t* thread)
+{
+    run_queue_t* rq = &run_queues[thread->cpu];
+
+    spinlock_lock(&rq->lock);
+
+    if (thread->state != THREAD_BLOCKED)
+    {
+        spinlock_unlock(&rq->lock);
+        return;
+    }
+
+    thread->state = THREAD_READY;
+    rq_push_tail(rq, thread);
+
+    spinlock_unlock(&rq->lock);
+
+    rq_kick(rq);
+}
+
+void sched_request_resched()
+{
+    if (sched_initialized)
+    {
+        this_rq()->need_resched = true;
+    }
+}
+
+bool sched_can_block()
+{
+    if (!sched_initialized)
+    {
+        return false;
+    }
+
+    run_queue_t* rq = this_rq();
+
+    return rq->current != rq->idle;
+}
+
+void sched_block_prepare()
+{
+    run_queue_t* rq = this_rq();
+    thread_t* self = rq->current;
+
+    assert(self != rq->idle);
+
+    spinlock_lock(&rq->lock);
+    self->state = THREAD_BLOCKED;
+    spinlock_unlock(&rq->lock);
+}
+
+void sched_block_cancel()
+{
+    run_queue_t* rq = this_rq();
+    thread_t* self = rq->current;
+
+    spinlock_lock(&rq->lock);
+
+    // a wakeup that raced the cancel already queued us
+    if (self->state == THREAD_READY)
+    {
+        rq_remove(rq, self);
+    }
+    self->state = THREAD_RUNNING;
+
+    spinlock_unlock(&rq->lock);
+}
+
+void sched_irq_exit()
+{
+    if (!sched_initialized)
+    {
+        return;
+    }
+
+    run_queue_t* rq = this_rq();
+
+    // softirqs are not preempted midway, their irq exit handles it
+    if (rq->need_resched && !softirq_in_progress())
+    {
+        schedule();
+    }
+}
+
+void sched_idle()
+{
+    run_queue_t* rq = this_rq();
+
+    assert(rq->current == rq->idle);
+
+    while (true)
+    {
+        irq_disable();
+
+        if (rq->need_resched || atomic_load(&rq->count))
+        {
+            schedule();
+            continue;
+        }
+
+        // raised outside an irq (a tasklet requeued behind another CPU),
+        // no irq exit would run them before the next tick, if there is one
+        if (softirq_pending())
+        {
+            softirq_run_pending();
+            continue;
+        }
+
+        rcu_note_qs();
+
+        // sti;hlt back to back, a wakeup irq can't slip in between
+        cpu_idle();
+    }
+}
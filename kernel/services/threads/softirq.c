@@ -0,0 +1,194 @@
+#include <services/threads/softirq.h>
+#include <kernel/interrupts/irq.h>
+#include <kernel/core/cpu.h>
+#include <stdatomic.h>
+
+// bounds the time spent per irq exit, leftovers wait for the next one
+#define SOFTIRQ_MAX_RESTARTS 10
+
+#define EFLAGS_IF (1 << 9)
+
+typedef struct softirq_cpu
+{
+    atom_u32 pending;
+    // softirqs already running on this CPU (an irq hit them)
+    bool active;
+
+    tasklet_t* tasklet_head;
+    tasklet_t** tasklet_tail;
+} softirq_cpu_t;
+
+static softirq_cpu_t softirq_cpus[MAX_CPUS];
+static softirq_fn_t softirq_handlers[SOFTIRQ_COUNT];
+
+// must be entered with interrupts disabled, leaves them disabled
+static void do_softirq()
+{
+    softirq_cpu_t* cpu = &softirq_cpus[cpu_id()];
+
+    if (cpu->active)
+    {
+        return;
+    }
+
+    cpu->active = true;
+
+    u32 restarts = 0;
+    u32 pending;
+    while (restarts++ < SOFTIRQ_MAX_RESTARTS &&
+           (pending = atomic_exchange(&cpu->pending, 0)) != 0)
+    {
+        irq_enable();
+
+        while (pending)
+        {
+            u32 type = __builtin_ctz(pending);
+            pending &= pending - 1;
+
+            if (softirq_handlers[type])
+            {
+                softirq_handlers[type]();
+            }
+        }
+
+        irq_disable();
+    }
+
+    cpu->active = false;
+}
+
+// appends to this CPU's list and raises the softirq, irqs must be off
+static void tasklet_enqueue(softirq_cpu_t* cpu, tasklet_t* tasklet)
+{
+    tasklet->next = NULL;
+    *cpu->tasklet_tail = tasklet;
+    cpu->tasklet_tail = &tasklet->next;
+
+    softirq_raise(SOFTIRQ_TASKLET);
+}
+
+static void tasklet_action()
+{
+    softirq_cpu_t* cpu = &softirq_cpus[cpu_id()];
+
+    usize_ptr irq_flags = irq_save();
+
+    tasklet_t* tasklet = cpu->tasklet_head;
+    cpu->tasklet_head = NULL;
+    cpu->tasklet_tail = &cpu->tasklet_head;
+
+    irq_restore(irq_flags);
+
+    while (tasklet)
+    {
+        tasklet_t* next = tasklet->next;
+
+        // still running on another CPU (its irq moved here), try again
+        // on a later pass, it stays scheduled meanwhile
+        if (atomic_exchange(&tasklet->running, true))
+        {
+            irq_flags = irq_save();
+            tasklet_enqueue(cpu, tasklet);
+            irq_restore(irq_flags);
+
+            tasklet = next;
+            continue;
+        }
+
+        // may be rescheduled from inside fn
+        atomic_store(&tasklet->scheduled, false);
+
+        tasklet->fn(tasklet->ctx);
+
+        atomic_store(&tasklet->running, false);
+
+        tasklet = next;
+    }
+}
+
+void init_softirq()
+{
+    for (u32 i = 0; i < MAX_CPUS; i++)
+    {
+        softirq_cpus[i].pending = 0;
+        softirq_cpus[i].active = false;
+        softirq_cpus[i].tasklet_head = NULL;
+        softirq_cpus[i].tasklet_tail = &softirq_cpus[i].tasklet_head;
+    }
+
+    softirq_register(SOFTIRQ_TASKLET, tasklet_action);
+}
+
+void softirq_register(softirq_type_t type, softirq_fn_t fn)
+{
+    assert(type < SOFTIRQ_COUNT);
+
+    softirq_handlers[type] = fn;
+}
+
+void softirq_raise(softirq_type_t type)
+{
+    assert(type < SOFTIRQ_COUNT);
+
+    atomic_fetch_or(&softirq_cpus[cpu_id()].pending, 1u << type);
+}
+
+void softirq_irq_exit()
+{
+    if (atomic_load_explicit(&softirq_cpus[cpu_id()].pending, memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    do_softirq();
+}
+
+bool softirq_pending()
+{
+    return atomic_load_explicit(&softirq_cpus[cpu_id()].pending, memory_order_relaxed) != 0;
+}
+
+void softirq_run_pending()
+{
+    assert((irq_save() & EFLAGS_IF) == 0);
+
+    do_softirq();
+}
+
+bool softirq_in_progress()
+{
+    return softirq_cpus[cpu_id()].active;
+}
+
+void tasklet_init(tasklet_t* tasklet, tasklet_fn_t fn, void* ctx)
+{
+    assert(tasklet && fn);
+
+    tasklet->next = NULL;
+    tasklet->fn = fn;
+    tasklet->ctx = ctx;
+    tasklet->scheduled = false;
+    tasklet->running = false;
+}
+
+void tasklet_schedule(tasklet_t* tasklet)
+{
+    if (atomic_exchange(&tasklet->scheduled, true))
+    {
+        return;
+    }
+
+    usize_ptr irq_flags = irq_save();
+
+    softirq_cpu_t* cpu = &softirq_cpus[cpu_id()];
+
+    tasklet_enqueue(cpu, tasklet);
+
+    // not called from an irq, nothing else would pick it up soon
+    if (irq_flags & EFLAGS_IF)
+    {
+        do_softirq();
+    }
+
+    irq_restore(irq_flags);
+}
@@ -0,0 +1,211 @@
+#include <services/threads/wait_queue.h>
+#include <services/threads/sched.h>
+#include <kernel/interrupts/irq.h>
+#include <kernel/core/cpu.h>
+
+// complete_all leaves this many wakeups, decrements never run it out
+#define COMPLETION_DONE_ALL (UINT32_MAX / 2)
+
+// queue lock must be held
+static void entry_remove(wait_queue_t* queue, wait_entry_t* entry)
+{
+    *entry->pprev = entry->next;
+    if (entry->next)
+    {
+        entry->next->pprev = entry->pprev;
+    }
+    else
+    {
+        queue->tail = entry->pprev;
+    }
+
+    entry->next = NULL;
+    entry->pprev = NULL;
+}
+
+void wait_queue_init(wait_queue_t* queue)
+{
+    assert(queue);
+
+    spinlock_initlock(&queue->lock, false);
+    queue->head = NULL;
+    queue->tail = &queue->head;
+}
+
+usize_ptr wait_begin(wait_queue_t* queue, wait_entry_t* entry)
+{
+    (void)queue;
+
+    usize_ptr irq_flags = irq_save();
+
+    entry->thread = sched_can_block() ? thread_current() : NULL;
+    entry->next = NULL;
+    entry->pprev = NULL;
+
+    return irq_flags;
+}
+
+void wait_prepare(wait_queue_t* queue, wait_entry_t* entry)
+{
+    if (entry->thread == NULL)
+    {
+        return;
+    }
+
+    spinlock_lock(&queue->lock);
+
+    // a wakeup unlinks the entry, link it again for the next round
+    if (entry->pprev == NULL)
+    {
+        entry->pprev = queue->tail;
+        *queue->tail = entry;
+        queue->tail = &entry->next;
+    }
+
+    spinlock_unlock(&queue->lock);
+
+    // blocked before the condition check, a wake in between is kept
+    sched_block_prepare();
+}
+
+void wait_sleep(wait_queue_t* queue, wait_entry_t* entry)
+{
+    (void)queue;
+
+    if (entry->thread)
+    {
+        schedule();
+        return;
+    }
+
+    // sti;hlt back to back, the irq that sets the condition ends the halt
+    cpu_idle();
+    irq_disable();
+}
+
+void wait_end(wait_queue_t* queue, wait_entry_t* entry, usize_ptr irq_flags)
+{
+    if (entry->thread)
+    {
+        spinlock_lock(&queue->lock);
+
+        if (entry->pprev)
+        {
+            entry_remove(queue, entry);
+        }
+
+        spinlock_unlock(&queue->lock);
+
+        sched_block_cancel();
+    }
+
+    irq_restore(irq_flags);
+}
+
+// queue lock must be held
+static bool wake_one_locked(wait_queue_t* queue)
+{
+    wait_entry_t* entry = queue->head;
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    entry_remove(queue, entry);
+
+    // entry stays valid while the lock is held, wait_end takes it too
+    sched_wake(entry->thread);
+
+    return true;
+}
+
+// queue lock must be held
+static u32 wake_all_locked(wait_queue_t* queue)
+{
+    u32 woken = 0;
+
+    while (queue->head)
+    {
+        wait_entry_t* entry = queue->head;
+        entry_remove(queue, entry);
+
+        sched_wake(entry->thread);
+        woken++;
+    }
+
+    return woken;
+}
+
+bool wake_up_one(wait_queue_t* queue)
+{
+    spinlock_lock(&queue->lock);
+    bool woken = wake_one_locked(queue);
+    spinlock_unlock(&queue->lock);
+
+    return woken;
+}
+
+u32 wake_up_all(wait_queue_t* queue)
+{
+    spinlock_lock(&queue->lock);
+    u32 woken = wake_all_locked(queue);
+    spinlock_unlock(&queue->lock);
+
+    return woken;
+}
+
+void completion_init(completion_t* completion)
+{
+    assert(completion);
+
+    completion->done = 0;
+    wait_queue_init(&completion->wait);
+}
+
+// Taken under the queue lock, like complete(). A waiter that returns
+// here may free an on-stack completion, which the completer must be done
+// with by then.
+bool try_wait_for_completion(completion_t* completion)
+{
+    spinlock_lock(&completion->wait.lock);
+
+    bool done = completion->done != 0;
+    if (done)
+    {
+        completion->done--;
+    }
+
+    spinlock_unlock(&completion->wait.lock);
+
+    return done;
+}
+
+void wait_for_completion(completion_t* completion)
+{
+    if (try_wait_for_completion(completion))
+    {
+        return;
+    }
+
+    wait_event(&completion->wait, try_wait_for_completion(completion));
+}
+
+void complete(completion_t* completion)
+{
+    spinlock_lock(&completion->wait.lock);
+
+    completion->done++;
+    wake_one_locked(&completion->wait);
+
+    spinlock_unlock(&completion->wait.lock);
+}
+
+void complete_all(completion_t* completion)
+{
+    spinlock_lock(&completion->wait.lock);
+
+    completion->done = COMPLETION_DONE_ALL;
+    wake_all_locked(&completion->wait);
+
+    spinlock_unlock(&completion->wait.lock);
+}
@@ -0,0 +1,390 @@
+#include <services/threads/workqueue.h>
+#include <services/threads/sched.h>
+#include <services/threads/wait_queue.h>
+#include <kernel/interrupts/irq.h>
+#include <kernel/core/cpu.h>
+#include <kernel/core/smp.h>
+#include <stdatomic.h>
+
+#define WORK_DEQUE_MASK (WORK_DEQUE_SIZE - 1)
+
+// Chase-Lev deque. The owning CPU pushes and pops at bottom with irqs
+// disabled (so one owner context at a time), thieves take from top.
+typedef struct work_deque
+{
+    atom_i32 top;
+    atom_i32 bottom;
+    work_t* _Atomic slots[WORK_DEQUE_SIZE];
+} __attribute__((aligned(64))) work_deque_t;
+
+static work_deque_t deques[MAX_CPUS];
+
+// spill list for full deques, FIFO
+static spinlock_t overflow_lock;
+static work_t* overflow_head;
+static work_t** overflow_tail;
+static atom_u32 overflow_count;
+
+// idle workers of every CPU, any of them can steal
+static wait_queue_t idle_workers;
+// flush_work sleepers, woken whenever an instance finishes
+static wait_queue_t flush_waiters;
+
+static bool workqueue_ready;
+
+static bool deque_push(work_deque_t* deque, work_t* work)
+{
+    i32 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    i32 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+    if (bottom - top >= WORK_DEQUE_SIZE)
+    {
+        return false;
+    }
+
+    atomic_store_explicit(&deque->slots[bottom & WORK_DEQUE_MASK], work, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+
+    return true;
+}
+
+static work_t* deque_pop(work_deque_t* deque)
+{
+    i32 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+
+    // the bottom store must be visible before top is read, or a thief
+    // and the owner could both take the last item
+    atomic_thread_fence(memory_order_seq_cst);
+
+    i32 top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    if (top > bottom)
+    {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    work_t* work = atomic_load_explicit(&deque->slots[bottom & WORK_DEQUE_MASK], memory_order_relaxed);
+
+    // last item, race the thieves for it through top
+    if (top == bottom)
+    {
+        if (!atomic_compare_exchange_strong_explicit(
+                &deque->top, &top, top + 1,
+                memory_order_seq_cst, memory_order_relaxed))
+        {
+            work = NULL;
+        }
+
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+
+    return work;
+}
+
+static work_t* deque_steal(work_deque_t* deque)
+{
+    i32 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    i32 bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return NULL;
+    }
+
+    work_t* work = atomic_load_explicit(&deque->slots[top & WORK_DEQUE_MASK], memory_order_relaxed);
+
+    // lost to the owner or another thief, the caller moves on
+    if (!atomic_compare_exchange_strong_explicit(
+            &deque->top, &top, top + 1,
+            memory_order_seq_cst, memory_order_relaxed))
+    {
+        return NULL;
+    }
+
+    return work;
+}
+
+static bool deque_empty(work_deque_t* deque)
+{
+    i32 top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    i32 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+
+    return top >= bottom;
+}
+
+static void overflow_push(work_t* work)
+{
+    spinlock_lock(&overflow_lock);
+
+    work->next = NULL;
+    *overflow_tail = work;
+    overflow_tail = &work->next;
+    atomic_fetch_add(&overflow_count, 1);
+
+    spinlock_unlock(&overflow_lock);
+}
+
+static work_t* overflow_pop()
+{
+    if (atomic_load_explicit(&overflow_count, memory_order_relaxed) == 0)
+    {
+        return NULL;
+    }
+
+    spinlock_lock(&overflow_lock);
+
+    work_t* work = overflow_head;
+    if (work)
+    {
+        overflow_head = work->next;
+        if (overflow_head == NULL)
+        {
+            overflow_tail = &overflow_head;
+        }
+        atomic_fetch_sub(&overflow_count, 1);
+    }
+
+    spinlock_unlock(&overflow_lock);
+
+    return work;
+}
+
+static bool has_work()
+{
+    if (atomic_load_explicit(&overflow_count, memory_order_relaxed))
+    {
+        return true;
+    }
+
+    for (u32 cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        if (!deque_empty(&deques[cpu]))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// own deque newest first (cache warm), then the oldest work of the others
+static work_t* grab_work()
+{
+    u32 self = cpu_id();
+
+    usize_ptr irq_flags = irq_save();
+    work_t* work = deque_pop(&deques[self]);
+    irq_restore(irq_flags);
+
+    if (work)
+    {
+        return work;
+    }
+
+    for (u32 i = 1; i < MAX_CPUS; i++)
+    {
+        work = deque_steal(&deques[(self + i) % MAX_CPUS]);
+        if (work)
+        {
+            return work;
+        }
+    }
+
+    return overflow_pop();
+}
+
+static void run_work(work_t* work)
+{
+    // running before pending drops, flush never sees it idle in between
+    atomic_fetch_add(&work->running, 1);
+    atomic_store(&work->pending, false);
+
+    work->fn(work);
+
+    atomic_fetch_sub(&work->running, 1);
+
+    wake_up_all(&flush_waiters);
+}
+
+static bool run_one()
+{
+    work_t* work = grab_work();
+    if (work == NULL)
+    {
+        return false;
+    }
+
+    run_work(work);
+
+    return true;
+}
+
+static void worker_main(void* arg)
+{
+    (void)arg;
+
+    while (true)
+    {
+        if (run_one())
+        {
+            continue;
+        }
+
+        wait_event(&idle_workers, has_work());
+    }
+}
+
+void init_workqueue()
+{
+    spinlock_initlock(&overflow_lock, false);
+    overflow_head = NULL;
+    overflow_tail = &overflow_head;
+    overflow_count = 0;
+
+    for (u32 cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        deques[cpu].top = 0;
+        deques[cpu].bottom = 0;
+    }
+
+    wait_queue_init(&idle_workers);
+    wait_queue_init(&flush_waiters);
+
+    for (u32 cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        if (smp_cpu_online(cpu))
+        {
+            thread_create_on(cpu, "kworker", worker_main, NULL);
+        }
+    }
+
+    workqueue_ready = true;
+}
+
+void work_init(work_t* work, work_fn_t fn, void* ctx)
+{
+    assert(work && fn);
+
+    work->fn = fn;
+    work->ctx = ctx;
+    work->pending = false;
+    work->running = 0;
+    work->next = NULL;
+}
+
+bool queue_work(work_t* work)
+{
+    assert(workqueue_ready);
+
+    if (atomic_exchange(&work->pending, true))
+    {
+        return false;
+    }
+
+    usize_ptr irq_flags = irq_save();
+    bool pushed = deque_push(&deques[cpu_id()], work);
+    irq_restore(irq_flags);
+
+    if (!pushed)
+    {
+        overflow_push(work);
+    }
+
+    wake_up_one(&idle_workers);
+
+    return true;
+}
+
+bool work_busy(work_t* work)
+{
+    return atomic_load(&work->pending) || atomic_load(&work->running);
+}
+
+void flush_work(work_t* work)
+{
+    if (sched_can_block())
+    {
+        wait_event(&flush_waiters, !work_busy(work));
+        return;
+    }
+
+    // nothing to sleep here, help instead (the boot flow owns no locks
+    // a work could want)
+    while (work_busy(work))
+    {
+        if (!run_one())
+        {
+            cpu_relax();
+        }
+    }
+}
+
+typedef struct parallel_for_state
+{
+    u32 count;
+    u32 grain;
+    parallel_for_fn_t fn;
+    void* ctx;
+
+    // next unclaimed index
+    atom_u32 next;
+} parallel_for_state_t;
+
+// chunks are claimed dynamically, a slow CPU just claims fewer
+static void parallel_for_run(parallel_for_state_t* state)
+{
+    while (true)
+    {
+        u32 start = atomic_fetch_add(&state->next, state->grain);
+        if (start >= state->count)
+        {
+            return;
+        }
+
+        state->fn(start, min(start + state->grain, state->count), state->ctx);
+    }
+}
+
+static void parallel_for_work(work_t* work)
+{
+    parallel_for_run((parallel_for_state_t*)work->ctx);
+}
+
+void parallel_for(u32 count, u32 grain, parallel_for_fn_t fn, void* ctx)
+{
+    assert(fn && grain);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    parallel_for_state_t state = {
+        .count = count,
+        .grain = grain,
+        .fn = fn,
+        .ctx = ctx,
+        .next = 0,
+    };
+
+    // one helper per other CPU at most, the caller takes chunks too
+    u32 chunks = (count + grain - 1) / grain;
+    u32 helpers = min(smp_cpu_count(), chunks) - 1;
+
+    work_t works[MAX_CPUS];
+    for (u32 i = 0; i < helpers; i++)
+    {
+        work_init(&works[i], parallel_for_work, &state);
+        queue_work(&works[i]);
+    }
+
+    parallel_for_run(&state);
+
+    for (u32 i = 0; i < helpers; i++)
+    {
+        flush_work(&works[i]);
+    }
+}
@@ -0,0 +1,476 @@
+#include <services/time/timer.h>
+#include <services/threads/locks/spinlock.h>
+#include <kernel/devices/clock.h>
+#include <kernel/devices/int_timer.h>
+#include <kernel/core/cpu.h>
+
+// Hierarchical timing wheel, level L slot covers 64^L ticks.
+// Level 0 holds timers due within 64 ticks of clk, higher levels are
+// cascaded down whenever the level below wraps to index 0.
+// One wheel per CPU once each CPU has its own clockevent, a timer is
+// queued on the wheel of the CPU that started it.
+
+#define KTIMER_NO_EVENT ((u64)-1)
+
+#define KTIMER_MAX_TICKS ((1ULL << (KTIMER_LEVELS * KTIMER_LEVEL_BITS)) - 1)
+
+typedef struct timer_level
+{
+    ktimer_t* slots[KTIMER_LEVEL_SLOTS];
+    // bit n set = slots[n] not empty
+    u64 occupied;
+} timer_level_t;
+
+typedef struct timer_base
+{
+    spinlock_t lock;
+
+    // current wheel tick, every tick before it has been processed
+    u64 clk;
+
+    timer_level_t levels[KTIMER_LEVELS];
+
+    // absolute time the hardware is armed for
+    u64 next_event_ns;
+
+    // interrupt path reprograms once at the end
+    bool in_interrupt;
+    bool initialized;
+} timer_base_t;
+
+static timer_base_t bases[MAX_CPUS];
+
+// without per CPU clockevents every timer lives on the boot CPU's wheel
+static timer_base_t* this_base()
+{
+    timer_base_t* base = &bases[cpu_id()];
+
+    return base->initialized ? base : &bases[0];
+}
+
+static inline u64 ns_to_tick(u64 ns)
+{
+    return ns >> KTIMER_TICK_SHIFT;
+}
+
+static inline u64 tick_to_ns(u64 tick)
+{
+    return tick << KTIMER_TICK_SHIFT;
+}
+
+static inline u32 level_shift(u32 level)
+{
+    return level * KTIMER_LEVEL_BITS;
+}
+
+static inline u64 rotate_right(u64 value, u32 count)
+{
+    count &= 63;
+
+    if (count == 0)
+    {
+        return value;
+    }
+
+    return (value >> count) | (value << (64 - count));
+}
+
+static void slot_insert(timer_base_t* base, ktimer_t* timer, u32 level, u32 slot)
+{
+    timer_level_t* lvl = &base->levels[level];
+
+    timer->level = level;
+    timer->slot = slot;
+
+    timer->next = lvl->slots[slot];
+    if (timer->next)
+    {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = &lvl->slots[slot];
+    lvl->slots[slot] = timer;
+
+    lvl->occupied |= 1ULL << slot;
+}
+
+static void slot_remove(timer_base_t* base, ktimer_t* timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next)
+    {
+        timer->next->pprev = timer->pprev;
+    }
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+
+    timer_level_t* lvl = &base->levels[timer->level];
+    if (lvl->slots[timer->slot] == NULL)
+    {
+        lvl->occupied &= ~(1ULL << timer->slot);
+    }
+}
+
+static void enqueue(timer_base_t* base, ktimer_t* timer)
+{
+    u64 expires = ns_to_tick(timer->expires_ns);
+
+    // already due, lands in the current slot
+    if (expires < base->clk)
+    {
+        expires = base->clk;
+    }
+
+    u64 delta = expires - base->clk;
+
+    // past the wheel range, park it in the last level and recascade
+    if (delta > KTIMER_MAX_TICKS)
+    {
+        delta = KTIMER_MAX_TICKS;
+        expires = base->clk + delta;
+    }
+
+    u32 level = 0;
+    while (level + 1 < KTIMER_LEVELS &&
+           delta >= (1ULL << level_shift(level + 1)))
+    {
+        level++;
+    }
+
+    u32 slot = (expires >> level_shift(level)) & KTIMER_LEVEL_MASK;
+
+    slot_insert(base, timer, level, slot);
+}
+
+static void cascade(timer_base_t* base, u32 level, u32 slot)
+{
+    timer_level_t* lvl = &base->levels[level];
+
+    ktimer_t* timer = lvl->slots[slot];
+    lvl->slots[slot] = NULL;
+    lvl->occupied &= ~(1ULL << slot);
+
+    while (timer)
+    {
+        ktimer_t* next = timer->next;
+
+        enqueue(base, timer);
+
+        timer = next;
+    }
+}
+
+static void advance_clk(timer_base_t* base)
+{
+    base->clk++;
+
+    // level L wraps when every level below it is at index 0
+    for (u32 level = 1; level < KTIMER_LEVELS; level++)
+    {
+        if ((base->clk >> level_shift(level - 1)) & KTIMER_LEVEL_MASK)
+        {
+            break;
+        }
+
+        cascade(base, level, (base->clk >> level_shift(level)) & KTIMER_LEVEL_MASK);
+    }
+}
+
+// lock must be held, dropped around every callback
+static void run_expired(timer_base_t* base, u64 now_ns)
+{
+    u32 slot = base->clk & KTIMER_LEVEL_MASK;
+
+    while (true)
+    {
+        ktimer_t* timer = base->levels[0].slots[slot];
+        while (timer && timer->expires_ns > now_ns)
+        {
+            timer = timer->next;
+        }
+
+        if (timer == NULL)
+        {
+            return;
+        }
+
+        slot_remove(base, timer);
+
+        if (timer->period_ns)
+        {
+            // skip missed periods instead of firing a burst
+            timer->expires_ns += timer->period_ns;
+            if (timer->expires_ns <= now_ns)
+            {
+                u64 missed = (now_ns - timer->expires_ns) / timer->period_ns + 1;
+                timer->expires_ns += missed * timer->period_ns;
+            }
+
+            enqueue(base, timer);
+        }
+
+        ktimer_fn_t fn = timer->fn;
+        void* ctx = timer->ctx;
+
+        spinlock_unlock(&base->lock);
+
+        fn(timer, ctx);
+
+        spinlock_lock(&base->lock);
+    }
+}
+
+static u64 next_expiry_ns(timer_base_t* base)
+{
+    u64 next = KTIMER_NO_EVENT;
+
+    // level 0 slots map to exact ticks, the first occupied one wins
+    u32 index = base->clk & KTIMER_LEVEL_MASK;
+    u64 pending = rotate_right(base->levels[0].occupied, index);
+    if (pending)
+    {
+        u32 slot = (index + __builtin_ctzll(pending)) & KTIMER_LEVEL_MASK;
+
+        for (ktimer_t* timer = base->levels[0].slots[slot]; timer; timer = timer->next)
+        {
+            next = min(next, timer->expires_ns);
+        }
+    }
+
+    // higher levels only need a wakeup at their cascade point,
+    // the current index there belongs to the next wrap
+    for (u32 level = 1; level < KTIMER_LEVELS; level++)
+    {
+        u64 block = base->clk >> level_shift(level);
+        u32 after = (block + 1) & KTIMER_LEVEL_MASK;
+
+        pending = rotate_right(base->levels[level].occupied, after);
+        if (pending == 0)
+        {
+            continue;
+        }
+
+        u64 cascade_block = block + 1 + __builtin_ctzll(pending);
+        u64 cascade_ns = tick_to_ns(cascade_block << level_shift(level));
+
+        next = min(next, cascade_ns);
+    }
+
+    return next;
+}
+
+// lock must be held
+static void program_next(timer_base_t* base, u64 now_ns)
+{
+    u64 next = next_expiry_ns(base);
+    u64 delta = KTIMER_MAX_IDLE_NS;
+
+    if (next != KTIMER_NO_EVENT)
+    {
+        delta = next > now_ns ? min(next - now_ns, KTIMER_MAX_IDLE_NS) : 0;
+    }
+
+    delta = min(delta, int_timer_max_delta_ns());
+
+    base->next_event_ns = now_ns + delta;
+    int_timer_program_ns(delta);
+}
+
+static void timer_interrupt()
+{
+    timer_base_t* base = this_base();
+
+    u64 now_ns = clock_monotonic_ns();
+    u64 now_tick = ns_to_tick(now_ns);
+
+    spinlock_lock(&base->lock);
+
+    base->in_interrupt = true;
+
+    run_expired(base, now_ns);
+
+    while (base->clk < now_tick)
+    {
+        advance_clk(base);
+        run_expired(base, now_ns);
+    }
+
+    base->in_interrupt = false;
+
+    program_next(base, clock_monotonic_ns());
+
+    spinlock_unlock(&base->lock);
+}
+
+static void init_base(timer_base_t* base, u64 now_ns)
+{
+    for (u32 level = 0; level < KTIMER_LEVELS; level++)
+    {
+        for (u32 slot = 0; slot < KTIMER_LEVEL_SLOTS; slot++)
+        {
+            base->levels[level].slots[slot] = NULL;
+        }
+        base->levels[level].occupied = 0;
+    }
+
+    base->clk = ns_to_tick(now_ns);
+    base->in_interrupt = false;
+    base->initialized = true;
+}
+
+void init_timers()
+{
+    for (u32 cpu = 0; cpu < MAX_CPUS; cpu++)
+    {
+        spinlock_initlock(&bases[cpu].lock, false);
+        bases[cpu].initialized = false;
+    }
+
+    timer_base_t* base = &bases[0];
+
+    u64 now_ns = clock_monotonic_ns();
+    init_base(base, now_ns);
+
+    int_timer_set_handler(timer_interrupt);
+
+    spinlock_lock(&base->lock);
+    program_next(base, now_ns);
+    spinlock_unlock(&base->lock);
+}
+
+void ktimer_init_cpu()
+{
+    // a global clockevent only interrupts the boot CPU
+    if (int_timer_per_cpu() == false)
+    {
+        return;
+    }
+
+    timer_base_t* base = &bases[cpu_id()];
+
+    spinlock_lock(&base->lock);
+
+    u64 now_ns = clock_monotonic_ns();
+
+    // the boot CPU's wheel already exists, it only moved to new hardware
+    if (base->initialized == false)
+    {
+        init_base(base, now_ns);
+    }
+
+    program_next(base, now_ns);
+
+    spinlock_unlock(&base->lock);
+}
+
+void ktimer_init(ktimer_t* timer, ktimer_fn_t fn, void* ctx)
+{
+    assert(timer && fn);
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires_ns = 0;
+    timer->period_ns = 0;
+    timer->fn = fn;
+    timer->ctx = ctx;
+    timer->level = 0;
+    timer->slot = 0;
+    timer->cpu = 0;
+}
+
+// locks the wheel timer is queued on (or was last queued on),
+// timer->cpu only changes under that wheel's lock
+static timer_base_t* lock_timer_base(ktimer_t* timer)
+{
+    while (true)
+    {
+        timer_base_t* base = &bases[timer->cpu];
+
+        spinlock_lock(&base->lock);
+
+        if (&bases[timer->cpu] == base)
+        {
+            return base;
+        }
+
+        spinlock_unlock(&base->lock);
+    }
+}
+
+// starts of one timer are serialized by its owner
+static void start_locked(ktimer_t* timer, u64 expires_ns, u64 period_ns)
+{
+    timer_base_t* base = this_base();
+
+    assert(base->initialized);
+
+    // pull it off another CPU's wheel first, it is requeued here
+    timer_base_t* old = lock_timer_base(timer);
+    if (old != base)
+    {
+        if (timer->pprev)
+        {
+            slot_remove(old, timer);
+        }
+        timer->cpu = base - bases;
+
+        spinlock_unlock(&old->lock);
+        spinlock_lock(&base->lock);
+    }
+
+    if (timer->pprev)
+    {
+        slot_remove(base, timer);
+    }
+
+    timer->expires_ns = expires_ns;
+    timer->period_ns = period_ns;
+
+    enqueue(base, timer);
+
+    // an earlier deadline than the armed one needs a reprogram now
+    if (base->in_interrupt == false && expires_ns < base->next_event_ns)
+    {
+        program_next(base, clock_monotonic_ns());
+    }
+
+    spinlock_unlock(&base->lock);
+}
+
+void ktimer_start(ktimer_t* timer, u64 expires_ns)
+{
+    start_locked(timer, expires_ns, 0);
+}
+
+void ktimer_start_in(ktimer_t* timer, u64 delay_ns)
+{
+    start_locked(timer, clock_monotonic_ns() + delay_ns, 0);
+}
+
+void ktimer_start_periodic(ktimer_t* timer, u64 period_ns)
+{
+    assert(period_ns);
+
+    start_locked(timer, clock_monotonic_ns() + period_ns, period_ns);
+}
+
+bool ktimer_cancel(ktimer_t* timer)
+{
+    timer_base_t* base = lock_timer_base(timer);
+
+    bool was_pending = timer->pprev != NULL;
+    if (was_pending)
+    {
+        slot_remove(base, timer);
+    }
+    timer->period_ns = 0;
+
+    spinlock_unlock(&base->lock);
+
+    return was_pending;
+}
+
+bool ktimer_pending(ktimer_t* timer)
+{
+    return timer->pprev != NULL;
+}
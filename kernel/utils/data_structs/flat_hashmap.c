@@ -3,167 +3,551 @@
 #include <utils/data_structs/flat_hashmap.h>
 
 #include <memory/heap/heap.h>
-#include <utils/hash/murmur2_hash.h>
+#include <services/threads/rcu.h>
+#include <utils/hash/fast_hash.h>
+#include <stdatomic.h>
 
 #define INIT_CAPACITY 64
-#define MIN_CAPACITY   4
+// at least one full group
+#define MIN_CAPACITY  16
+
+// Tables from this size drain into their replacement a few slots per
+// insert, smaller ones are copied at once
+#define INCREMENTAL_MIN_CAPACITY 256
+// old slots moved per insert, a table is drained long before the new
+// one reaches its own rehash threshold
+#define MIGRATE_SLOTS 32
+
+// Control bytes. Full slots hold the 7 bit tag, so only empty and
+// deleted have the top bit set.
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xFE
+
+typedef enum fhashmap_entry_flag
+{
+    FLAG_ALLOCATED = 1 << 0,
+    FLAG_INLINE    = 1 << 1,
+} fhashmap_entry_flag_t;
+
+// Group probing: a group is GROUP_WIDTH control bytes at a GROUP_WIDTH
+// aligned index, each match is a bitmask with one hit per slot.
+// The kernel runs without SSE state, so it takes the word sized SWAR path.
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+#define GROUP_WIDTH 16
+
+typedef __m128i group_t;
+typedef u32 group_mask_t;
 
-typedef enum fhashmap_entry_state 
+static inline group_t group_load(const u8* ctrl)
 {
-    STATE_EMPTY  = 0, // MUST BE 0 FOR MEMSET
-    STATE_USED   = 1,
-    STATE_DELETE = 2,
-} fhashmap_entry_state_t; 
+    return _mm_loadu_si128((const __m128i*)ctrl);
+}
 
-typedef enum fhashmap_entry_flag 
+static inline group_mask_t group_match(group_t group, u8 tag)
 {
-    FLAG_ALLOCATED = 1 << 0,
-} fhashmap_entry_flag_t; 
+    return (group_mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+}
 
+static inline group_mask_t group_match_empty(group_t group)
+{
+    return group_match(group, CTRL_EMPTY);
+}
 
-// Finds the first free slot and returns it
-// Assumes empty_count > 0
-static flat_hashmap_entry_t* find_free_slot(flat_hashmap_entry_t* entries, u64 capacity, u64 hash)
+// empty or deleted, the top bit of each byte
+static inline group_mask_t group_match_free(group_t group)
 {
-    u64 pos = hash & (capacity-1);
+    return (group_mask_t)_mm_movemask_epi8(group);
+}
 
-    while (entries[pos].state == STATE_USED)
-    {
-        pos = (pos+1) & (capacity-1);
-    }
-    
-    return &entries[pos];
+static inline u32 group_mask_first(group_mask_t mask)
+{
+    return __builtin_ctz(mask);
+}
+#else
+#define GROUP_WIDTH sizeof(uptr)
+
+#define GROUP_LSBS ((uptr)0x0101010101010101ULL)
+#define GROUP_MSBS ((uptr)0x8080808080808080ULL)
+
+typedef uptr group_t;
+typedef uptr group_mask_t;
+
+static inline group_t group_load(const u8* ctrl)
+{
+    group_t group;
+    __builtin_memcpy(&group, ctrl, sizeof(group));
+    return group;
+}
+
+// Zero byte detection on ctrl ^ tag. A borrow can flag the byte above a
+// real match too, the entry's hash check weeds those out.
+static inline group_mask_t group_match(group_t group, u8 tag)
+{
+    uptr x = group ^ (GROUP_LSBS * tag);
+    return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+// top bit set and bit 1 clear, only CTRL_EMPTY
+static inline group_mask_t group_match_empty(group_t group)
+{
+    return group & ~(group << 6) & GROUP_MSBS;
+}
+
+static inline group_mask_t group_match_free(group_t group)
+{
+    return group & GROUP_MSBS;
+}
+
+static inline u32 group_mask_first(group_mask_t mask)
+{
+    return __builtin_ctzl(mask) >> 3;
+}
+#endif
+
+static inline u32 hash_group(u32 hash)
+{
+    return hash >> 7;
+}
+
+static inline u8 hash_tag(u32 hash)
+{
+    return hash & 0x7F;
+}
+
+static inline bool ctrl_is_full(u8 ctrl)
+{
+    return (ctrl & 0x80) == 0;
+}
+
+static inline void* entry_key(flat_hashmap_entry_t* entry)
+{
+    return (entry->flags & FLAG_INLINE) ? entry->inline_key : entry->key_data;
 }
 
-// Updates the hashmap with the new capacity (can be the same if just a basic rehash)
-static isize_ptr rehash(flat_hashmap_t* hashmap, u64 new_capacity)
+// an RCU reader may still be comparing a tombstone's key
+typedef struct retired_entry
 {
-    u64 old_capacity = hashmap->capacity;
-    assert(new_capacity >= old_capacity);
-    
-    // make new entries
-    flat_hashmap_entry_t* new_entries = kmalloc(sizeof(flat_hashmap_entry_t) * new_capacity);
-    assert(new_entries);
+    rcu_head_t head;
 
-    memset(new_entries, 0, sizeof(flat_hashmap_entry_t) * new_capacity);
+    void* data;
+    void* key_data;
+    u64 key_length;
+    bool free_key;
 
-    flat_hashmap_entry_t* old_entries = hashmap->entries;
-    
-    u64 cur_used_count = 0;
-    // delete count is always 0 (point of the rehash)
-    // empty count is always new_capacity - used_count (point of the rehash: used_count + empty_count = new_capacity)
+    fmap_destroy_cb_func destroy_cb;
 
-    u64 used_count = hashmap->used_count;
-    
-    for (u64 pos = 0; pos < old_capacity && cur_used_count < used_count; pos++)
+    // an inline key outlives its slot here, the table may go first
+    u8 inline_key[FHASHMAP_INLINE_KEY_SIZE];
+} retired_entry_t;
+
+typedef struct retired_table
+{
+    rcu_head_t head;
+
+    u8* ctrl;
+    flat_hashmap_entry_t* entries;
+    u64 capacity;
+    // fhashmap_clear drops the keys along with the table
+    bool free_keys;
+} retired_table_t;
+
+// ctrl and entries in one allocation, kfree(ctrl) releases both
+static u8* alloc_table(u64 capacity, flat_hashmap_entry_t** entries)
+{
+    u8* ctrl = kmalloc(capacity + capacity * sizeof(flat_hashmap_entry_t));
+    assert(ctrl);
+
+    memset(ctrl, CTRL_EMPTY, capacity);
+
+    // capacity is a multiple of the group width, entries stay aligned
+    *entries = (flat_hashmap_entry_t*)(ctrl + capacity);
+
+    return ctrl;
+}
+
+static void free_table_keys(u8* ctrl, flat_hashmap_entry_t* entries, u64 capacity)
+{
+    for (u64 i = 0; i < capacity; i++)
     {
-        if (old_entries[pos].state != STATE_USED)
+        if (ctrl_is_full(ctrl[i]) && (entries[i].flags & FLAG_ALLOCATED))
         {
-            continue;
+            kfree(entries[i].key_data);
         }
+    }
+}
+
+static void retired_entry_free(rcu_head_t* head)
+{
+    retired_entry_t* retired = (retired_entry_t*)head;
 
-        cur_used_count++;
+    if (retired->destroy_cb)
+    {
+        retired->destroy_cb(retired->data, retired->key_data, retired->key_length);
+    }
+
+    if (retired->free_key)
+    {
+        kfree(retired->key_data);
+    }
 
-        flat_hashmap_entry_t* old_entry = &old_entries[pos];
+    kfree(retired);
+}
 
-        flat_hashmap_entry_t* new_entry =
-            find_free_slot(new_entries, new_capacity, old_entries[pos].hash);
+static void retired_table_free(rcu_head_t* head)
+{
+    retired_table_t* retired = (retired_table_t*)head;
 
-        memcpy(new_entry, old_entry, sizeof(flat_hashmap_entry_t));
+    if (retired->free_keys)
+    {
+        free_table_keys(retired->ctrl, retired->entries, retired->capacity);
     }
 
-    hashmap->delete_count = 0;
-    hashmap->empty_count  = new_capacity - used_count;
-    hashmap->used_count   = used_count;
-    hashmap->capacity     = new_capacity;
+    kfree(retired->ctrl);
+    kfree(retired);
+}
 
-    kfree(hashmap->entries);
-    hashmap->entries = new_entries;
+static void retire_table(u8* ctrl, flat_hashmap_entry_t* entries, u64 capacity, bool free_keys)
+{
+    retired_table_t* retired = kmalloc(sizeof(retired_table_t));
+    assert(retired);
 
-    return 0;
+    retired->ctrl      = ctrl;
+    retired->entries   = entries;
+    retired->capacity  = capacity;
+    retired->free_keys = free_keys;
+
+    call_rcu(&retired->head, retired_table_free);
 }
 
-// Arbitrary decision of whether a resize is needed
-static bool need_resize(flat_hashmap_t *map) 
+// The tables a lookup probes, old_ctrl is NULL outside a migration
+typedef struct table_view
 {
-    // load factor (live+deleted entries vs capacity) 75%
-    return (map->used_count + map->delete_count) * 100 / map->capacity > 75;
+    u8* ctrl;
+    flat_hashmap_entry_t* entries;
+    u64 capacity;
+
+    u8* old_ctrl;
+    flat_hashmap_entry_t* old_entries;
+    u64 old_capacity;
+} table_view_t;
+
+// Table pointer changes go between these, the seqcount keeps the pointers
+// and capacities consistent for RCU readers
+static void table_write_begin(flat_hashmap_t* hashmap)
+{
+    atomic_fetch_add_explicit(&hashmap->table_seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
 }
 
-// Arbitrary decision of whether a rehash is needed
-static bool need_rehash(flat_hashmap_t *map) 
+static void table_write_end(flat_hashmap_t* hashmap)
 {
-    // too many deleted entries relative to used
-    return map->delete_count * 100 / (map->used_count + map->delete_count) > 25;
+    atomic_fetch_add_explicit(&hashmap->table_seq, 1, memory_order_release);
 }
 
+static table_view_t writer_view(flat_hashmap_t* hashmap)
+{
+    return (table_view_t){
+        .ctrl         = hashmap->ctrl,
+        .entries      = hashmap->entries,
+        .capacity     = hashmap->capacity,
+        .old_ctrl     = hashmap->old_ctrl,
+        .old_entries  = hashmap->old_entries,
+        .old_capacity = hashmap->old_capacity,
+    };
+}
 
-static flat_hashmap_entry_t* find_exact_entry_interval(flat_hashmap_t* hashmap, flat_hashmap_entry_t* from, flat_hashmap_entry_t* to, u64 hash, const u8* key_data, u64 key_length)
+// Reader side of table_write_begin/end, *seq is the count the view is from
+static table_view_t read_tables(flat_hashmap_t* hashmap, u32* seq)
 {
-    u64 from_index = from - hashmap->entries;
-    u64 to_index   = to - hashmap->entries;
+    while (true)
+    {
+        *seq = atomic_load_explicit(&hashmap->table_seq, memory_order_acquire);
+
+        table_view_t view = writer_view(hashmap);
+
+        atomic_thread_fence(memory_order_acquire);
+
+        if ((*seq & 1) == 0 &&
+            atomic_load_explicit(&hashmap->table_seq, memory_order_relaxed) == *seq)
+        {
+            return view;
+        }
+    }
+}
 
-    u64 cur_index = from_index;
+// True if the table pointers changed since read_tables returned seq. Call
+// after probing, the probe's loads come first.
+static bool tables_changed(flat_hashmap_t* hashmap, u32 seq)
+{
+    atomic_thread_fence(memory_order_acquire);
 
-    while (cur_index != to_index)
+    return atomic_load_explicit(&hashmap->table_seq, memory_order_relaxed) != seq;
+}
+
+// the entry's fields must be written before its slot turns full
+static inline void set_ctrl(u8* ctrl, u64 index, u8 value)
+{
+    __atomic_store_n(&ctrl[index], value, __ATOMIC_RELEASE);
+}
+
+// Triangular walk over the groups, visits each one once for a power of 2
+// group count. An RCU reader may probe a table that is filling up, so the
+// walk is bounded either way.
+static flat_hashmap_entry_t* find_exact_entry_in(const u8* ctrl, flat_hashmap_entry_t* entries, u64 capacity, u32 hash, const void* key_data, u64 key_length)
+{
+    u8 tag = hash_tag(hash);
+    u32 group_mask = capacity / GROUP_WIDTH - 1;
+    u32 group = hash_group(hash) & group_mask;
+
+    for (u32 step = 1; step <= group_mask + 1; step++)
     {
-        if (hashmap->entries[cur_index].state == STATE_EMPTY) 
+        u64 base = (u64)group * GROUP_WIDTH;
+
+        group_t ctrl_group = group_load(&ctrl[base]);
+        // pairs with set_ctrl, the matched entries are complete
+        atomic_thread_fence(memory_order_acquire);
+
+        for (group_mask_t match = group_match(ctrl_group, tag); match; match &= match - 1)
         {
-            return NULL;
+            flat_hashmap_entry_t* it = &entries[base + group_mask_first(match)];
+
+            if (it->hash == hash &&
+                it->key_length == key_length &&
+                memcmp(entry_key(it), key_data, key_length) == 0)
+            {
+                return it;
+            }
         }
 
-        if (hashmap->entries[cur_index].hash == hash && 
-            hashmap->entries[cur_index].key_length == key_length &&
-            memcmp(hashmap->entries[cur_index].key_data, key_data, key_length) == 0)
+        // the key would have gone into this group's empty slot
+        if (group_match_empty(ctrl_group))
         {
-            return &hashmap->entries[cur_index];
+            return NULL;
         }
 
-        cur_index = (cur_index + 1) & (hashmap->capacity - 1);
+        group = (group + step) & group_mask;
     }
 
     return NULL;
 }
 
-static flat_hashmap_entry_t* find_exact_entry(flat_hashmap_t* hashmap, u64 hash, const u8* key_data, u64 key_length)
+// A migrating entry shows up in the new table before it leaves the old
+// one, so probing the old table first never misses it while the view is
+// current. A rehash started after the view is caught by tables_changed.
+static flat_hashmap_entry_t* find_in_view(const table_view_t* view, u32 hash, const void* key_data, u64 key_length, bool* in_old)
 {
-    assert(hashmap->empty_count != 0);
-
-    u64 pos = hash & (hashmap->capacity - 1);
-
-    while (1)
+    if (view->old_ctrl)
     {
-        flat_hashmap_entry_t* it = &hashmap->entries[pos];
+        flat_hashmap_entry_t* entry = find_exact_entry_in(
+            view->old_ctrl, view->old_entries, view->old_capacity,
+            hash, key_data, key_length
+        );
 
-        if (it->state == STATE_EMPTY) 
+        if (entry)
         {
-            return NULL;
+            *in_old = true;
+            return entry;
         }
+    }
 
-        if (it->state == STATE_USED &&
-            it->hash == hash &&
-            it->key_length == key_length &&
-            memcmp(it->key_data, key_data, key_length) == 0)
+    *in_old = false;
+    return find_exact_entry_in(view->ctrl, view->entries, view->capacity, hash, key_data, key_length);
+}
+
+static flat_hashmap_entry_t* find_exact_entry(flat_hashmap_t* hashmap, u32 hash, const void* key_data, u64 key_length, bool* in_old)
+{
+    table_view_t view = writer_view(hashmap);
+
+    return find_in_view(&view, hash, key_data, key_length, in_old);
+}
+
+// First slot an insert may take, assumes the table isn't full.
+// RCU mode skips tombstones, a reader may be matching one's old key.
+static u64 find_free_slot(const u8* ctrl, u64 capacity, u32 hash, bool rcu)
+{
+    u32 group_mask = capacity / GROUP_WIDTH - 1;
+    u32 group = hash_group(hash) & group_mask;
+
+    for (u32 step = 1; ; step++)
+    {
+        u64 base = (u64)group * GROUP_WIDTH;
+        group_t ctrl_group = group_load(&ctrl[base]);
+
+        group_mask_t free = rcu ? group_match_empty(ctrl_group) : group_match_free(ctrl_group);
+        if (free)
         {
-            return it;
+            return base + group_mask_first(free);
         }
 
-        pos = (pos + 1) & (hashmap->capacity - 1);
+        group = (group + step) & group_mask;
     }
+}
 
-    return NULL;
+// Accounts for an insert into the current table's slot
+static void take_slot(flat_hashmap_t* hashmap, u64 slot)
+{
+    if (hashmap->ctrl[slot] == CTRL_EMPTY)
+        hashmap->empty_count--;
+    else
+        hashmap->delete_count--;
+
+    hashmap->used_count++;
 }
 
-static void clean_entry(flat_hashmap_t* hashmap, flat_hashmap_entry_t* entry, u8 new_state)
+// Moves one old table slot over. The copy is published before the old slot
+// turns into a tombstone, its key and data belong to the new table after.
+static void migrate_slot(flat_hashmap_t* hashmap, u64 pos)
+{
+    if (!ctrl_is_full(hashmap->old_ctrl[pos]))
+    {
+        return;
+    }
+
+    flat_hashmap_entry_t* entry = &hashmap->old_entries[pos];
+
+    u64 slot = find_free_slot(hashmap->ctrl, hashmap->capacity, entry->hash, hashmap->rcu);
+    take_slot(hashmap, slot);
+
+    hashmap->entries[slot] = *entry;
+    set_ctrl(hashmap->ctrl, slot, hash_tag(entry->hash));
+
+    set_ctrl(hashmap->old_ctrl, pos, CTRL_DELETED);
+    hashmap->old_used_count--;
+}
+
+static void finish_migration(flat_hashmap_t* hashmap)
+{
+    u8* old_ctrl = hashmap->old_ctrl;
+    flat_hashmap_entry_t* old_entries = hashmap->old_entries;
+    u64 old_capacity = hashmap->old_capacity;
+
+    table_write_begin(hashmap);
+    hashmap->old_ctrl     = NULL;
+    hashmap->old_entries  = NULL;
+    hashmap->old_capacity = 0;
+    table_write_end(hashmap);
+
+    hashmap->migrate_pos = 0;
+
+    // whatever is left is tombstones, the keys moved
+    if (hashmap->rcu)
+    {
+        retire_table(old_ctrl, old_entries, old_capacity, false);
+    }
+    else
+    {
+        kfree(old_ctrl);
+    }
+}
+
+// Moves up to slots old table slots, drops the old table once it is empty
+static void migrate_step(flat_hashmap_t* hashmap, u64 slots)
+{
+    if (hashmap->old_ctrl == NULL)
+    {
+        return;
+    }
+
+    u64 end = min(hashmap->migrate_pos + slots, hashmap->old_capacity);
+
+    for (; hashmap->old_used_count && hashmap->migrate_pos < end; hashmap->migrate_pos++)
+    {
+        migrate_slot(hashmap, hashmap->migrate_pos);
+    }
+
+    if (hashmap->old_used_count == 0)
+    {
+        finish_migration(hashmap);
+    }
+}
+
+// Swaps in an empty table of new_capacity (can be the same if just dropping
+// tombstones) and starts draining the current one into it. Large tables
+// move MIGRATE_SLOTS per insert instead of stalling one insert on the whole
+// copy, lookups probe both tables meanwhile.
+static void start_rehash(flat_hashmap_t* hashmap, u64 new_capacity)
+{
+    // one table draining at a time
+    migrate_step(hashmap, hashmap->old_capacity);
+
+    assert(new_capacity >= hashmap->capacity);
+
+    flat_hashmap_entry_t* new_entries;
+    u8* new_ctrl = alloc_table(new_capacity, &new_entries);
+
+    table_write_begin(hashmap);
+    hashmap->old_ctrl     = hashmap->ctrl;
+    hashmap->old_entries  = hashmap->entries;
+    hashmap->old_capacity = hashmap->capacity;
+
+    hashmap->ctrl     = new_ctrl;
+    hashmap->entries  = new_entries;
+    hashmap->capacity = new_capacity;
+    table_write_end(hashmap);
+
+    hashmap->old_used_count = hashmap->used_count;
+    hashmap->migrate_pos    = 0;
+
+    hashmap->used_count   = 0;
+    hashmap->delete_count = 0;
+    hashmap->empty_count  = new_capacity;
+
+    if (new_capacity < INCREMENTAL_MIN_CAPACITY)
+    {
+        migrate_step(hashmap, hashmap->old_capacity);
+    }
+}
+
+// Arbitrary decision of whether the next insert needs a rehash first
+static bool need_rehash(flat_hashmap_t *map)
+{
+    // load factor (live+deleted entries vs capacity) 75%
+    return (map->used_count + map->delete_count + 1) * 4 > map->capacity * 3;
+}
+
+// Arbitrary decision of whether a rehash has to grow the table
+static bool need_grow(flat_hashmap_t *map)
+{
+    // dropping the tombstones frees less than a quarter
+    return map->delete_count * 4 < map->used_count + map->delete_count;
+}
+
+// RCU mode tombstone, fields stay intact for readers still on it and the
+// destroy runs after a grace period
+static void retire_entry(flat_hashmap_t* hashmap, u8* ctrl, u64 index, flat_hashmap_entry_t* entry)
+{
+    set_ctrl(ctrl, index, CTRL_DELETED);
+
+    retired_entry_t* retired = kmalloc(sizeof(retired_entry_t));
+    assert(retired);
+
+    retired->data       = entry->data;
+    retired->key_data   = entry->key_data;
+    retired->key_length = entry->key_length;
+    retired->free_key   = entry->flags & FLAG_ALLOCATED;
+    retired->destroy_cb = hashmap->destroy_cb;
+
+    if (entry->flags & FLAG_INLINE)
+    {
+        memcpy(retired->inline_key, entry->inline_key, entry->key_length);
+        retired->key_data = retired->inline_key;
+    }
+
+    call_rcu(&retired->head, retired_entry_free);
+}
+
+static void clean_entry(flat_hashmap_t* hashmap, flat_hashmap_entry_t* entry)
 {
     if (hashmap->destroy_cb)
     {
-        hashmap->destroy_cb(entry->data, entry->key_data, entry->key_length);
+        hashmap->destroy_cb(entry->data, entry_key(entry), entry->key_length);
     }
-    
+
     if (entry->flags & FLAG_ALLOCATED)
     {
-        kfree((void*)entry->key_data);
+        kfree(entry->key_data);
     }
 
     entry->key_data   = NULL;
@@ -171,29 +555,90 @@ static void clean_entry(flat_hashmap_t* hashmap, flat_hashmap_entry_t* entry, u8
 
     entry->hash = 0;
     entry->flags = 0;
-    entry->state = new_state;
 }
 
-static isize_ptr handle_rehash(flat_hashmap_t* hashmap)
+// A slot whose group still has an empty one can go back to empty: no
+// probe ever walked past that group, so no chain runs through the slot
+static void release_slot(flat_hashmap_t* hashmap, u64 index)
 {
-    if (need_resize(hashmap))
+    u64 base = index & ~(u64)(GROUP_WIDTH - 1);
+
+    if (group_match_empty(group_load(&hashmap->ctrl[base])))
     {
-        isize_ptr rehash_result = rehash(hashmap, hashmap->capacity * 2);
-        if (rehash_result < 0)
-        {
-            return rehash_result;
-        }
+        hashmap->ctrl[index] = CTRL_EMPTY;
+        hashmap->empty_count++;
     }
-    else if (need_rehash(hashmap))
+    else
+    {
+        hashmap->ctrl[index] = CTRL_DELETED;
+        hashmap->delete_count++;
+    }
+}
+
+// Drops a found entry from whichever table holds it
+static void remove_entry(flat_hashmap_t* hashmap, flat_hashmap_entry_t* entry, bool in_old)
+{
+    if (in_old)
     {
-        isize_ptr rehash_result = rehash(hashmap, hashmap->capacity);
-        if (rehash_result < 0)
+        u64 index = entry - hashmap->old_entries;
+
+        if (hashmap->rcu)
+        {
+            retire_entry(hashmap, hashmap->old_ctrl, index, entry);
+        }
+        else
         {
-            return rehash_result;
+            clean_entry(hashmap, entry);
+            hashmap->old_ctrl[index] = CTRL_DELETED;
         }
+
+        // the draining table takes no inserts, its tombstones aren't counted
+        hashmap->old_used_count--;
+        return;
     }
 
-    return 0;
+    u64 index = entry - hashmap->entries;
+
+    if (hashmap->rcu)
+    {
+        retire_entry(hashmap, hashmap->ctrl, index, entry);
+        hashmap->delete_count++;
+    }
+    else
+    {
+        clean_entry(hashmap, entry);
+        release_slot(hashmap, index);
+    }
+
+    hashmap->used_count--;
+}
+
+static void fill_entry(flat_hashmap_entry_t* entry, void* key_data, u64 key_length, u32 hash, void* data, u8 flags)
+{
+    if ((flags & FHASHMAP_INS_FLAG_KEY_COPY) && key_length <= FHASHMAP_INLINE_KEY_SIZE)
+    {
+        memcpy(entry->inline_key, key_data, key_length);
+
+        entry->flags = FLAG_INLINE;
+    }
+    else if (flags & FHASHMAP_INS_FLAG_KEY_COPY)
+    {
+        void* new_key = kmalloc(key_length);
+        memcpy(new_key, key_data, key_length);
+
+        entry->flags = FLAG_ALLOCATED;
+        entry->key_data = new_key;
+    }
+    else
+    {
+        entry->flags = 0;
+        entry->key_data = key_data;
+    }
+
+    entry->key_length = key_length;
+    entry->hash = hash;
+
+    entry->data = data;
 }
 
 
@@ -207,18 +652,25 @@ flat_hashmap_t init_fhashmap_custom(u64 capacity, fmap_hash_func hash, fmap_dest
         capacity = MIN_CAPACITY;
     }
 
-    flat_hashmap_entry_t* entries = kmalloc(capacity * sizeof(flat_hashmap_entry_t));
-    assert(entries);
-    memset(entries, 0, capacity * sizeof(flat_hashmap_entry_t));
+    flat_hashmap_entry_t* entries;
+    u8* ctrl = alloc_table(capacity, &entries);
 
     flat_hashmap_t map = {
+        .ctrl = ctrl,
         .capacity = capacity,
         .empty_count = capacity,
         .delete_count = 0,
         .used_count = 0,
         .entries = entries,
         .hash = hash,
-        .destroy_cb = destroy_cb
+        .destroy_cb = destroy_cb,
+        .rcu = false,
+        .table_seq = 0,
+        .old_ctrl = NULL,
+        .old_entries = NULL,
+        .old_capacity = 0,
+        .old_used_count = 0,
+        .migrate_pos = 0,
     };
 
     return map;
@@ -226,14 +678,14 @@ flat_hashmap_t init_fhashmap_custom(u64 capacity, fmap_hash_func hash, fmap_dest
 
 flat_hashmap_t init_fhashmap_capacity(u64 capacity)
 {
-    return init_fhashmap_custom(capacity, murmur2_hash64, NULL);
+    return init_fhashmap_custom(capacity, fast_hash, NULL);
 }
 
 flat_hashmap_t init_fhashmap(void)
 {
     return init_fhashmap_custom(
-        INIT_CAPACITY, 
-        murmur2_hash64, 
+        INIT_CAPACITY,
+        fast_hash,
         NULL
     );
 }
@@ -241,8 +693,8 @@ flat_hashmap_t init_fhashmap(void)
 flat_hashmap_t init_fhashmap_destroy_hash(fmap_hash_func hash, fmap_destroy_cb_func destroy_cb)
 {
     return init_fhashmap_custom(
-        INIT_CAPACITY, 
-        hash, 
+        INIT_CAPACITY,
+        hash,
         destroy_cb
     );
 }
@@ -250,8 +702,8 @@ flat_hashmap_t init_fhashmap_destroy_hash(fmap_hash_func hash, fmap_destroy_cb_f
 flat_hashmap_t init_fhashmap_destroy (fmap_destroy_cb_func destroy_cb)
 {
     return init_fhashmap_custom(
-        INIT_CAPACITY, 
-        murmur2_hash64, 
+        INIT_CAPACITY,
+        fast_hash,
         destroy_cb
     );
 }
@@ -261,82 +713,97 @@ flat_hashmap_t init_fhashmap_hash(fmap_hash_func hash)
     return init_fhashmap_custom(INIT_CAPACITY, hash, NULL);
 }
 
+void fhashmap_set_rcu(flat_hashmap_t* hashmap)
+{
+    assert(fhashmap_count(hashmap) == 0 && hashmap->delete_count == 0);
+
+    hashmap->rcu = true;
+}
+
+u64 fhashmap_count(flat_hashmap_t* hashmap)
+{
+    return hashmap->used_count + hashmap->old_used_count;
+}
+
 isize_ptr fhashmap_insert(flat_hashmap_t* hashmap, void *key_data, u64 key_length, void *data, u8 flags)
 {
-    u64 hash = hashmap->hash(key_data, key_length);
+    assert(key_length <= UINT32_MAX);
 
-    flat_hashmap_entry_t* entry = find_free_slot(
-        hashmap->entries, 
-        hashmap->capacity, 
-        hash
-    );
+    u32 hash = (u32)hashmap->hash(key_data, key_length);
 
-    flat_hashmap_entry_t* ideal_slot = &hashmap->entries[hash & (hashmap->capacity-1)];
+    // only inserts migrate, deletes and lookups never move an entry
+    migrate_step(hashmap, MIGRATE_SLOTS);
 
-    flat_hashmap_entry_t* same_entry = find_exact_entry_interval(
-        hashmap, 
-        ideal_slot,
-        entry, 
-        hash, 
-        key_data, 
-        key_length
-    );
+    // room first, the slots found below stay valid
+    if (need_rehash(hashmap))
+    {
+        // one table draining at a time
+        migrate_step(hashmap, hashmap->old_capacity);
+
+        start_rehash(
+            hashmap,
+            need_grow(hashmap) ? hashmap->capacity * 2 : hashmap->capacity
+        );
+    }
+
+    bool in_old;
+    flat_hashmap_entry_t* same_entry = find_exact_entry(hashmap, hash, key_data, key_length, &in_old);
 
     if (same_entry)
     {
         if ((flags & FHASHMAP_INS_FLAG_OVERWRITE) == false)
             return -1;
 
-        // Clears that entry
-        clean_entry(hashmap, same_entry, STATE_EMPTY);
-        hashmap->used_count--; 
-        hashmap->empty_count++; 
+        // RCU mode fills a new slot first, the old one is retired after
+        if (!hashmap->rcu)
+        {
+            clean_entry(hashmap, same_entry);
+            fill_entry(same_entry, key_data, key_length, hash, data, flags);
 
-        entry = same_entry;
+            return 0;
+        }
     }
 
-    // Now adding a new entry 
-    hashmap->used_count ++;
-    if (entry->state == STATE_EMPTY)
-        hashmap->empty_count--;
-    else if (entry->state == STATE_DELETE)
-        hashmap->delete_count--;
+    // new keys always go into the current table
+    u64 slot = find_free_slot(hashmap->ctrl, hashmap->capacity, hash, hashmap->rcu);
+    take_slot(hashmap, slot);
 
-    if (flags & FHASHMAP_INS_FLAG_KEY_COPY)
-    {
-        void* new_key = kmalloc(key_length);
-        memcpy(new_key, key_data, key_length);
+    fill_entry(&hashmap->entries[slot], key_data, key_length, hash, data, flags);
+    set_ctrl(hashmap->ctrl, slot, hash_tag(hash));
 
-        entry->flags |= FLAG_ALLOCATED;
-        entry->key_data = new_key;
-    }
-    else
+    if (same_entry)
     {
-        entry->flags &= ~FLAG_ALLOCATED;
-        entry->key_data = key_data;
+        remove_entry(hashmap, same_entry, in_old);
     }
 
-    entry->key_length = key_length;
-    entry->hash = hash;
-
-    entry->data = data;
-
-    entry->state = STATE_USED;
-
-    return handle_rehash(hashmap);
+    return 0;
 }
 
+// Deleting the current entry from cb is fine, deletes never move entries
 void fhashmap_foreach(flat_hashmap_t* hashmap, void(*cb)(void* data, void* key, usize_ptr key_length, void* ctx), void* ctx)
 {
     assert(cb);
 
-    for (usize_ptr i = 0; hashmap->capacity; ++i) 
+    for (usize_ptr i = 0; i < hashmap->old_capacity; ++i)
     {
-        if (hashmap->entries[i].state == STATE_USED)
+        if (ctrl_is_full(hashmap->old_ctrl[i]))
         {
             cb(
-                hashmap->entries[i].data, 
-                hashmap->entries[i].key_data, 
+                hashmap->old_entries[i].data,
+                entry_key(&hashmap->old_entries[i]),
+                hashmap->old_entries[i].key_length,
+                ctx
+            );
+        }
+    }
+
+    for (usize_ptr i = 0; i < hashmap->capacity; ++i)
+    {
+        if (ctrl_is_full(hashmap->ctrl[i]))
+        {
+            cb(
+                hashmap->entries[i].data,
+                entry_key(&hashmap->entries[i]),
                 hashmap->entries[i].key_length,
                 ctx
             );
@@ -346,9 +813,28 @@ void fhashmap_foreach(flat_hashmap_t* hashmap, void(*cb)(void* data, void* key,
 
 flat_hashmap_result_t fhashmap_get_data(flat_hashmap_t* hashmap, const void *key_data, u64 key_length)
 {
-    u64 hash = hashmap->hash(key_data, key_length);
+    u32 hash = (u32)hashmap->hash(key_data, key_length);
 
-    flat_hashmap_entry_t* same_entry = find_exact_entry(hashmap, hash, key_data, key_length);
+    bool in_old;
+    flat_hashmap_entry_t* same_entry;
+
+    if (hashmap->rcu)
+    {
+        // A rehash that started after the view was taken may have moved
+        // the key out of the tables it covers (small tables drain at
+        // once), so a miss only counts if the tables are still the same
+        u32 seq;
+        do
+        {
+            table_view_t view = read_tables(hashmap, &seq);
+            same_entry = find_in_view(&view, hash, key_data, key_length, &in_old);
+        }
+        while (same_entry == NULL && tables_changed(hashmap, seq));
+    }
+    else
+    {
+        same_entry = find_exact_entry(hashmap, hash, key_data, key_length, &in_old);
+    }
 
     if (same_entry)
     {
@@ -368,9 +854,10 @@ flat_hashmap_result_t fhashmap_get_data(flat_hashmap_t* hashmap, const void *key
 
 flat_hashmap_result_t fhashmap_delete(flat_hashmap_t* hashmap, const void *key_data, u64 key_length)
 {
-    u64 hash = hashmap->hash(key_data, key_length);
+    u32 hash = (u32)hashmap->hash(key_data, key_length);
 
-    flat_hashmap_entry_t* same_entry = find_exact_entry(hashmap, hash, key_data, key_length);
+    bool in_old;
+    flat_hashmap_entry_t* same_entry = find_exact_entry(hashmap, hash, key_data, key_length, &in_old);
 
     if (!same_entry)
     {
@@ -382,53 +869,71 @@ flat_hashmap_result_t fhashmap_delete(flat_hashmap_t* hashmap, const void *key_d
 
     void* user_data = same_entry->data;
 
-    clean_entry(hashmap, same_entry, STATE_DELETE);
+    remove_entry(hashmap, same_entry, in_old);
 
-    hashmap->delete_count++;
-    hashmap->used_count--;
+    return (flat_hashmap_result_t){
+        .succeed = true,
+        .value = user_data
+    };
+}
 
-    if (handle_rehash(hashmap) != 0)
+void fhashmap_clear(flat_hashmap_t* hashmap)
+{
+    table_view_t view = writer_view(hashmap);
+
+    if (hashmap->rcu)
     {
-        return (flat_hashmap_result_t){
-            .succeed = false,
-            .value = NULL
-        };
+        flat_hashmap_entry_t* entries;
+        u8* ctrl = alloc_table(hashmap->capacity, &entries);
+
+        table_write_begin(hashmap);
+        hashmap->ctrl         = ctrl;
+        hashmap->entries      = entries;
+        hashmap->old_ctrl     = NULL;
+        hashmap->old_entries  = NULL;
+        hashmap->old_capacity = 0;
+        table_write_end(hashmap);
+
+        retire_table(view.ctrl, view.entries, view.capacity, true);
+
+        if (view.old_ctrl)
+        {
+            retire_table(view.old_ctrl, view.old_entries, view.old_capacity, true);
+        }
     }
     else
     {
-        return (flat_hashmap_result_t){
-            .succeed = true,
-            .value = user_data
-        };
-    }
-}
+        free_table_keys(view.ctrl, view.entries, view.capacity);
+        memset(view.ctrl, CTRL_EMPTY, view.capacity);
 
-void fhashmap_clear(flat_hashmap_t* hashmap)
-{
-    for (u32 i = 0; i < hashmap->capacity; i++)
-    {
-        if (hashmap->entries[i].flags & FLAG_ALLOCATED)
+        if (view.old_ctrl)
         {
-            kfree((void*)hashmap->entries[i].key_data);
+            free_table_keys(view.old_ctrl, view.old_entries, view.old_capacity);
+            kfree(view.old_ctrl);
+
+            hashmap->old_ctrl     = NULL;
+            hashmap->old_entries  = NULL;
+            hashmap->old_capacity = 0;
         }
     }
-    
-    memset(hashmap->entries, 0, hashmap->capacity * sizeof(flat_hashmap_entry_t));
+
+    hashmap->old_used_count = 0;
+    hashmap->migrate_pos    = 0;
 
     hashmap->delete_count = 0;
     hashmap->used_count   = 0;
     hashmap->empty_count  = hashmap->capacity;
 }
 
+// RCU mode too frees right away, readers must be gone by now
 void fhashmap_free(flat_hashmap_t* hashmap)
 {
-    for (u32 i = 0; i < hashmap->capacity; i++)
+    free_table_keys(hashmap->ctrl, hashmap->entries, hashmap->capacity);
+    kfree(hashmap->ctrl);
+
+    if (hashmap->old_ctrl)
     {
-        if (hashmap->entries[i].flags & FLAG_ALLOCATED)
-        {
-            kfree((void*)hashmap->entries[i].key_data);
-        }
+        free_table_keys(hashmap->old_ctrl, hashmap->old_entries, hashmap->old_capacity);
+        kfree(hashmap->old_ctrl);
     }
-
-    kfree(hashmap->entries);
-}
\ No newline at end of file
+}
@@ -0,0 +1,161 @@
+#include "utils/data_structs/mpmc_ring.h"
+#include "memory/heap/heap.h"
+#include <stdatomic.h>
+
+void mpmc_ring_init(mpmc_ring_t* ring, usize_ptr capacity)
+{
+    // capacity = 2^n
+    assert(capacity && (capacity & (capacity - 1)) == 0);
+
+    ring->cells = kmalloc(sizeof(mpmc_ring_cell_t) * capacity);
+    assert(ring->cells);
+
+    ring->mask = capacity - 1;
+
+    for (usize_ptr i = 0; i < capacity; i++)
+    {
+        atomic_init(&ring->cells[i].seq, i);
+        ring->cells[i].item = NULL;
+    }
+
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+}
+
+void mpmc_ring_free(mpmc_ring_t* ring)
+{
+    kfree(ring->cells);
+    ring->cells = NULL;
+}
+
+// how far seq is from the value that lets pos through, wrap safe
+static inline isize_ptr cell_lag(mpmc_ring_cell_t* cell, usize_ptr expected)
+{
+    return (isize_ptr)(atomic_load_explicit(&cell->seq, memory_order_acquire) - expected);
+}
+
+// Claims up to count positions from *pos_ptr whose cells all have
+// seq == pos + offset, returns how many (0 = ring full or empty). A cell
+// that is ready stays ready until its position is claimed, so checking
+// before the CAS is enough.
+static usize_ptr claim_run(
+    mpmc_ring_t* ring,
+    atom_usize_ptr* pos_ptr,
+    usize_ptr offset,
+    usize_ptr count,
+    usize_ptr* first)
+{
+    usize_ptr pos = atomic_load_explicit(pos_ptr, memory_order_relaxed);
+
+    while (true)
+    {
+        isize_ptr lag = cell_lag(&ring->cells[pos & ring->mask], pos + offset);
+
+        if (lag < 0)
+        {
+            return 0;
+        }
+
+        if (lag > 0)
+        {
+            // someone else took pos already
+            pos = atomic_load_explicit(pos_ptr, memory_order_relaxed);
+            continue;
+        }
+
+        usize_ptr run = 1;
+        while (run < count &&
+               cell_lag(&ring->cells[(pos + run) & ring->mask], pos + run + offset) == 0)
+        {
+            run++;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(
+                pos_ptr, &pos, pos + run,
+                memory_order_relaxed, memory_order_relaxed))
+        {
+            *first = pos;
+            return run;
+        }
+    }
+}
+
+usize_ptr mpmc_ring_push_batch(mpmc_ring_t* ring, void* const* items, usize_ptr count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    usize_ptr pos;
+    usize_ptr claimed = claim_run(ring, &ring->enqueue_pos, 0, count, &pos);
+
+    for (usize_ptr i = 0; i < claimed; i++)
+    {
+        assert(items[i]);
+
+        mpmc_ring_cell_t* cell = &ring->cells[(pos + i) & ring->mask];
+        cell->item = items[i];
+
+        // hand the slot to the consumer of pos + i
+        atomic_store_explicit(&cell->seq, pos + i + 1, memory_order_release);
+    }
+
+    return claimed;
+}
+
+usize_ptr mpmc_ring_pop_batch(mpmc_ring_t* ring, void** items, usize_ptr max_count)
+{
+    if (max_count == 0)
+    {
+        return 0;
+    }
+
+    usize_ptr pos;
+    usize_ptr claimed = claim_run(ring, &ring->dequeue_pos, 1, max_count, &pos);
+
+    for (usize_ptr i = 0; i < claimed; i++)
+    {
+        mpmc_ring_cell_t* cell = &ring->cells[(pos + i) & ring->mask];
+        items[i] = cell->item;
+
+        // free for the producer one lap later
+        atomic_store_explicit(&cell->seq, pos + i + ring->mask + 1, memory_order_release);
+    }
+
+    return claimed;
+}
+
+bool mpmc_ring_push(mpmc_ring_t* ring, void* item)
+{
+    return mpmc_ring_push_batch(ring, &item, 1) == 1;
+}
+
+void* mpmc_ring_pop(mpmc_ring_t* ring)
+{
+    void* item;
+
+    if (mpmc_ring_pop_batch(ring, &item, 1) == 0)
+    {
+        return NULL;
+    }
+
+    return item;
+}
+
+usize_ptr mpmc_ring_count(mpmc_ring_t* ring)
+{
+    usize_ptr dequeue = atomic_load_explicit(&ring->dequeue_pos, memory_order_acquire);
+    usize_ptr enqueue = atomic_load_explicit(&ring->enqueue_pos, memory_order_acquire);
+
+    // claimed but not yet filled slots count as in
+    return enqueue - dequeue;
+}
+
+bool mpmc_ring_is_empty(mpmc_ring_t* ring)
+{
+    usize_ptr pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+
+    // a slot a producer claimed but hasn't filled yet doesn't count
+    return cell_lag(&ring->cells[pos & ring->mask], pos + 1) < 0;
+}
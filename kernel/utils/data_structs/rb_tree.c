@@ -414,6 +414,8 @@ static inline void rb_delete_fixup_sibling_black_child_red(
 		sibling = parent->left;
     }
 
+	// the sibling takes the parent's place, and its color with it
+	set_color_to_other(sibling, parent);
 	set_black(parent);
 
 	// Case 4: Line Case:
@@ -557,20 +559,20 @@ void rb_init_tree(rb_tree_t *tree, rb_cmp_t cmp, rb_augment_t augment)
 	tree->root = NULL;
 	tree->cmp = cmp;
 	tree->augment = augment ? augment : dummy_no_agument;
+
+	tree->leftmost = NULL;
+	tree->rightmost = NULL;
+	tree->cached = false;
 }
 
-rb_node_t *rb_insert(rb_tree_t *tree, rb_node_t *node) 
+void rb_init_tree_cached(rb_tree_t *tree, rb_cmp_t cmp, rb_augment_t augment)
 {
-	rb_node_t** link = &tree->root;
-	rb_node_t* parent = NULL;
-
-	link = rb_find_node_link(tree, node, &parent);
-
-	if (*link != NULL)
-	{
-		return NULL;
-	}
+	rb_init_tree(tree, cmp, augment);
+	tree->cached = true;
+}
 
+void rb_insert_linked(rb_tree_t* tree, rb_node_t* node, rb_node_t* parent, rb_node_t** link)
+{
 	node->right = NULL;
 	node->left = NULL;
 	
@@ -580,50 +582,43 @@ rb_node_t *rb_insert(rb_tree_t *tree, rb_node_t *node)
 
 	set_parent(node, parent);
 
-	rb_insert_fixup(&tree->root, node);
+	// A new leaf is the new min only if it hangs left of the old min
+	if (tree->cached)
+	{
+		if (parent == NULL || (parent == tree->leftmost && link == &parent->left))
+		{
+			tree->leftmost = node;
+		}
+		if (parent == NULL || (parent == tree->rightmost && link == &parent->right))
+		{
+			tree->rightmost = node;
+		}
+	}
 
-	rb_augment_from(tree, *link);
+	rb_insert_fixup(&tree->root, node);
 
-	return node;
+	rb_augment_from(tree, node);
 }
 
-rb_node_t* rb_remove_key(rb_tree_t* tree, rb_node_t* key)
+rb_node_t *rb_insert(rb_tree_t *tree, rb_node_t *node) 
 {
-	rb_node_t** link = &tree->root;
 	rb_node_t* parent = NULL;
 
-	link = rb_find_node_link(tree, key, &parent);
-	
-	rb_node_t* delete = *link;
+	rb_node_t** link = rb_find_node_link(tree, node, &parent);
 
-	if (delete == NULL)
+	if (*link != NULL)
 	{
 		return NULL;
 	}
 
-	rb_node_t* node_to_fix = NULL;
-	rb_node_t* node_to_fix_parent = NULL;
+	rb_insert_linked(tree, node, parent, link);
 
-    bool delete_was_black = is_black(delete);
-
-	// Find the easiest configuration to delete the delete_node
-	rb_configure_delete(&tree->root, delete, &delete_was_black, &node_to_fix, &node_to_fix_parent);
-
-	if (delete_was_black)
-	{
-		rb_delete_fixup(&tree->root, node_to_fix, node_to_fix_parent);
-	}
-	
-	if (node_to_fix)
-	{
-		rb_augment_from(tree, node_to_fix);
-	}
-	else if (node_to_fix_parent)
-	{	
-		rb_augment_from(tree, node_to_fix_parent);
-	}
+	return node;
+}
 
-	return delete;
+rb_node_t* rb_remove_key(rb_tree_t* tree, rb_node_t* key)
+{
+	return rb_remove_node(tree, rb_search(tree, key));
 }
 
 rb_node_t *rb_remove_node(rb_tree_t *tree, rb_node_t *delete) 
@@ -633,6 +628,16 @@ rb_node_t *rb_remove_node(rb_tree_t *tree, rb_node_t *delete)
 		return NULL;
 	}
 
+	// step the cached ends inward while delete is still linked
+	if (tree->leftmost == delete)
+	{
+		tree->leftmost = rb_next(delete);
+	}
+	if (tree->rightmost == delete)
+	{
+		tree->rightmost = rb_prev(delete);
+	}
+
 	rb_node_t* node_to_fix = NULL;
 	rb_node_t* node_to_fix_parent = NULL;
 
@@ -696,12 +701,22 @@ static inline rb_node_t* rb_get_max(rb_node_t* node)
 
 rb_node_t* rb_min(rb_tree_t * tree)
 {
+	if (tree->cached)
+	{
+		return tree->leftmost;
+	}
+
 	rb_node_t* node = tree->root;
 	return rb_get_min(node);
 }
 
 rb_node_t* rb_max(rb_tree_t * tree)
 {
+	if (tree->cached)
+	{
+		return tree->rightmost;
+	}
+
 	rb_node_t* node = tree->root;
 	return rb_get_max(node);
 }
@@ -787,6 +802,8 @@ void rb_free_tree(rb_tree_t *tree, rb_free_t free_callback)
     }
 
     tree->root = NULL;
+    tree->leftmost = NULL;
+    tree->rightmost = NULL;
 }
 
 
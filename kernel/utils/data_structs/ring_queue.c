@@ -38,34 +38,25 @@ static bool ring_queue_grow(ring_queue_t* queue)
     usize_ptr head = queue->head;
     usize_ptr capacity = queue->capacity;
     usize_ptr count = queue->count;
-    void** arr = queue->arr;
-
-    usize_ptr start_arr_item_count = count - (capacity - head);
 
     usize_ptr new_capacity = capacity * 2;
     void** new_arr = kmalloc(new_capacity * sizeof(void*));
-    memcpy(new_arr, arr, start_arr_item_count * sizeof(void*));
+    if (new_arr == NULL)
+    {
+        return false;
+    }
 
-    usize_ptr new_head = head + capacity;
+    // unwrap, the items start at 0 in the new array
+    usize_ptr head_part = min(count, capacity - head);
+    memcpy(new_arr, &queue->arr[head], head_part * sizeof(void*));
+    memcpy(&new_arr[head_part], queue->arr, (count - head_part) * sizeof(void*));
 
-    memmove(
-        &new_arr[new_head],  
-        &new_arr[head], 
-        min(capacity - head, count - head)
-    );
+    kfree(queue->arr);
+
+    queue->arr = new_arr;
+    queue->head = 0;
+    queue->capacity = new_capacity;
 
-    // this thread resizes (avoid race condition)
-    if (queue->capacity < new_capacity) 
-    {
-        queue->arr = new_arr;
-        queue->head = new_head;
-        queue->capacity = new_capacity;
-    }    
-    else
-    {
-        kfree(new_arr);
-    }
-    
     return true;
 }
 
@@ -0,0 +1,141 @@
+#include "utils/data_structs/spsc_ring.h"
+#include "memory/heap/heap.h"
+#include <stdatomic.h>
+
+void spsc_ring_init(spsc_ring_t* ring, usize_ptr capacity)
+{
+    // capacity = 2^n
+    assert(capacity && (capacity & (capacity - 1)) == 0);
+
+    ring->slots = kmalloc(sizeof(void*) * capacity);
+    assert(ring->slots);
+
+    ring->mask = capacity - 1;
+
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->head, 0);
+    ring->cached_head = 0;
+    ring->cached_tail = 0;
+}
+
+void spsc_ring_free(spsc_ring_t* ring)
+{
+    kfree(ring->slots);
+    ring->slots = NULL;
+}
+
+// free slots as the producer sees them, only reloads head when the cached
+// one says there isn't room
+static usize_ptr producer_room(spsc_ring_t* ring, usize_ptr tail, usize_ptr wanted)
+{
+    usize_ptr capacity = ring->mask + 1;
+    usize_ptr room = capacity - (tail - ring->cached_head);
+
+    if (room < wanted)
+    {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        room = capacity - (tail - ring->cached_head);
+    }
+
+    return room;
+}
+
+// filled slots as the consumer sees them
+static usize_ptr consumer_ready(spsc_ring_t* ring, usize_ptr head, usize_ptr wanted)
+{
+    usize_ptr ready = ring->cached_tail - head;
+
+    if (ready < wanted)
+    {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        ready = ring->cached_tail - head;
+    }
+
+    return ready;
+}
+
+bool spsc_ring_push(spsc_ring_t* ring, void* item)
+{
+    assert(item);
+
+    usize_ptr tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (producer_room(ring, tail, 1) == 0)
+    {
+        return false;
+    }
+
+    ring->slots[tail & ring->mask] = item;
+
+    // the slot is written before the consumer can see it
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+usize_ptr spsc_ring_push_batch(spsc_ring_t* ring, void* const* items, usize_ptr count)
+{
+    usize_ptr tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    usize_ptr pushed = min(count, producer_room(ring, tail, count));
+
+    for (usize_ptr i = 0; i < pushed; i++)
+    {
+        assert(items[i]);
+        ring->slots[(tail + i) & ring->mask] = items[i];
+    }
+
+    if (pushed)
+    {
+        atomic_store_explicit(&ring->tail, tail + pushed, memory_order_release);
+    }
+
+    return pushed;
+}
+
+void* spsc_ring_pop(spsc_ring_t* ring)
+{
+    usize_ptr head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (consumer_ready(ring, head, 1) == 0)
+    {
+        return NULL;
+    }
+
+    void* item = ring->slots[head & ring->mask];
+
+    // the slot is read before the producer may reuse it
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    return item;
+}
+
+usize_ptr spsc_ring_pop_batch(spsc_ring_t* ring, void** items, usize_ptr max_count)
+{
+    usize_ptr head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    usize_ptr popped = min(max_count, consumer_ready(ring, head, max_count));
+
+    for (usize_ptr i = 0; i < popped; i++)
+    {
+        items[i] = ring->slots[(head + i) & ring->mask];
+    }
+
+    if (popped)
+    {
+        atomic_store_explicit(&ring->head, head + popped, memory_order_release);
+    }
+
+    return popped;
+}
+
+usize_ptr spsc_ring_count(spsc_ring_t* ring)
+{
+    usize_ptr head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    usize_ptr tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    return tail - head;
+}
+
+bool spsc_ring_is_empty(spsc_ring_t* ring)
+{
+    return spsc_ring_count(ring) == 0;
+}
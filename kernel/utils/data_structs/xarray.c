@@ -0,0 +1,432 @@
+#include "utils/data_structs/xarray.h"
+#include "memory/heap/heap.h"
+#include <string.h>
+
+#define INDEX_BITS (sizeof(usize_ptr) * 8)
+
+// index bits under a node at shift, all of them for a root that reaches
+// the top bit
+static inline usize_ptr span_mask(u32 shift)
+{
+    if (shift + XA_CHUNK_SHIFT >= INDEX_BITS)
+    {
+        return (usize_ptr)-1;
+    }
+
+    return ((usize_ptr)1 << (shift + XA_CHUNK_SHIFT)) - 1;
+}
+
+static inline u32 slot_offset(xa_node_t* node, usize_ptr index)
+{
+    return (index >> node->shift) & XA_CHUNK_MASK;
+}
+
+static xa_node_t* node_alloc(xa_node_t* parent, u32 shift, u32 offset)
+{
+    xa_node_t* node = kmalloc(sizeof(xa_node_t));
+    assert(node);
+
+    memset(node, 0, sizeof(xa_node_t));
+
+    node->parent = parent;
+    node->shift  = shift;
+    node->offset = offset;
+
+    return node;
+}
+
+static void node_free_rcu(rcu_head_t* head)
+{
+    kfree(container_of(head, xa_node_t, rcu));
+}
+
+// a reader may still be walking it in RCU mode
+static void node_free(xarray_t* xa, xa_node_t* node)
+{
+    if (xa->rcu)
+    {
+        call_rcu(&node->rcu, node_free_rcu);
+    }
+    else
+    {
+        kfree(node);
+    }
+}
+
+void init_xarray(xarray_t* xa)
+{
+    xa->root = NULL;
+    xa->rcu  = false;
+}
+
+void xa_set_rcu(xarray_t* xa)
+{
+    assert(xa->root == NULL);
+
+    xa->rcu = true;
+}
+
+static void node_destroy(xarray_t* xa, xa_node_t* node)
+{
+    if (node->shift)
+    {
+        for (u32 i = 0; i < XA_CHUNK_SIZE; i++)
+        {
+            if (node->slots[i])
+            {
+                node_destroy(xa, node->slots[i]);
+            }
+        }
+    }
+
+    node_free(xa, node);
+}
+
+void xa_destroy(xarray_t* xa)
+{
+    xa_node_t* root = xa->root;
+    if (root == NULL)
+    {
+        return;
+    }
+
+    rcu_assign_pointer(xa->root, NULL);
+    node_destroy(xa, root);
+}
+
+// leaf covering index, NULL if the path isn't there. Safe for readers.
+static xa_node_t* find_leaf(xarray_t* xa, usize_ptr index)
+{
+    xa_node_t* node = rcu_dereference(xa->root);
+
+    if (node == NULL || index > span_mask(node->shift))
+    {
+        return NULL;
+    }
+
+    while (node && node->shift)
+    {
+        node = rcu_dereference(node->slots[slot_offset(node, index)]);
+    }
+
+    return node;
+}
+
+void* xa_load(xarray_t* xa, usize_ptr index)
+{
+    xa_node_t* leaf = find_leaf(xa, index);
+    if (leaf == NULL)
+    {
+        return NULL;
+    }
+
+    return rcu_dereference(leaf->slots[index & XA_CHUNK_MASK]);
+}
+
+// Adds levels on top until index fits under the root. The old root goes
+// in slot 0 of the new one, so readers see either tree whole.
+static void extend_root(xarray_t* xa, usize_ptr index)
+{
+    xa_node_t* root = xa->root;
+
+    if (root == NULL)
+    {
+        u32 shift = 0;
+        while (index > span_mask(shift))
+        {
+            shift += XA_CHUNK_SHIFT;
+        }
+
+        rcu_assign_pointer(xa->root, node_alloc(NULL, shift, 0));
+        return;
+    }
+
+    while (index > span_mask(root->shift))
+    {
+        xa_node_t* top = node_alloc(NULL, root->shift + XA_CHUNK_SHIFT, 0);
+
+        top->slots[0] = root;
+        top->count = 1;
+
+        for (u32 tag = 0; tag < XA_TAG_COUNT; tag++)
+        {
+            top->tags[tag] = root->tags[tag] ? 1 : 0;
+        }
+
+        root->parent = top;
+        root->offset = 0;
+
+        rcu_assign_pointer(xa->root, top);
+        root = top;
+    }
+}
+
+// Drops levels while the root only leads to slot 0, the inverse of
+// extend_root
+static void shrink_root(xarray_t* xa)
+{
+    xa_node_t* root = xa->root;
+
+    while (root && root->shift && root->count == 1 && root->slots[0])
+    {
+        xa_node_t* child = root->slots[0];
+        child->parent = NULL;
+
+        rcu_assign_pointer(xa->root, child);
+        node_free(xa, root);
+
+        root = child;
+    }
+}
+
+void* xa_store(xarray_t* xa, usize_ptr index, void* entry)
+{
+    if (entry == NULL)
+    {
+        return xa_erase(xa, index);
+    }
+
+    extend_root(xa, index);
+
+    xa_node_t* node = xa->root;
+    while (node->shift)
+    {
+        u32 offset = slot_offset(node, index);
+        xa_node_t* child = node->slots[offset];
+
+        if (child == NULL)
+        {
+            child = node_alloc(node, node->shift - XA_CHUNK_SHIFT, offset);
+
+            // zeroed before readers can reach it
+            rcu_assign_pointer(node->slots[offset], child);
+            node->count++;
+        }
+
+        node = child;
+    }
+
+    u32 offset = index & XA_CHUNK_MASK;
+    void* old = node->slots[offset];
+
+    if (old == NULL)
+    {
+        node->count++;
+    }
+
+    rcu_assign_pointer(node->slots[offset], entry);
+
+    return old;
+}
+
+// sets the bit up to the root, stops at the first level that had it
+static void tag_set_up(xa_node_t* node, u32 offset, xa_tag_t tag)
+{
+    while (node)
+    {
+        u64 bit = (u64)1 << offset;
+
+        if (node->tags[tag] & bit)
+        {
+            break;
+        }
+        node->tags[tag] |= bit;
+
+        offset = node->offset;
+        node = node->parent;
+    }
+}
+
+// clears the bit up to the root, stops at the first level where another
+// slot is still tagged
+static void tag_clear_up(xa_node_t* node, u32 offset, xa_tag_t tag)
+{
+    while (node)
+    {
+        node->tags[tag] &= ~((u64)1 << offset);
+
+        if (node->tags[tag])
+        {
+            break;
+        }
+
+        offset = node->offset;
+        node = node->parent;
+    }
+}
+
+void* xa_erase(xarray_t* xa, usize_ptr index)
+{
+    xa_node_t* node = find_leaf(xa, index);
+    if (node == NULL)
+    {
+        return NULL;
+    }
+
+    u32 offset = index & XA_CHUNK_MASK;
+    void* old = node->slots[offset];
+
+    if (old == NULL)
+    {
+        return NULL;
+    }
+
+    for (u32 tag = 0; tag < XA_TAG_COUNT; tag++)
+    {
+        if (node->tags[tag] & ((u64)1 << offset))
+        {
+            tag_clear_up(node, offset, tag);
+        }
+    }
+
+    rcu_assign_pointer(node->slots[offset], NULL);
+    node->count--;
+
+    // unlink emptied nodes bottom up, their tags are all clear by now
+    while (node->count == 0)
+    {
+        xa_node_t* parent = node->parent;
+
+        if (parent == NULL)
+        {
+            rcu_assign_pointer(xa->root, NULL);
+            node_free(xa, node);
+            break;
+        }
+
+        rcu_assign_pointer(parent->slots[node->offset], NULL);
+        parent->count--;
+
+        node_free(xa, node);
+        node = parent;
+    }
+
+    shrink_root(xa);
+
+    return old;
+}
+
+void xa_set_tag(xarray_t* xa, usize_ptr index, xa_tag_t tag)
+{
+    xa_node_t* leaf = find_leaf(xa, index);
+    u32 offset = index & XA_CHUNK_MASK;
+
+    assert(leaf && leaf->slots[offset]);
+
+    tag_set_up(leaf, offset, tag);
+}
+
+void xa_clear_tag(xarray_t* xa, usize_ptr index, xa_tag_t tag)
+{
+    xa_node_t* leaf = find_leaf(xa, index);
+    u32 offset = index & XA_CHUNK_MASK;
+
+    if (leaf && (leaf->tags[tag] & ((u64)1 << offset)))
+    {
+        tag_clear_up(leaf, offset, tag);
+    }
+}
+
+bool xa_get_tag(xarray_t* xa, usize_ptr index, xa_tag_t tag)
+{
+    xa_node_t* leaf = find_leaf(xa, index);
+
+    return leaf && (leaf->tags[tag] & ((u64)1 << (index & XA_CHUNK_MASK)));
+}
+
+// first slot from offset on worth descending into, XA_CHUNK_SIZE if none
+static u32 next_slot(xa_node_t* node, u32 offset, i32 tag)
+{
+    if (tag >= 0)
+    {
+        u64 tagged = node->tags[tag] >> offset;
+
+        return tagged ? offset + __builtin_ctzll(tagged) : XA_CHUNK_SIZE;
+    }
+
+    while (offset < XA_CHUNK_SIZE && rcu_dereference(node->slots[offset]) == NULL)
+    {
+        offset++;
+    }
+
+    return offset;
+}
+
+// Descends towards *index, moving right past empty (or untagged) slots.
+// When a node runs out it restarts from the root just past that node's
+// span rather than climbing parent pointers, which a reader can't trust.
+static void* find_from(xarray_t* xa, usize_ptr* index_ptr, usize_ptr last, i32 tag)
+{
+    usize_ptr index = *index_ptr;
+
+    while (index <= last)
+    {
+        xa_node_t* node = rcu_dereference(xa->root);
+
+        if (node == NULL || index > span_mask(node->shift))
+        {
+            return NULL;
+        }
+
+        usize_ptr skip_mask;
+
+        while (true)
+        {
+            u32 offset = slot_offset(node, index);
+            u32 next = next_slot(node, offset, tag);
+
+            if (next == XA_CHUNK_SIZE)
+            {
+                skip_mask = span_mask(node->shift);
+                break;
+            }
+
+            if (next != offset)
+            {
+                index = (index & ~span_mask(node->shift)) | ((usize_ptr)next << node->shift);
+            }
+
+            if (index > last)
+            {
+                return NULL;
+            }
+
+            void* slot = rcu_dereference(node->slots[next]);
+
+            // erased since the tag or slot was read, step over it
+            if (slot == NULL)
+            {
+                skip_mask = ((usize_ptr)1 << node->shift) - 1;
+                break;
+            }
+
+            if (node->shift == 0)
+            {
+                *index_ptr = index;
+                return slot;
+            }
+
+            node = slot;
+        }
+
+        // the rest of what that node covers is empty
+        if ((index | skip_mask) >= last)
+        {
+            return NULL;
+        }
+
+        index = (index | skip_mask) + 1;
+    }
+
+    return NULL;
+}
+
+void* xa_find(xarray_t* xa, usize_ptr* index, usize_ptr last)
+{
+    return find_from(xa, index, last, -1);
+}
+
+void* xa_find_tag(xarray_t* xa, usize_ptr* index, usize_ptr last, xa_tag_t tag)
+{
+    return find_from(xa, index, last, tag);
+}
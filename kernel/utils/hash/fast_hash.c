@@ -0,0 +1,97 @@
+#include "core/num_defs.h"
+#include <utils/hash/fast_hash.h>
+
+#define PRIME1 0x9E3779B1U
+#define PRIME2 0x85EBCA77U
+#define PRIME3 0xC2B2AE3DU
+#define PRIME4 0x27D4EB2FU
+#define PRIME5 0x165667B1U
+
+static inline u32 rotl32(u32 value, u32 shift)
+{
+    return (value << shift) | (value >> (32 - shift));
+}
+
+// x86 loads unaligned words natively, the builtin becomes a single mov
+// even with -ffreestanding
+static inline u32 read32(const u8* data)
+{
+    u32 value;
+    __builtin_memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline u32 round32(u32 acc, u32 input)
+{
+    acc += input * PRIME2;
+    acc  = rotl32(acc, 13);
+    acc *= PRIME1;
+
+    return acc;
+}
+
+u32 xxhash32_seed(const u8* data, u32 length, u32 seed)
+{
+    const u8* end = data + length;
+    u32 hash;
+
+    // four independent lanes of 16 byte stripes
+    if (length >= 16)
+    {
+        const u8* limit = end - 16;
+
+        u32 v1 = seed + PRIME1 + PRIME2;
+        u32 v2 = seed + PRIME2;
+        u32 v3 = seed;
+        u32 v4 = seed - PRIME1;
+
+        do
+        {
+            v1 = round32(v1, read32(data + 0));
+            v2 = round32(v2, read32(data + 4));
+            v3 = round32(v3, read32(data + 8));
+            v4 = round32(v4, read32(data + 12));
+            data += 16;
+        } while (data <= limit);
+
+        hash = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    }
+    else
+    {
+        hash = seed + PRIME5;
+    }
+
+    hash += length;
+
+    // Handle last few words and bytes
+    for (; data + 4 <= end; data += 4)
+    {
+        hash += read32(data) * PRIME3;
+        hash  = rotl32(hash, 17) * PRIME4;
+    }
+
+    for (; data < end; data++)
+    {
+        hash += *data * PRIME5;
+        hash  = rotl32(hash, 11) * PRIME1;
+    }
+
+    // Last manipulation
+    hash ^= hash >> 15;
+    hash *= PRIME2;
+    hash ^= hash >> 13;
+    hash *= PRIME3;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+u32 xxhash32(const u8* data, u32 length)
+{
+    return xxhash32_seed(data, length, 0);
+}
+
+u64 fast_hash(const u8* data, u64 length)
+{
+    return xxhash32_seed(data, (u32)length, 0);
+}
@@ -2,9 +2,10 @@
 
 #include "core/num_defs.h"
 #include "memory/heap/heap.h"
+#include "services/threads/rcu.h"
 #include "sys/num_defs.h"
 #include "utils/data_structs/flat_hashmap.h"
-#include "utils/hash/murmur2_hash.h"
+#include "utils/hash/fast_hash.h"
 #include "vfs/core/dir_entry.h"
 #include "vfs/core/superblock.h"
 #include <string.h>
@@ -27,22 +28,34 @@ dir_entry_t* dir_entry_create(
     return entry;
 }
 
+// Parent pointer then the name bytes, unterminated, the key length holds
+// the name length. Short names fit the map's inline key slot.
 typedef struct dentry_key {
     dir_entry_t* parent;
-    u64          name_len;
-    char         name[];
+    char         name[MAX_NODE_NAME_LENGTH];
 } dentry_key_t;
 
-static u64 dentry_hash(const u8* key_data, u64 len)
+#define DENTRY_KEY_NAME_OFFSET offsetof(dentry_key_t, name)
+
+// returns the key length
+static usize_ptr dentry_key_build(dentry_key_t* key, dir_entry_t* parent, const char* name)
 {
-    (void)len;
+    usize_ptr name_len = strlen(name);
+    assert(name_len <= MAX_NODE_NAME_LENGTH);
+
+    key->parent = parent;
+    memcpy(key->name, name, name_len);
 
+    return DENTRY_KEY_NAME_OFFSET + name_len;
+}
+
+static u64 dentry_hash(const u8* key_data, u64 len)
+{
     const dentry_key_t* key = (const dentry_key_t*) key_data;
 
-    u64 h = murmur2_hash64((u8*)&key->parent, sizeof(dir_entry_t*));
-    h ^= murmur2_hash64((u8*)key->name, key->name_len);
+    u32 h = xxhash32((const u8*)key->name, len - DENTRY_KEY_NAME_OFFSET);
 
-    return h;
+    return hash_combine(h, (u32)(uptr)key->parent);
 }
 
 dir_entry_t* dir_entry_cache_lookup(
@@ -50,22 +63,14 @@ dir_entry_t* dir_entry_cache_lookup(
     dir_entry_t* parent,
     const char* child_name)
 {
-    usize_ptr name_len = strlen(child_name);
-    assert(name_len <= MAX_NODE_NAME_LENGTH);
+    assert(rcu_read_lock_held());
 
-    const usize_ptr key_length = sizeof(dentry_key_t) + name_len + 1;
-    u8 key_as_arr[key_length];
-
-    dentry_key_t* key = (dentry_key_t*) key_as_arr;
-    *key = (dentry_key_t){
-        .name_len = name_len,
-        .parent   = parent
-    };
-    memcpy(key->name, child_name, name_len + 1);
+    dentry_key_t key;
+    usize_ptr key_length = dentry_key_build(&key, parent, child_name);
 
     flat_hashmap_result_t res = fhashmap_get_data(
         &cache->map, 
-        key, 
+        &key, 
         key_length
     );
 
@@ -79,52 +84,53 @@ dir_entry_t* dir_entry_cache_lookup(
     }
 }
 
-void dir_entry_cache_insert(
+dir_entry_t* dir_entry_cache_insert(
     dir_entry_cache_t* cache,
     dir_entry_t* entry)
 {
-    usize_ptr name_len = strlen(entry->name);
-    assert(name_len <= MAX_NODE_NAME_LENGTH);
+    dentry_key_t key;
+    usize_ptr key_length = dentry_key_build(&key, entry->parent, entry->name);
 
-    const usize_ptr key_length = sizeof(dentry_key_t) + name_len + 1;
-    u8 key_as_arr[key_length];
+    spinlock_lock(&cache->lock);
 
-    dentry_key_t* key = (dentry_key_t*) key_as_arr;
-    *key = (dentry_key_t){
-        .name_len = name_len,
-        .parent   = entry->parent
-    };
-    memcpy(key->name, entry->name, name_len + 1);
+    // two lookups may miss on the same name, the first insert wins
+    flat_hashmap_result_t res = fhashmap_get_data(&cache->map, &key, key_length);
+    if (res.succeed)
+    {
+        spinlock_unlock(&cache->lock);
+
+        // never published, no reader can hold it
+        kfree(entry);
+        return res.value;
+    }
 
     fhashmap_insert(
         &cache->map, 
-        key, key_length, 
+        &key, key_length, 
         entry, 
         FHASHMAP_INS_FLAG_KEY_COPY
     ); 
+
+    spinlock_unlock(&cache->lock);
+
+    return entry;
 }
 
 void dir_entry_cache_drop(
     dir_entry_cache_t* cache,
     dir_entry_t* entry)
 {
-    usize_ptr name_len = strlen(entry->name);
-    assert(name_len <= MAX_NODE_NAME_LENGTH);
-
-    const usize_ptr key_length = sizeof(dentry_key_t) + name_len + 1;
-    u8 key_as_arr[key_length];
+    dentry_key_t key;
+    usize_ptr key_length = dentry_key_build(&key, entry->parent, entry->name);
 
-    dentry_key_t* key = (dentry_key_t*) key_as_arr;
-    *key = (dentry_key_t){
-        .name_len = name_len,
-        .parent   = entry->parent
-    };
-    memcpy(key->name, entry->name, name_len + 1);
+    spinlock_lock(&cache->lock);
 
     fhashmap_delete(
         &cache->map,
-        key, key_length
+        &key, key_length
     );
+
+    spinlock_unlock(&cache->lock);
 }
 
 struct purge_entry_dir_entry_data 
@@ -153,8 +159,10 @@ void dir_entry_cache_purge_sb(
         .cache = cache,
         .sb = sb,
     };
-        
+
+    spinlock_lock(&cache->lock);
     fhashmap_foreach(&cache->map, dir_purge_entry, &purge_data);
+    spinlock_unlock(&cache->lock);
 }
 
 static void on_destroy(void* data, void* key_data, usize_ptr key_length)
@@ -167,9 +175,14 @@ static void on_destroy(void* data, void* key_data, usize_ptr key_length)
 void init_dir_entry_cache(dir_entry_cache_t* cache)
 {
     cache->map = init_fhashmap_destroy_hash(dentry_hash, on_destroy);
+    fhashmap_set_rcu(&cache->map);
+
+    spinlock_initlock(&cache->lock, false);
 }
 
 void clean_dir_entry_cache(dir_entry_cache_t* cache)
 {
+    spinlock_lock(&cache->lock);
     fhashmap_clear(&cache->map);
+    spinlock_unlock(&cache->lock);
 }
@@ -1,6 +1,7 @@
 
 #include "vfs/core/mount.h"
 #include "memory/heap/heap.h"
+#include "services/threads/rcu.h"
 #include "sys/num_defs.h"
 #include "utils/data_structs/flat_hashmap.h"
 #include "vfs/core/dir_entry.h"
@@ -20,14 +21,19 @@ void vfs_mount_register(
     new_mount->mountpoint   = target;
     new_mount->name     = kstrdup(mount_name);
 
+    spinlock_lock(&mount_data->mount_lock);
+
+    // keyed by the dentry's address, copied into the slot
     isize_ptr res = fhashmap_insert(
         &mount_data->mounts, 
-        new_mount->mountpoint, 
+        &new_mount->mountpoint, 
         sizeof(dir_entry_t*), 
         new_mount, 
-        0
+        FHASHMAP_INS_FLAG_KEY_COPY
     );
 
+    spinlock_unlock(&mount_data->mount_lock);
+
     assert(res >= 0);
 }
 
@@ -35,9 +41,11 @@ dir_entry_t* vfs_mount_resolve(
     vfs_mount_map_t* mount_data, 
     dir_entry_t* target)
 {
+    assert(rcu_read_lock_held());
+
     flat_hashmap_result_t result = fhashmap_get_data(
         &mount_data->mounts, 
-        target,
+        &target,
         sizeof(dir_entry_t*)
     );
 
@@ -46,7 +54,9 @@ dir_entry_t* vfs_mount_resolve(
         return NULL;
     }
 
-    return result.value;
+    vfs_mountpoint_t* mount = result.value;
+
+    return mount->root;
 }
 
 void vfs_mount_set_root(vfs_mount_map_t* mount_tree, superblock_t* root_sb)
@@ -63,17 +73,20 @@ void vfs_mount_set_root(vfs_mount_map_t* mount_tree, superblock_t* root_sb)
     dir_entry_t* root_dentry =
         dir_entry_create(NULL, "", root_inode);
 
-    dir_entry_cache_insert(
+    root_dentry = dir_entry_cache_insert(
         &mount_tree->dcache,
         root_dentry
     );
 
-    mount_tree->root = root_dentry;
+    rcu_assign_pointer(mount_tree->root, root_dentry);
 }
 
 void vfs_mount_init_tree(vfs_mount_map_t* mount_tree)
 {
     mount_tree->root   = NULL;
     mount_tree->mounts = init_fhashmap();
+    fhashmap_set_rcu(&mount_tree->mounts);
+    spinlock_initlock(&mount_tree->mount_lock, false);
+
     init_dir_entry_cache(&mount_tree->dcache);
 }
\ No newline at end of file
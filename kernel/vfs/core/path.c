@@ -1,6 +1,7 @@
 #include "vfs/core/path.h"
 #include "core/defs.h"
 #include "core/num_defs.h"
+#include "services/threads/rcu.h"
 #include "string.h"
 #include "vfs/core/defs.h"
 #include "vfs/core/dir_entry.h"
@@ -65,11 +66,17 @@ static i32 path_lookup_step(
     assert(parent->inode->ops);
     assert(parent->inode->ops->lookup);
 
+    // the filesystem may sleep on the disk, leave the read section.
+    // dentries have no references yet, only a purge of the parent's
+    // superblock (unmount) may free it meanwhile.
+    rcu_read_unlock();
+
     struct inode* inode;
     i32 result = parent->inode->ops->lookup(parent->inode, cur_subpath, &inode);
 
     if (result < 0)
     {
+        rcu_read_lock();
         return result;
     }
 
@@ -79,7 +86,9 @@ static i32 path_lookup_step(
         inode
     );
 
-    dir_entry_cache_insert(&vfs->dcache, entry);
+    entry = dir_entry_cache_insert(&vfs->dcache, entry);
+
+    rcu_read_lock();
 
     *child = entry;
     return 0; 
@@ -97,20 +106,26 @@ i32 vfs_lookup_path(
 
     if (path[1] == '\0')
     {
-        *result = vfs->root;
+        *result = rcu_dereference(vfs->root);
         return 0;
     }
 
-    
+    // cached components resolve without a lock, the read section only
+    // drops while a miss goes to the filesystem
+    rcu_read_lock();
+
     usize_ptr offset = 0;
-    dir_entry_t* cur = vfs->root;
+    dir_entry_t* cur = rcu_dereference(vfs->root);
     
     while (path[offset] != '\0')
     {
-        dir_entry_t* child;
+        dir_entry_t* child = NULL;
         i32 result = path_lookup_step(vfs, cur, path, offset, &child);
         if (!child || result < 0)
+        {
+            rcu_read_unlock();
             return result;
+        }
 
         dir_entry_t* mount_res = vfs_mount_resolve(vfs, child);
         if (mount_res)
@@ -125,6 +140,8 @@ i32 vfs_lookup_path(
         offset = (usize_ptr)next;
     } 
 
+    rcu_read_unlock();
+
     *result = cur;
     return 0;
 }
\ No newline at end of file
@@ -2,15 +2,40 @@
 #include "utils/data_structs/flat_hashmap.h"
 #include "vfs/core/superblock.h"
 
-void inode_cache_insert(superblock_t* sb, inode_t* node)
+inode_t* inode_cache_insert(superblock_t* sb, inode_t* node)
 {
-    fhashmap_insert(
+    rwsem_write_lock(&sb->inode_cache_lock);
+
+    isize_ptr res = fhashmap_insert(
         &sb->inode_cache, 
         node->fs_id, 
         node->fs_id_length, 
         node, 
         0
     ); 
+
+    if (res < 0)
+    {
+        // lost a race with another fetch of the same inode
+        inode_t* cached = fhashmap_get_data(
+            &sb->inode_cache, 
+            node->fs_id, 
+            node->fs_id_length
+        ).value;
+
+        rwsem_write_unlock(&sb->inode_cache_lock);
+
+        if (sb->inode_cache.destroy_cb)
+        {
+            sb->inode_cache.destroy_cb(node, node->fs_id, node->fs_id_length);
+        }
+
+        return cached;
+    }
+
+    rwsem_write_unlock(&sb->inode_cache_lock);
+
+    return node;
 }
 
 inode_t* inode_cache_fetch(
@@ -18,12 +43,16 @@ inode_t* inode_cache_fetch(
     const void* fs_id,
     usize_ptr fs_id_length)
 {
+    rwsem_read_lock(&sb->inode_cache_lock);
+
     flat_hashmap_result_t res = fhashmap_get_data(
         &sb->inode_cache, 
         fs_id, 
         fs_id_length
     );
 
+    rwsem_read_unlock(&sb->inode_cache_lock);
+
     if (! res.succeed)
     {
         return NULL;
@@ -34,11 +63,15 @@ inode_t* inode_cache_fetch(
 
 void inode_cache_drop(superblock_t* sb, inode_t* node)
 {
+    rwsem_write_lock(&sb->inode_cache_lock);
+
     fhashmap_delete(
         &sb->inode_cache, 
         node->fs_id, 
         node->fs_id_length
     ); 
+
+    rwsem_write_unlock(&sb->inode_cache_lock);
 }
 
 static void del_inode_entry(void* data, void* key, usize_ptr key_length, void* ctx)
@@ -54,12 +87,16 @@ static void del_inode_entry(void* data, void* key, usize_ptr key_length, void* c
 
 void inode_cache_purge_sb(superblock_t* sb)
 {
+    rwsem_write_lock(&sb->inode_cache_lock);
+
     // theoretically dangerous though
     fhashmap_foreach(
         &sb->inode_cache, 
         del_inode_entry, 
         &sb->inode_cache
     );
+
+    rwsem_write_unlock(&sb->inode_cache_lock);
 }
 
 void init_inode_cache(
@@ -71,4 +108,6 @@ void init_inode_cache(
         fs_inode_hash, 
         inode_destroy_cb
     );
+
+    rwsem_init(&sb->inode_cache_lock);
 }
\ No newline at end of file
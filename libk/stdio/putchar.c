@@ -1,13 +1,13 @@
 #include <stdio.h>
 
 #if defined(__is_libk)
-#include <drivers/tty.h>
+#include <drivers/console.h>
 #endif
 
 int putchar(int ic) {
 #if defined(__is_libk)
 	char c = (char) ic;
-	terminal_write(&c, (usize_ptr)sizeof(c));
+	console_write(&c, (usize_ptr)sizeof(c));
 #else
 	// TODO: Implement stdio and the write system call.
 #endif
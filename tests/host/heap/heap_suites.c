@@ -0,0 +1,8 @@
+#include "host_test.h"
+
+extern const host_suite_t heap_suite;
+
+const host_suite_t* const host_suites[] = {
+    &heap_suite,
+    NULL
+};
@@ -0,0 +1,94 @@
+#include "host_test.h"
+#include "heap/mm_shim.h"
+#include <kernel/memory/paging.h>
+#include <memory/core/memory_manager.h>
+#include <memory/core/pfn_desc.h>
+#include <memory/virt/virt_map.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARENA_PAGES (MM_SHIM_ARENA_SIZE / PAGE_SIZE)
+
+static u8* arena;
+static page_t descs[ARENA_PAGES];
+static usize_ptr next_page;
+
+// what the heap sees for any address outside the arena, never one of its
+// own pages so it never merges with one
+static page_t outside;
+
+void* mm_shim_arena()
+{
+    if (arena == NULL)
+    {
+        // buddies merge by address bits, like the kernel's aligned heap base
+        arena = aligned_alloc(MM_SHIM_ARENA_SIZE, MM_SHIM_ARENA_SIZE);
+        assert(arena);
+    }
+
+    return arena;
+}
+
+usize_ptr mm_shim_pages_used()
+{
+    return next_page;
+}
+
+void mm_lock()
+{
+}
+
+void mm_unlock()
+{
+}
+
+// the heap grows upwards from its base only, so handing out frames in
+// order keeps virtual and physical offsets equal
+page_t* mm_alloc_pages(usize_ptr count)
+{
+    if (next_page + count > ARENA_PAGES)
+    {
+        printf("mm_shim: arena exhausted\n");
+        abort();
+    }
+
+    page_t* first = &descs[next_page];
+    next_page += count;
+
+    return first;
+}
+
+void* virt_to_phys(void* va)
+{
+    return (void*)((uptr)va - (uptr)arena);
+}
+
+page_t* pa_to_pfn(void* pa)
+{
+    usize_ptr index = (uptr)pa / PAGE_SIZE;
+    if (index >= ARENA_PAGES)
+    {
+        outside = (page_t){ 0 };
+        return &outside;
+    }
+
+    return &descs[index];
+}
+
+void* pfn_to_pa(page_t* desc)
+{
+    return (void*)((desc - descs) * PAGE_SIZE);
+}
+
+bool paging_map_pages(void* pa, void* va, usize_ptr count, u16 paging_flags)
+{
+    assert(virt_to_phys(va) == pa);
+    assert((uptr)pa / PAGE_SIZE + count <= ARENA_PAGES);
+
+    return true;
+}
+
+void vmap_pages(void* va, page_t* pfn, enum virt_region_type vregion, usize_ptr pages)
+{
+    paging_map_pages(pfn_to_pa(pfn), va, pages, 0);
+}
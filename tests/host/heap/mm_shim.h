@@ -0,0 +1,16 @@
+#ifndef __HOST_MM_SHIM_H__
+#define __HOST_MM_SHIM_H__
+
+#include "core/num_defs.h"
+
+// Stands in for the frame allocator and page tables under the real heap:
+// one aligned arena whose "physical" addresses are offsets into it.
+
+#define MM_SHIM_ARENA_SIZE STOR_64MiB
+
+void* mm_shim_arena();
+
+// pages the heap took from the fake frame allocator so far
+usize_ptr mm_shim_pages_used();
+
+#endif // __HOST_MM_SHIM_H__
@@ -0,0 +1,235 @@
+#include "host_test.h"
+#include "heap/mm_shim.h"
+#include <kernel/core/paging.h>
+#include <memory/heap/heap.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RANDOM_ALLOCS 2000
+#define BENCH_OPS     200000
+#define BENCH_BATCH   20000
+
+// one heap per process, like the kernel's
+static void ensure_heap()
+{
+    static bool ready;
+    if (!ready)
+    {
+        init_heap(mm_shim_arena(), MM_SHIM_ARENA_SIZE, STOR_1MiB);
+        ready = true;
+    }
+}
+
+static bool filled_with(const u8* data, usize_ptr size, u8 value)
+{
+    for (usize_ptr i = 0; i < size; i++)
+    {
+        if (data[i] != value)
+            return false;
+    }
+
+    return true;
+}
+
+// random sizes stay intact and don't overlap until freed in random order
+static void test_random_sizes()
+{
+    ensure_heap();
+
+    static u8* ptrs[RANDOM_ALLOCS];
+    static usize_ptr sizes[RANDOM_ALLOCS];
+
+    u32 seed = 11;
+    for (u32 i = 0; i < RANDOM_ALLOCS; i++)
+    {
+        sizes[i] = 1 + host_rand(&seed) % 5000;
+        ptrs[i] = kmalloc(sizes[i]);
+        CHECK(ptrs[i]);
+
+        // power of 2 sized slab objects are aligned to their size
+        usize_ptr align = 16;
+        while (align < sizes[i] && align < PAGE_SIZE)
+            align *= 2;
+        CHECK((uptr)ptrs[i] % align == 0);
+
+        memset(ptrs[i], (u8)i, sizes[i]);
+    }
+
+    for (u32 i = 0; i < RANDOM_ALLOCS; i++)
+    {
+        CHECK(filled_with(ptrs[i], sizes[i], (u8)i));
+    }
+
+    for (u32 i = RANDOM_ALLOCS - 1; i > 0; i--)
+    {
+        u32 j = host_rand(&seed) % (i + 1);
+        u8* tmp_ptr = ptrs[i];   ptrs[i] = ptrs[j];   ptrs[j] = tmp_ptr;
+        usize_ptr tmp = sizes[i]; sizes[i] = sizes[j]; sizes[j] = tmp;
+    }
+
+    for (u32 i = 0; i < RANDOM_ALLOCS; i++)
+    {
+        kfree(ptrs[i]);
+    }
+}
+
+// buddy sized blocks, past the initial heap so it has to grow
+static void test_large()
+{
+    ensure_heap();
+
+    const usize_ptr sizes[] = { STOR_128KiB, STOR_1MiB, STOR_4MiB };
+    u8* ptrs[3];
+
+    for (u32 i = 0; i < 3; i++)
+    {
+        ptrs[i] = kmalloc(sizes[i]);
+        CHECK(ptrs[i]);
+        CHECK((uptr)ptrs[i] % PAGE_SIZE == 0);
+
+        memset(ptrs[i], 0xA0 + i, sizes[i]);
+    }
+
+    for (u32 i = 0; i < 3; i++)
+    {
+        CHECK(filled_with(ptrs[i], sizes[i], 0xA0 + i));
+        kfree(ptrs[i]);
+    }
+}
+
+static void test_realloc()
+{
+    ensure_heap();
+
+    u8* data = kmalloc(24);
+    memset(data, 0x5A, 24);
+
+    data = krealloc(data, 200);
+    CHECK(data && filled_with(data, 24, 0x5A));
+    memset(data, 0x5B, 200);
+
+    // slab to buddy
+    data = krealloc(data, 100000);
+    CHECK(data && filled_with(data, 200, 0x5B));
+
+    // shrinking keeps the block
+    CHECK(krealloc(data, 10) == data);
+
+    kfree(data);
+}
+
+static void test_slab_cache()
+{
+    ensure_heap();
+
+    heap_slab_cache_t* cache = kcreate_slab_cache(48, "test");
+    static u8* objs[500];
+
+    for (u32 i = 0; i < 500; i++)
+    {
+        objs[i] = kalloc_cache(cache);
+        CHECK(objs[i]);
+        memset(objs[i], (u8)i, 48);
+    }
+
+    for (u32 i = 0; i < 500; i++)
+    {
+        CHECK(filled_with(objs[i], 48, (u8)i));
+        kfree(objs[i]);
+    }
+
+    kfree_slab_cache(cache);
+}
+
+// freed memory is reused, the heap doesn't creep
+static void test_reuse()
+{
+    ensure_heap();
+
+    for (u32 round = 0; round < 3; round++)
+    {
+        usize_ptr pages = mm_shim_pages_used();
+
+        for (u32 i = 0; i < 10000; i++)
+        {
+            kfree(kmalloc(16 << (i % 12)));
+        }
+
+        CHECK(round == 0 || mm_shim_pages_used() == pages);
+    }
+}
+
+static const host_case_t tests[] = {
+    { "random_sizes", test_random_sizes },
+    { "large",        test_large },
+    { "realloc",      test_realloc },
+    { "slab_cache",   test_slab_cache },
+    { "reuse",        test_reuse },
+    HOST_CASES_END
+};
+
+static const usize_ptr bench_sizes[] = { 16, 64, 256, 1024, 4096, STOR_128KiB };
+
+static void bench_alloc_free()
+{
+    ensure_heap();
+
+    for (u32 s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); s++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "kmalloc+kfree %zu", (size_t)bench_sizes[s]);
+
+        u64 ns = host_now_ns();
+        u64 cycles = host_cycles();
+        for (u32 i = 0; i < BENCH_OPS; i++)
+        {
+            kfree(kmalloc(bench_sizes[s]));
+        }
+        host_bench_report(name, BENCH_OPS, host_now_ns() - ns, host_cycles() - cycles, 0);
+    }
+}
+
+// many live objects at once, bytes/op is what each one cost in pages
+static void bench_batch()
+{
+    ensure_heap();
+
+    static void* ptrs[BENCH_BATCH];
+
+    for (u32 s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]) - 1; s++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "batch kmalloc %zu", (size_t)bench_sizes[s]);
+
+        // stay well inside the arena
+        u32 count = min(BENCH_BATCH, STOR_16MiB / bench_sizes[s]);
+        usize_ptr pages = mm_shim_pages_used();
+
+        u64 ns = host_now_ns();
+        u64 cycles = host_cycles();
+        for (u32 i = 0; i < count; i++)
+        {
+            ptrs[i] = kmalloc(bench_sizes[s]);
+        }
+        host_bench_report(name, count, host_now_ns() - ns, host_cycles() - cycles,
+            (mm_shim_pages_used() - pages) * PAGE_SIZE);
+
+        snprintf(name, sizeof(name), "batch kfree %zu", (size_t)bench_sizes[s]);
+
+        ns = host_now_ns();
+        cycles = host_cycles();
+        for (u32 i = 0; i < count; i++)
+        {
+            kfree(ptrs[i]);
+        }
+        host_bench_report(name, count, host_now_ns() - ns, host_cycles() - cycles, 0);
+    }
+}
+
+static const host_case_t benches[] = {
+    { "alloc_free", bench_alloc_free },
+    { "batch",      bench_batch },
+    HOST_CASES_END
+};
+
+const host_suite_t heap_suite = { "heap", tests, benches };
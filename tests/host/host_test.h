@@ -0,0 +1,72 @@
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+
+#include "core/num_defs.h"
+#include <stdbool.h>
+
+// Kernel utilities built as Linux programs (see the Makefile next to this).
+// A suite lists its tests and microbenchmarks, each list ends with
+// HOST_CASES_END. A test stops at its first failed CHECK, a bench prints
+// its own numbers through host_bench_report.
+
+typedef struct host_case
+{
+    const char* name;
+    void (*fn)();
+} host_case_t;
+
+#define HOST_CASES_END { NULL, NULL }
+
+typedef struct host_suite
+{
+    const char* name;
+    const host_case_t* tests;
+    const host_case_t* benches;
+} host_suite_t;
+
+// NULL terminated, one list per test binary
+extern const host_suite_t* const host_suites[];
+
+void host_check_failed(const char* file, int line, const char* expr);
+
+#define CHECK(cond)                                             \
+    do                                                          \
+    {                                                           \
+        if (!(cond))                                            \
+        {                                                       \
+            host_check_failed(__FILE__, __LINE__, #cond);       \
+            return;                                             \
+        }                                                       \
+    } while (0)
+
+u64 host_now_ns();
+
+static inline u64 host_cycles()
+{
+    return __builtin_ia32_rdtsc();
+}
+
+// Prints ops/sec and cycles/op of a timed loop, and the memory it took
+// per op when bytes isn't 0
+void host_bench_report(const char* name, u64 ops, u64 ns, u64 cycles, u64 bytes);
+
+// xorshift32, deterministic so a failure reproduces
+static inline u32 host_rand(u32* state)
+{
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+// kmalloc shim only, bytes currently allocated through it
+usize_ptr host_heap_bytes();
+
+// kmalloc shim only, runs the queued call_rcu callbacks as if a grace
+// period passed
+void host_rcu_flush();
+
+#endif // __HOST_TEST_H__
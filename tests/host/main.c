@@ -0,0 +1,110 @@
+#include "host_test.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static bool case_failed;
+static u32 failures;
+
+void host_check_failed(const char* file, int line, const char* expr)
+{
+    printf("    %s:%d: CHECK(%s) failed\n", file, line, expr);
+    case_failed = true;
+}
+
+// the kernel's assert, a failed one ends the run like a panic would;
+// the address is for addr2line
+void assert(bool must_be_true)
+{
+    if (!must_be_true)
+    {
+        printf("    kernel assert failed at %p\n", __builtin_return_address(0));
+        __builtin_trap();
+    }
+}
+
+u64 host_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void host_bench_report(const char* name, u64 ops, u64 ns, u64 cycles, u64 bytes)
+{
+    double ops_per_sec = ns ? (double)ops * 1e9 / ns : 0;
+    double cycles_per_op = ops ? (double)cycles / ops : 0;
+
+    printf("  %-40s %12.0f ops/s %10.1f cycles/op", name, ops_per_sec, cycles_per_op);
+
+    if (bytes)
+    {
+        printf(" %8.1f bytes/op", (double)bytes / ops);
+    }
+
+    printf("\n");
+}
+
+static void run_cases(const host_suite_t* suite, const host_case_t* cases, bool report)
+{
+    for (const host_case_t* it = cases; it && it->fn; it++)
+    {
+        case_failed = false;
+        it->fn();
+
+        if (case_failed)
+        {
+            failures++;
+        }
+
+        if (report)
+        {
+            printf("%s %s/%s\n", case_failed ? "FAIL" : "ok  ", suite->name, it->name);
+        }
+    }
+}
+
+// usage: <binary> [--bench] [suite]
+int main(int argc, char** argv)
+{
+    bool bench = false;
+    const char* only = NULL;
+
+    // a trapping assert must not eat what was printed before it
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+            bench = true;
+        else
+            only = argv[i];
+    }
+
+    for (const host_suite_t* const* suite = host_suites; *suite; suite++)
+    {
+        if (only && strcmp(only, (*suite)->name) != 0)
+        {
+            continue;
+        }
+
+        if (bench)
+        {
+            printf("%s:\n", (*suite)->name);
+            run_cases(*suite, (*suite)->benches, false);
+        }
+        else
+        {
+            run_cases(*suite, (*suite)->tests, true);
+        }
+    }
+
+    if (failures)
+    {
+        printf("%u failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
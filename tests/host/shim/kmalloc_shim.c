@@ -0,0 +1,93 @@
+#include "host_test.h"
+#include <memory/heap/heap.h>
+#include <services/threads/rcu.h>
+#include <stdlib.h>
+#include <string.h>
+
+// kmalloc on top of malloc for the utility tests, with a size header so
+// the benches can report memory overhead
+
+typedef struct alloc_header
+{
+    usize_ptr size;
+    usize_ptr pad;
+} alloc_header_t;
+
+static usize_ptr live_bytes;
+
+void* kmalloc(usize_ptr size)
+{
+    alloc_header_t* header = malloc(sizeof(alloc_header_t) + size);
+    if (header == NULL)
+    {
+        return NULL;
+    }
+
+    header->size = size;
+    live_bytes += size;
+
+    return header + 1;
+}
+
+void* kmalloc_aligned(usize_ptr alignment, usize_ptr size)
+{
+    // like the kernel heap, the size is the alignment
+    return kmalloc(alignment > size ? alignment : size);
+}
+
+void kfree(void* addr)
+{
+    if (addr == NULL)
+    {
+        return;
+    }
+
+    alloc_header_t* header = (alloc_header_t*)addr - 1;
+    live_bytes -= header->size;
+
+    free(header);
+}
+
+void* krealloc(void* addr, usize_ptr new_size)
+{
+    void* new_addr = kmalloc(new_size);
+    if (new_addr && addr)
+    {
+        alloc_header_t* header = (alloc_header_t*)addr - 1;
+        memcpy(new_addr, addr, header->size < new_size ? header->size : new_size);
+        kfree(addr);
+    }
+
+    return new_addr;
+}
+
+usize_ptr host_heap_bytes()
+{
+    return live_bytes;
+}
+
+// single threaded, a grace period is whenever the test says so
+static rcu_head_t* pending;
+
+void call_rcu(rcu_head_t* head, rcu_callback_t fn)
+{
+    head->fn = fn;
+    head->next = pending;
+    pending = head;
+}
+
+void host_rcu_flush()
+{
+    while (pending)
+    {
+        rcu_head_t* batch = pending;
+        pending = NULL;
+
+        while (batch)
+        {
+            rcu_head_t* next = batch->next;
+            batch->fn(batch);
+            batch = next;
+        }
+    }
+}
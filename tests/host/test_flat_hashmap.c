@@ -0,0 +1,451 @@
+#include "host_test.h"
+#include <utils/data_structs/flat_hashmap.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RANDOM_KEYS 20000
+#define RANDOM_OPS  200000
+#define BENCH_KEYS  200000
+#define RCU_ROUNDS  20
+#define RCU_KEYS    5000
+
+static u32 destroyed;
+
+static void count_destroy(void* data, void* key_data, usize_ptr key_length)
+{
+    (void)data;
+    (void)key_data;
+    (void)key_length;
+
+    destroyed++;
+}
+
+// key k as a 4 byte (inline) or 40 byte (allocated) copied key
+static u64 make_key(u8* buffer, u32 k)
+{
+    memset(buffer, k % 7, 40);
+    memcpy(buffer, &k, sizeof(k));
+
+    return (k % 3) ? 4 : 40;
+}
+
+static void count_entry(void* data, void* key, usize_ptr key_length, void* ctx)
+{
+    (void)data;
+    (void)key;
+    (void)key_length;
+
+    (*(u32*)ctx)++;
+}
+
+static void test_basic()
+{
+    flat_hashmap_t map = init_fhashmap();
+    u32 key = 7;
+
+    CHECK(fhashmap_insert(&map, &key, sizeof(key), (void*)1, FHASHMAP_INS_FLAG_KEY_COPY) == 0);
+    CHECK(fhashmap_get_data(&map, &key, sizeof(key)).value == (void*)1);
+
+    // existing key without OVERWRITE is refused
+    CHECK(fhashmap_insert(&map, &key, sizeof(key), (void*)2, FHASHMAP_INS_FLAG_KEY_COPY) < 0);
+    CHECK(fhashmap_get_data(&map, &key, sizeof(key)).value == (void*)1);
+
+    CHECK(fhashmap_insert(&map, &key, sizeof(key), (void*)2,
+        FHASHMAP_INS_FLAG_KEY_COPY | FHASHMAP_INS_FLAG_OVERWRITE) == 0);
+    CHECK(fhashmap_get_data(&map, &key, sizeof(key)).value == (void*)2);
+    CHECK(fhashmap_count(&map) == 1);
+
+    flat_hashmap_result_t res = fhashmap_delete(&map, &key, sizeof(key));
+    CHECK(res.succeed && res.value == (void*)2);
+    CHECK(fhashmap_get_data(&map, &key, sizeof(key)).succeed == false);
+    CHECK(fhashmap_delete(&map, &key, sizeof(key)).succeed == false);
+    CHECK(fhashmap_count(&map) == 0);
+
+    fhashmap_free(&map);
+}
+
+// random inserts, deletes and lookups checked against a presence array
+static void random_ops(bool rcu)
+{
+    static bool present[RANDOM_KEYS];
+    memset(present, 0, sizeof(present));
+
+    usize_ptr heap_before = host_heap_bytes();
+    destroyed = 0;
+
+    flat_hashmap_t map = init_fhashmap_destroy(count_destroy);
+    if (rcu)
+    {
+        fhashmap_set_rcu(&map);
+    }
+
+    u32 seed = 1;
+    u32 expected_destroys = 0;
+
+    for (u32 i = 0; i < RANDOM_OPS; i++)
+    {
+        u32 k = host_rand(&seed) % RANDOM_KEYS;
+        u8 key[40];
+        u64 key_length = make_key(key, k);
+
+        switch (host_rand(&seed) % 3)
+        {
+        case 0:
+        {
+            bool overwrite = host_rand(&seed) & 1;
+            isize_ptr res = fhashmap_insert(
+                &map, key, key_length, (void*)(uptr)(k + 1),
+                FHASHMAP_INS_FLAG_KEY_COPY | (overwrite ? FHASHMAP_INS_FLAG_OVERWRITE : 0)
+            );
+
+            CHECK((res == 0) == (!present[k] || overwrite));
+            expected_destroys += present[k] && overwrite;
+            present[k] = true;
+            break;
+        }
+        case 1:
+        {
+            flat_hashmap_result_t res = fhashmap_delete(&map, key, key_length);
+
+            CHECK(res.succeed == present[k]);
+            expected_destroys += present[k];
+            present[k] = false;
+            break;
+        }
+        default:
+        {
+            flat_hashmap_result_t res = fhashmap_get_data(&map, key, key_length);
+
+            CHECK(res.succeed == present[k]);
+            CHECK(!res.succeed || res.value == (void*)(uptr)(k + 1));
+            break;
+        }
+        }
+
+        if (i % 1024 == 0)
+        {
+            host_rcu_flush();
+        }
+    }
+
+    u32 live = 0;
+    for (u32 k = 0; k < RANDOM_KEYS; k++)
+    {
+        live += present[k];
+    }
+
+    u32 seen = 0;
+    fhashmap_foreach(&map, count_entry, &seen);
+
+    CHECK(fhashmap_count(&map) == live);
+    CHECK(seen == live);
+
+    host_rcu_flush();
+    CHECK(destroyed == expected_destroys);
+
+    // clear drops the keys, the values stay the caller's
+    fhashmap_clear(&map);
+    host_rcu_flush();
+    CHECK(destroyed == expected_destroys);
+    CHECK(fhashmap_count(&map) == 0);
+
+    fhashmap_free(&map);
+    CHECK(host_heap_bytes() == heap_before);
+}
+
+static void test_random()
+{
+    random_ops(false);
+}
+
+static void test_random_rcu()
+{
+    random_ops(true);
+}
+
+// every insert may be mid migration, nothing may go missing meanwhile
+static void test_incremental_rehash()
+{
+    flat_hashmap_t map = init_fhashmap();
+    bool migrated = false;
+
+    for (u32 k = 0; k < 5000; k++)
+    {
+        CHECK(fhashmap_insert(&map, &k, sizeof(k), (void*)(uptr)(k + 1), FHASHMAP_INS_FLAG_KEY_COPY) == 0);
+        migrated |= map.old_ctrl != NULL;
+
+        u32 seen = 0;
+        fhashmap_foreach(&map, count_entry, &seen);
+        CHECK(seen == k + 1);
+
+        for (u32 j = 0; j <= k; j += 97)
+        {
+            CHECK(fhashmap_get_data(&map, &j, sizeof(j)).value == (void*)(uptr)(j + 1));
+        }
+    }
+
+    CHECK(migrated);
+
+    fhashmap_free(&map);
+}
+
+typedef struct rcu_reader_ctx
+{
+    flat_hashmap_t* map;
+    _Atomic bool done;
+    u64 lookups;
+    u64 misses;
+} rcu_reader_ctx_t;
+
+// key 0 never leaves the map, so a reader must always find it
+static void* rcu_reader(void* arg)
+{
+    rcu_reader_ctx_t* ctx = arg;
+    u32 key = 0;
+
+    while (!atomic_load(&ctx->done))
+    {
+        ctx->misses += !fhashmap_get_data(ctx->map, &key, sizeof(key)).succeed;
+        ctx->lookups++;
+    }
+
+    return NULL;
+}
+
+// a reader racing rehashes (growing, and tombstone only ones from the
+// deletes) never misses a present key. Grace periods only pass at the
+// end, so nothing the reader can still see is freed.
+static void test_rcu_concurrent_rehash()
+{
+    usize_ptr heap_before = host_heap_bytes();
+
+    flat_hashmap_t map = init_fhashmap();
+    fhashmap_set_rcu(&map);
+
+    u32 key = 0;
+    fhashmap_insert(&map, &key, sizeof(key), (void*)1, FHASHMAP_INS_FLAG_KEY_COPY);
+
+    rcu_reader_ctx_t ctx = { .map = &map };
+    pthread_t reader;
+    pthread_create(&reader, NULL, rcu_reader, &ctx);
+
+    for (u32 round = 0; round < RCU_ROUNDS; round++)
+    {
+        for (u32 k = 1; k <= RCU_KEYS; k++)
+        {
+            fhashmap_insert(&map, &k, sizeof(k), (void*)(uptr)k, FHASHMAP_INS_FLAG_KEY_COPY);
+        }
+        for (u32 k = 1; k <= RCU_KEYS; k++)
+        {
+            fhashmap_delete(&map, &k, sizeof(k));
+        }
+    }
+
+    atomic_store(&ctx.done, true);
+    pthread_join(reader, NULL);
+
+    CHECK(ctx.lookups > 0);
+    CHECK(ctx.misses == 0);
+
+    fhashmap_free(&map);
+    host_rcu_flush();
+    CHECK(host_heap_bytes() == heap_before);
+}
+
+typedef struct rcu_delete_ctx
+{
+    flat_hashmap_t* map;
+    _Atomic bool done;
+    u64 lookups;
+    u64 wrong;
+} rcu_delete_ctx_t;
+
+// looks up the very keys being deleted, so it keeps matching the hash of
+// entries the writer retires under it
+static void* rcu_delete_reader(void* arg)
+{
+    rcu_delete_ctx_t* ctx = arg;
+
+    while (!atomic_load(&ctx->done))
+    {
+        for (u32 k = 1; k <= RCU_KEYS; k++)
+        {
+            flat_hashmap_result_t got = fhashmap_get_data(ctx->map, &k, sizeof(k));
+
+            ctx->wrong += got.succeed && got.value != (void*)(uptr)k;
+            ctx->lookups++;
+        }
+    }
+
+    return NULL;
+}
+
+// a retired entry keeps its inline key readable until the grace period,
+// a reader comparing against it mustn't take the key bytes for a pointer
+static void test_rcu_concurrent_delete()
+{
+    usize_ptr heap_before = host_heap_bytes();
+
+    flat_hashmap_t map = init_fhashmap();
+    fhashmap_set_rcu(&map);
+
+    // sized up front, deletes only leave tombstones behind
+    for (u32 k = 1; k <= RCU_KEYS; k++)
+    {
+        fhashmap_insert(&map, &k, sizeof(k), (void*)(uptr)k, FHASHMAP_INS_FLAG_KEY_COPY);
+    }
+
+    rcu_delete_ctx_t ctx = { .map = &map };
+    pthread_t reader;
+    pthread_create(&reader, NULL, rcu_delete_reader, &ctx);
+
+    for (u32 round = 0; round < RCU_ROUNDS; round++)
+    {
+        for (u32 k = 1; k <= RCU_KEYS; k++)
+        {
+            fhashmap_delete(&map, &k, sizeof(k));
+        }
+        for (u32 k = 1; k <= RCU_KEYS; k++)
+        {
+            fhashmap_insert(&map, &k, sizeof(k), (void*)(uptr)k, FHASHMAP_INS_FLAG_KEY_COPY);
+        }
+    }
+
+    atomic_store(&ctx.done, true);
+    pthread_join(reader, NULL);
+
+    CHECK(ctx.lookups > 0);
+    CHECK(ctx.wrong == 0);
+
+    fhashmap_free(&map);
+    host_rcu_flush();
+    CHECK(host_heap_bytes() == heap_before);
+}
+
+static void delete_entry(void* data, void* key, usize_ptr key_length, void* ctx)
+{
+    (void)data;
+
+    fhashmap_delete(ctx, key, key_length);
+}
+
+static void test_foreach_delete()
+{
+    flat_hashmap_t map = init_fhashmap();
+
+    for (u32 k = 0; k < 1000; k++)
+    {
+        fhashmap_insert(&map, &k, sizeof(k), NULL, FHASHMAP_INS_FLAG_KEY_COPY);
+    }
+
+    fhashmap_foreach(&map, delete_entry, &map);
+    CHECK(fhashmap_count(&map) == 0);
+
+    fhashmap_free(&map);
+}
+
+static const host_case_t tests[] = {
+    { "basic",              test_basic },
+    { "random",             test_random },
+    { "random_rcu",         test_random_rcu },
+    { "incremental_rehash", test_incremental_rehash },
+    { "foreach_delete",     test_foreach_delete },
+    { "rcu_concurrent_rehash", test_rcu_concurrent_rehash },
+    { "rcu_concurrent_delete", test_rcu_concurrent_delete },
+    HOST_CASES_END
+};
+
+static void bench_u32_keys()
+{
+    usize_ptr heap_before = host_heap_bytes();
+    flat_hashmap_t map = init_fhashmap();
+
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    for (u32 k = 0; k < BENCH_KEYS; k++)
+    {
+        fhashmap_insert(&map, &k, sizeof(k), (void*)(uptr)k, FHASHMAP_INS_FLAG_KEY_COPY);
+    }
+    host_bench_report("insert u32", BENCH_KEYS, host_now_ns() - ns, host_cycles() - cycles,
+        host_heap_bytes() - heap_before);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    uptr sum = 0;
+    for (u32 k = 0; k < BENCH_KEYS; k++)
+    {
+        sum += (uptr)fhashmap_get_data(&map, &k, sizeof(k)).value;
+    }
+    host_bench_report("get hit u32", BENCH_KEYS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 k = BENCH_KEYS; k < 2 * BENCH_KEYS; k++)
+    {
+        sum += fhashmap_get_data(&map, &k, sizeof(k)).succeed;
+    }
+    host_bench_report("get miss u32", BENCH_KEYS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 k = 0; k < BENCH_KEYS; k++)
+    {
+        fhashmap_delete(&map, &k, sizeof(k));
+    }
+    host_bench_report("delete u32", BENCH_KEYS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    // keeps the lookups from being optimized out
+    if (sum == 1)
+    {
+        printf("\n");
+    }
+
+    fhashmap_free(&map);
+}
+
+// path component sized keys, like the dentry cache's
+static void bench_name_keys()
+{
+    static char names[BENCH_KEYS][20];
+    for (u32 k = 0; k < BENCH_KEYS; k++)
+    {
+        snprintf(names[k], sizeof(names[k]), "file_%08u.txt", k);
+    }
+
+    usize_ptr heap_before = host_heap_bytes();
+    flat_hashmap_t map = init_fhashmap();
+
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    for (u32 k = 0; k < BENCH_KEYS; k++)
+    {
+        fhashmap_insert(&map, names[k], strlen(names[k]), NULL, FHASHMAP_INS_FLAG_KEY_COPY);
+    }
+    host_bench_report("insert name", BENCH_KEYS, host_now_ns() - ns, host_cycles() - cycles,
+        host_heap_bytes() - heap_before);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    u32 found = 0;
+    for (u32 k = 0; k < BENCH_KEYS; k++)
+    {
+        found += fhashmap_get_data(&map, names[k], strlen(names[k])).succeed;
+    }
+    host_bench_report("get hit name", BENCH_KEYS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    if (found != BENCH_KEYS)
+    {
+        printf("  bench_name_keys: lost keys\n");
+    }
+
+    fhashmap_free(&map);
+}
+
+static const host_case_t benches[] = {
+    { "u32_keys",  bench_u32_keys },
+    { "name_keys", bench_name_keys },
+    HOST_CASES_END
+};
+
+const host_suite_t flat_hashmap_suite = { "flat_hashmap", tests, benches };
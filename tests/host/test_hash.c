@@ -0,0 +1,123 @@
+#include "host_test.h"
+#include <utils/hash/fast_hash.h>
+#include <utils/hash/murmur2_hash.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_ITERATIONS 1000000
+
+static void test_xxhash32_vectors()
+{
+    // reference values from the xxHash project
+    CHECK(xxhash32((const u8*)"", 0) == 0x02CC5D05);
+    CHECK(xxhash32((const u8*)"abc", 3) == 0x32D153FF);
+
+    const char* long_input = "Nobody inspects the spammish repetition";
+    CHECK(xxhash32((const u8*)long_input, strlen(long_input)) == 0xE2293B2F);
+}
+
+// same input at every alignment, the word loads must not care
+static void test_unaligned()
+{
+    u8 buffer[64 + 8];
+    const char* input = "an unaligned input longer than one stripe";
+    usize_ptr length = strlen(input);
+
+    u32 expected = xxhash32((const u8*)input, length);
+    u64 expected_murmur = murmur2_hash64((const u8*)input, length);
+
+    for (u32 offset = 0; offset < 8; offset++)
+    {
+        memcpy(buffer + offset, input, length);
+
+        CHECK(xxhash32(buffer + offset, length) == expected);
+        CHECK(murmur2_hash64(buffer + offset, length) == expected_murmur);
+    }
+}
+
+static void test_combine()
+{
+    // order matters and every input bit counts
+    CHECK(hash_combine(hash_combine(0, 1), 2) != hash_combine(hash_combine(0, 2), 1));
+    CHECK(hash_combine(1, 0) != hash_combine(0, 0));
+    CHECK(hash_u32(1) != hash_u32(2));
+
+    // sequential integers spread over the high bits a map probes with
+    u32 buckets[16] = { 0 };
+    for (u32 i = 0; i < 1600; i++)
+    {
+        buckets[hash_u32(i) >> 28]++;
+    }
+    for (u32 i = 0; i < 16; i++)
+    {
+        CHECK(buckets[i] > 50 && buckets[i] < 150);
+    }
+}
+
+static const host_case_t tests[] = {
+    { "xxhash32_vectors", test_xxhash32_vectors },
+    { "unaligned",        test_unaligned },
+    { "combine",          test_combine },
+    HOST_CASES_END
+};
+
+typedef struct bench_func
+{
+    const char* name;
+    u64 (*hash)(const u8* data, u64 length);
+} bench_func_t;
+
+static u64 murmur2_32(const u8* data, u64 length)
+{
+    return murmur2_hash32(data, length);
+}
+
+static const bench_func_t funcs[] = {
+    { "murmur2_hash32", murmur2_32 },
+    { "murmur2_hash64", murmur2_hash64 },
+    { "xxhash32",       fast_hash },
+};
+
+static const u32 lengths[] = { 4, 8, 16, 32, 64, 256 };
+
+// ops/s and cycles/op per key, cycles/op over the length is cycles/byte
+static void bench_hashes()
+{
+    static u8 buffer[256 + 1];
+    for (u32 i = 0; i < sizeof(buffer); i++)
+    {
+        buffer[i] = (u8)(i * 131 + 7);
+    }
+
+    volatile u64 sink = 0;
+
+    for (u32 f = 0; f < sizeof(funcs) / sizeof(funcs[0]); f++)
+    {
+        for (u32 l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+        {
+            char name[64];
+            snprintf(name, sizeof(name), "%s len %u", funcs[f].name, lengths[l]);
+
+            u64 acc = 0;
+            u64 ns = host_now_ns();
+            u64 cycles = host_cycles();
+            for (u32 i = 0; i < BENCH_ITERATIONS; i++)
+            {
+                // one byte in, every word load is unaligned
+                acc += funcs[f].hash(buffer + 1, lengths[l]);
+            }
+            host_bench_report(name, BENCH_ITERATIONS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+            sink += acc;
+        }
+    }
+
+    (void)sink;
+}
+
+static const host_case_t benches[] = {
+    { "hashes", bench_hashes },
+    HOST_CASES_END
+};
+
+const host_suite_t hash_suite = { "hash", tests, benches };
@@ -0,0 +1,286 @@
+#include "host_test.h"
+#include <utils/data_structs/mpmc_ring.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#define THREADS        4
+#define ITEMS_PER_PROD 500000
+#define BENCH_OPS      1000000
+#define BENCH_BATCH    16
+
+// item = producer in the top byte, its sequence number below (never 0)
+#define ITEM(producer, seq) ((void*)(((uptr)(producer) << 24) | (seq)))
+#define ITEM_PRODUCER(item) ((uptr)(item) >> 24)
+#define ITEM_SEQ(item)      ((uptr)(item) & 0xFFFFFF)
+
+static void test_fifo_full_empty()
+{
+    mpmc_ring_t ring;
+    mpmc_ring_init(&ring, 8);
+
+    CHECK(mpmc_ring_pop(&ring) == NULL);
+    CHECK(mpmc_ring_is_empty(&ring));
+
+    uptr next_in = 1;
+    uptr next_out = 1;
+
+    for (u32 round = 0; round < 50; round++)
+    {
+        while (mpmc_ring_push(&ring, (void*)next_in))
+        {
+            next_in++;
+        }
+        CHECK(mpmc_ring_count(&ring) == 8);
+
+        for (u32 i = 0; i < 3; i++)
+        {
+            CHECK(mpmc_ring_pop(&ring) == (void*)next_out++);
+        }
+    }
+
+    while (!mpmc_ring_is_empty(&ring))
+    {
+        CHECK(mpmc_ring_pop(&ring) == (void*)next_out++);
+    }
+    CHECK(next_out == next_in);
+
+    mpmc_ring_free(&ring);
+}
+
+static void test_batch()
+{
+    mpmc_ring_t ring;
+    mpmc_ring_init(&ring, 8);
+
+    void* in[12];
+    void* out[12];
+    for (uptr i = 0; i < 12; i++)
+    {
+        in[i] = (void*)(i + 1);
+    }
+
+    CHECK(mpmc_ring_push_batch(&ring, in, 5) == 5);
+    CHECK(mpmc_ring_push_batch(&ring, in + 5, 7) == 3);
+    CHECK(mpmc_ring_push_batch(&ring, in + 8, 4) == 0);
+
+    CHECK(mpmc_ring_pop_batch(&ring, out, 6) == 6);
+    CHECK(mpmc_ring_push_batch(&ring, in + 8, 4) == 4);
+    CHECK(mpmc_ring_pop_batch(&ring, out + 6, 12) == 6);
+    CHECK(mpmc_ring_pop_batch(&ring, out, 1) == 0);
+
+    for (u32 i = 0; i < 12; i++)
+    {
+        CHECK(out[i] == in[i]);
+    }
+
+    mpmc_ring_free(&ring);
+}
+
+typedef struct threaded_ctx
+{
+    mpmc_ring_t ring;
+    u32 batch;
+    _Atomic u32 consumed;
+} threaded_ctx_t;
+
+typedef struct worker
+{
+    threaded_ctx_t* ctx;
+    u32 id;
+    // consumer only, per producer: last sequence seen and item count
+    uptr last_seq[THREADS];
+    u32 received[THREADS];
+    bool in_order;
+} worker_t;
+
+static void* producer(void* arg)
+{
+    worker_t* worker = arg;
+    void* items[BENCH_BATCH];
+    uptr next = 1;
+
+    while (next <= ITEMS_PER_PROD)
+    {
+        u32 count = 0;
+        while (count < worker->ctx->batch && next + count <= ITEMS_PER_PROD)
+        {
+            items[count] = ITEM(worker->id, next + count);
+            count++;
+        }
+
+        usize_ptr pushed = mpmc_ring_push_batch(&worker->ctx->ring, items, count);
+        next += pushed;
+
+        if (pushed == 0)
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+// FIFO per producer holds for every single consumer
+static void* consumer(void* arg)
+{
+    worker_t* worker = arg;
+    threaded_ctx_t* ctx = worker->ctx;
+    void* items[BENCH_BATCH];
+
+    worker->in_order = true;
+
+    while (atomic_load(&ctx->consumed) < THREADS * ITEMS_PER_PROD)
+    {
+        usize_ptr popped = mpmc_ring_pop_batch(&ctx->ring, items, ctx->batch);
+
+        for (usize_ptr i = 0; i < popped; i++)
+        {
+            uptr producer = ITEM_PRODUCER(items[i]);
+            uptr seq = ITEM_SEQ(items[i]);
+
+            worker->in_order &= producer < THREADS && seq > worker->last_seq[producer];
+            if (producer < THREADS)
+            {
+                worker->last_seq[producer] = seq;
+                worker->received[producer]++;
+            }
+        }
+
+        if (popped)
+        {
+            atomic_fetch_add(&ctx->consumed, popped);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static bool run_threaded(u32 batch)
+{
+    static threaded_ctx_t ctx;
+    static worker_t producers[THREADS];
+    static worker_t consumers[THREADS];
+
+    mpmc_ring_init(&ctx.ring, 64);
+    ctx.batch = batch;
+    atomic_store(&ctx.consumed, 0);
+
+    pthread_t threads[THREADS * 2];
+    for (u32 i = 0; i < THREADS; i++)
+    {
+        producers[i] = (worker_t){ .ctx = &ctx, .id = i };
+        consumers[i] = (worker_t){ .ctx = &ctx, .id = i };
+
+        pthread_create(&threads[i], NULL, producer, &producers[i]);
+        pthread_create(&threads[THREADS + i], NULL, consumer, &consumers[i]);
+    }
+
+    for (u32 i = 0; i < THREADS * 2; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    bool ok = mpmc_ring_is_empty(&ctx.ring);
+
+    // every item arrived exactly once
+    for (u32 p = 0; p < THREADS; p++)
+    {
+        u32 total = 0;
+        for (u32 c = 0; c < THREADS; c++)
+        {
+            ok &= consumers[c].in_order;
+            total += consumers[c].received[p];
+        }
+
+        ok &= total == ITEMS_PER_PROD;
+    }
+
+    mpmc_ring_free(&ctx.ring);
+
+    return ok;
+}
+
+static void test_threaded()
+{
+    CHECK(run_threaded(1));
+}
+
+static void test_threaded_batch()
+{
+    CHECK(run_threaded(BENCH_BATCH));
+}
+
+static const host_case_t tests[] = {
+    { "fifo_full_empty", test_fifo_full_empty },
+    { "batch",           test_batch },
+    { "threaded",        test_threaded },
+    { "threaded_batch",  test_threaded_batch },
+    HOST_CASES_END
+};
+
+static void bench_push_pop()
+{
+    mpmc_ring_t ring;
+    mpmc_ring_init(&ring, 256);
+
+    uptr sum = 0;
+
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    for (u32 i = 1; i <= BENCH_OPS; i++)
+    {
+        mpmc_ring_push(&ring, (void*)(uptr)i);
+        sum += (uptr)mpmc_ring_pop(&ring);
+    }
+    host_bench_report("push+pop", BENCH_OPS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    void* items[BENCH_BATCH];
+    for (u32 i = 0; i < BENCH_BATCH; i++)
+    {
+        items[i] = (void*)(uptr)(i + 1);
+    }
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_OPS; i += BENCH_BATCH)
+    {
+        mpmc_ring_push_batch(&ring, items, BENCH_BATCH);
+        sum += mpmc_ring_pop_batch(&ring, items, BENCH_BATCH);
+    }
+    host_bench_report("push+pop batch 16", BENCH_OPS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    if (sum == 1)
+    {
+        printf("\n");
+    }
+
+    mpmc_ring_free(&ring);
+}
+
+static void bench_threaded()
+{
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    run_threaded(1);
+    host_bench_report("4+4 threads", THREADS * ITEMS_PER_PROD,
+        host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    run_threaded(BENCH_BATCH);
+    host_bench_report("4+4 threads batch 16", THREADS * ITEMS_PER_PROD,
+        host_now_ns() - ns, host_cycles() - cycles, 0);
+}
+
+static const host_case_t benches[] = {
+    { "push_pop", bench_push_pop },
+    { "threaded", bench_threaded },
+    HOST_CASES_END
+};
+
+const host_suite_t mpmc_ring_suite = { "mpmc_ring", tests, benches };
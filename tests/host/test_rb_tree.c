@@ -0,0 +1,500 @@
+#include "host_test.h"
+#include <utils/data_structs/rb_tree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RANDOM_NODES 10000
+#define BENCH_NODES  200000
+
+typedef struct int_node
+{
+    rb_node_t node;
+    u32 key;
+} int_node_t;
+
+static isize_ptr int_cmp(const rb_node_t* a, const rb_node_t* b)
+{
+    u32 ka = ((const int_node_t*)a)->key;
+    u32 kb = ((const int_node_t*)b)->key;
+
+    return (ka > kb) - (ka < kb);
+}
+
+static isize_ptr int_node_cmp(const int_node_t* a, const int_node_t* b)
+{
+    return (a->key > b->key) - (a->key < b->key);
+}
+
+RB_DEFINE_TYPED(int_tree, int_node_t, node, int_node_cmp)
+
+static bool node_red(const rb_node_t* node)
+{
+    return node && (node->parent_color & 1);
+}
+
+static rb_node_t* node_parent(const rb_node_t* node)
+{
+    return (rb_node_t*)(node->parent_color & ~(usize_ptr)3);
+}
+
+// black height of the subtree, -1 if a red black rule is broken below
+static i32 check_subtree(const rb_node_t* node, const rb_node_t* parent)
+{
+    if (node == NULL)
+    {
+        return 1;
+    }
+
+    if (node_parent(node) != parent)
+        return -1;
+
+    if (node_red(node) && (node_red(node->left) || node_red(node->right)))
+        return -1;
+
+    i32 left  = check_subtree(node->left, node);
+    i32 right = check_subtree(node->right, node);
+
+    if (left < 0 || left != right)
+        return -1;
+
+    return left + !node_red(node);
+}
+
+static bool tree_valid(rb_tree_t* tree)
+{
+    if (node_red(tree->root))
+        return false;
+
+    return check_subtree(tree->root, NULL) > 0;
+}
+
+static void test_random()
+{
+    static int_node_t nodes[RANDOM_NODES];
+    static bool present[RANDOM_NODES];
+    memset(present, 0, sizeof(present));
+
+    rb_tree_t tree;
+    rb_init_tree(&tree, int_cmp, NULL);
+
+    u32 seed = 7;
+    u32 live = 0;
+
+    for (u32 i = 0; i < 4 * RANDOM_NODES; i++)
+    {
+        u32 k = host_rand(&seed) % RANDOM_NODES;
+        nodes[k].key = k;
+
+        if (present[k])
+        {
+            CHECK(rb_remove_key(&tree, &nodes[k].node) == &nodes[k].node);
+            present[k] = false;
+            live--;
+        }
+        else
+        {
+            CHECK(rb_insert(&tree, &nodes[k].node) == &nodes[k].node);
+            present[k] = true;
+            live++;
+        }
+
+        if (i % 512 == 0)
+        {
+            CHECK(tree_valid(&tree));
+        }
+    }
+
+    CHECK(tree_valid(&tree));
+
+    // in order walk sees every live key once, ascending
+    u32 seen = 0;
+    i64 last = -1;
+    rb_node_t* it;
+    rb_for_each(&tree, it)
+    {
+        u32 key = ((int_node_t*)it)->key;
+
+        CHECK((i64)key > last);
+        CHECK(present[key]);
+
+        last = key;
+        seen++;
+    }
+    CHECK(seen == live);
+
+    // and backwards
+    seen = 0;
+    for (it = rb_max(&tree); it; it = rb_prev(it))
+    {
+        seen++;
+    }
+    CHECK(seen == live);
+
+    for (u32 k = 0; k < RANDOM_NODES; k++)
+    {
+        int_node_t key = { .key = k };
+        CHECK((rb_search(&tree, &key.node) != NULL) == present[k]);
+    }
+}
+
+static void test_bounds()
+{
+    static int_node_t nodes[100];
+
+    rb_tree_t tree;
+    rb_init_tree(&tree, int_cmp, NULL);
+
+    // even keys 0..198
+    for (u32 i = 0; i < 100; i++)
+    {
+        nodes[i].key = i * 2;
+        rb_insert(&tree, &nodes[i].node);
+    }
+
+    int_node_t key = { .key = 51 };
+
+    // smallest >= key
+    CHECK(((int_node_t*)rb_lower_bound(&tree, &key.node))->key == 52);
+    // largest <= key
+    CHECK(((int_node_t*)rb_upper_bound(&tree, &key.node))->key == 50);
+
+    key.key = 52;
+    CHECK(((int_node_t*)rb_lower_bound(&tree, &key.node))->key == 52);
+    CHECK(((int_node_t*)rb_upper_bound(&tree, &key.node))->key == 52);
+
+    key.key = 199;
+    CHECK(rb_lower_bound(&tree, &key.node) == NULL);
+
+    CHECK(((int_node_t*)rb_min(&tree))->key == 0);
+    CHECK(((int_node_t*)rb_max(&tree))->key == 198);
+
+    // duplicates are refused
+    int_node_t dup = { .key = 10 };
+    CHECK(rb_insert(&tree, &dup.node) == NULL);
+}
+
+// the cached ends follow every insert and removal
+static void test_cached()
+{
+    static int_node_t nodes[RANDOM_NODES];
+    static bool present[RANDOM_NODES];
+    memset(present, 0, sizeof(present));
+
+    rb_tree_t tree;
+    rb_init_tree_cached(&tree, int_cmp, NULL);
+
+    CHECK(rb_min(&tree) == NULL && rb_max(&tree) == NULL);
+
+    u32 seed = 11;
+    for (u32 i = 0; i < 4 * RANDOM_NODES; i++)
+    {
+        u32 k = host_rand(&seed) % RANDOM_NODES;
+        nodes[k].key = k;
+
+        if (present[k])
+        {
+            rb_remove_node(&tree, &nodes[k].node);
+        }
+        else
+        {
+            rb_insert(&tree, &nodes[k].node);
+        }
+        present[k] = !present[k];
+
+        // skewed towards the ends, where the cache changes
+        if (i % 64 == 0)
+        {
+            rb_node_t* min = rb_min(&tree);
+            if (min)
+            {
+                rb_remove_node(&tree, min);
+                present[((int_node_t*)min)->key] = false;
+            }
+        }
+
+        u32 lo = 0;
+        while (lo < RANDOM_NODES && !present[lo])
+        {
+            lo++;
+        }
+        u32 hi = RANDOM_NODES;
+        while (hi > 0 && !present[hi - 1])
+        {
+            hi--;
+        }
+
+        if (lo == RANDOM_NODES)
+        {
+            CHECK(rb_min(&tree) == NULL && rb_max(&tree) == NULL);
+        }
+        else
+        {
+            CHECK(rb_min(&tree) == &nodes[lo].node);
+            CHECK(rb_max(&tree) == &nodes[hi - 1].node);
+        }
+    }
+
+    CHECK(tree_valid(&tree));
+}
+
+// removing the node the iterator is on doesn't break the walk
+static void test_iter()
+{
+    static int_node_t nodes[1000];
+
+    rb_tree_t tree;
+    rb_init_tree_cached(&tree, int_cmp, NULL);
+
+    for (u32 i = 0; i < 1000; i++)
+    {
+        nodes[i].key = i;
+        rb_insert(&tree, &nodes[i].node);
+    }
+
+    rb_iter_t iter;
+    rb_node_t* it;
+    u32 expected = 0;
+
+    rb_for_each_safe(&tree, &iter, it)
+    {
+        u32 key = ((int_node_t*)it)->key;
+        CHECK(key == expected++);
+
+        if (key % 3 == 0)
+        {
+            rb_remove_node(&tree, it);
+        }
+    }
+    CHECK(expected == 1000);
+    CHECK(tree_valid(&tree));
+
+    // starts at the lower bound, 500 and up minus the multiples of 3
+    int_node_t key = { .key = 500 };
+    u32 seen = 0;
+    i64 last = 499;
+    for (it = rb_iter_from(&tree, &iter, &key.node); it; it = rb_iter_next(&iter))
+    {
+        u32 k = ((int_node_t*)it)->key;
+        CHECK((i64)k > last && k % 3 != 0);
+
+        last = k;
+        seen++;
+    }
+    CHECK(seen == 333);
+}
+
+// the generated wrappers agree with the generic calls
+static void test_typed()
+{
+    static int_node_t nodes[RANDOM_NODES];
+    static bool present[RANDOM_NODES];
+    memset(present, 0, sizeof(present));
+
+    rb_tree_t tree;
+    rb_init_tree_cached(&tree, int_tree_cmp_nodes, NULL);
+
+    u32 seed = 13;
+    for (u32 i = 0; i < 4 * RANDOM_NODES; i++)
+    {
+        u32 k = (host_rand(&seed) % RANDOM_NODES) & ~1u;
+        nodes[k].key = k;
+
+        if (present[k])
+        {
+            CHECK(int_tree_remove(&tree, &nodes[k]) == &nodes[k]);
+        }
+        else
+        {
+            CHECK(int_tree_insert(&tree, &nodes[k]) == &nodes[k]);
+        }
+        present[k] = !present[k];
+    }
+
+    CHECK(tree_valid(&tree));
+
+    for (u32 k = 0; k < RANDOM_NODES; k++)
+    {
+        int_node_t key = { .key = k };
+
+        CHECK((int_tree_search(&tree, &key) != NULL) == present[k]);
+        CHECK(int_tree_lower_bound(&tree, &key) == int_tree_entry(rb_lower_bound(&tree, &key.node)));
+        CHECK(int_tree_upper_bound(&tree, &key) == int_tree_entry(rb_upper_bound(&tree, &key.node)));
+
+        if (present[k])
+        {
+            CHECK(int_tree_insert(&tree, &key) == NULL);
+        }
+    }
+
+    u32 seen = 0;
+    for (int_node_t* it = int_tree_first(&tree); it; it = int_tree_next(it))
+    {
+        CHECK(present[it->key]);
+        seen++;
+    }
+    for (int_node_t* it = int_tree_last(&tree); it; it = int_tree_prev(it))
+    {
+        seen--;
+    }
+    CHECK(seen == 0);
+}
+
+static const host_case_t tests[] = {
+    { "random", test_random },
+    { "bounds", test_bounds },
+    { "cached", test_cached },
+    { "iter",   test_iter },
+    { "typed",  test_typed },
+    HOST_CASES_END
+};
+
+static int_node_t* bench_nodes()
+{
+    int_node_t* nodes = malloc(sizeof(int_node_t) * BENCH_NODES);
+
+    // random order, sorted input would only exercise one spine
+    u32 seed = 3;
+    for (u32 i = 0; i < BENCH_NODES; i++)
+    {
+        nodes[i].key = i;
+    }
+    for (u32 i = BENCH_NODES - 1; i > 0; i--)
+    {
+        u32 j = host_rand(&seed) % (i + 1);
+        u32 tmp = nodes[i].key;
+        nodes[i].key = nodes[j].key;
+        nodes[j].key = tmp;
+    }
+
+    return nodes;
+}
+
+static void bench_ops()
+{
+    int_node_t* nodes = bench_nodes();
+
+    rb_tree_t tree;
+    rb_init_tree(&tree, int_cmp, NULL);
+
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_NODES; i++)
+    {
+        rb_insert(&tree, &nodes[i].node);
+    }
+    // intrusive, the only overhead is the embedded node
+    host_bench_report("insert", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles,
+        (u64)sizeof(rb_node_t) * BENCH_NODES);
+
+    u32 found = 0;
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_NODES; i++)
+    {
+        int_node_t key = { .key = i };
+        found += rb_search(&tree, &key.node) != NULL;
+    }
+    host_bench_report("search", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_NODES; i++)
+    {
+        found += rb_min(&tree) != NULL;
+    }
+    host_bench_report("min", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    rb_node_t* it;
+    rb_for_each(&tree, it)
+    {
+        found++;
+    }
+    host_bench_report("in order step", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_NODES; i++)
+    {
+        rb_remove_node(&tree, &nodes[i].node);
+    }
+    host_bench_report("remove node", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    if (found != 3 * BENCH_NODES)
+    {
+        printf("  bench_ops: lost nodes\n");
+    }
+
+    free(nodes);
+}
+
+// same ops on a cached tree through the inlined comparator
+static void bench_typed()
+{
+    int_node_t* nodes = bench_nodes();
+
+    rb_tree_t tree;
+    rb_init_tree_cached(&tree, int_tree_cmp_nodes, NULL);
+
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_NODES; i++)
+    {
+        int_tree_insert(&tree, &nodes[i]);
+    }
+    host_bench_report("typed insert", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles,
+        (u64)sizeof(rb_node_t) * BENCH_NODES);
+
+    u32 found = 0;
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_NODES; i++)
+    {
+        int_node_t key = { .key = i };
+        found += int_tree_search(&tree, &key) != NULL;
+    }
+    host_bench_report("typed search", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_NODES; i++)
+    {
+        found += int_tree_first(&tree) != NULL;
+    }
+    host_bench_report("cached min", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    rb_iter_t iter;
+    rb_node_t* it;
+    rb_for_each_safe(&tree, &iter, it)
+    {
+        found++;
+    }
+    host_bench_report("iter step", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_NODES; i++)
+    {
+        int_tree_remove(&tree, &nodes[i]);
+    }
+    host_bench_report("cached remove", BENCH_NODES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    if (found != 3 * BENCH_NODES)
+    {
+        printf("  bench_typed: lost nodes\n");
+    }
+
+    free(nodes);
+}
+
+static const host_case_t benches[] = {
+    { "ops",   bench_ops },
+    { "typed", bench_typed },
+    HOST_CASES_END
+};
+
+const host_suite_t rb_tree_suite = { "rb_tree", tests, benches };
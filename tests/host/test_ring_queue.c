@@ -0,0 +1,86 @@
+#include "host_test.h"
+#include <utils/data_structs/ring_queue.h>
+#include <memory/heap/heap.h>
+#include <stdio.h>
+
+#define BENCH_OPS 1000000
+
+// FIFO order has to survive growing while the ring is wrapped
+static void test_wrap_and_grow()
+{
+    ring_queue_t queue;
+    ring_queue_init_capacity(&queue, 4);
+
+    uptr next_in = 1;
+    uptr next_out = 1;
+
+    for (u32 round = 0; round < 200; round++)
+    {
+        // net growth of one per round, the head walks around meanwhile
+        for (u32 i = 0; i < 3; i++)
+        {
+            CHECK(ring_queue_push(&queue, (void*)next_in++));
+        }
+        for (u32 i = 0; i < 2; i++)
+        {
+            CHECK(ring_queue_pop(&queue) == (void*)next_out++);
+        }
+    }
+
+    while (!ring_queue_is_empty(&queue))
+    {
+        CHECK(ring_queue_pop(&queue) == (void*)next_out++);
+    }
+
+    CHECK(next_out == next_in);
+    CHECK(ring_queue_pop(&queue) == NULL);
+
+    kfree(queue.arr);
+}
+
+static const host_case_t tests[] = {
+    { "wrap_and_grow", test_wrap_and_grow },
+    HOST_CASES_END
+};
+
+static void bench_push_pop()
+{
+    ring_queue_t queue;
+    ring_queue_init(&queue);
+
+    // steady state, the ring never grows
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    uptr sum = 0;
+    for (u32 i = 0; i < BENCH_OPS; i++)
+    {
+        ring_queue_push(&queue, (void*)(uptr)i);
+        sum += (uptr)ring_queue_pop(&queue);
+    }
+    host_bench_report("push+pop", BENCH_OPS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    // growing from empty
+    usize_ptr heap_before = host_heap_bytes();
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_OPS; i++)
+    {
+        ring_queue_push(&queue, (void*)(uptr)i);
+    }
+    host_bench_report("push grow", BENCH_OPS, host_now_ns() - ns, host_cycles() - cycles,
+        host_heap_bytes() - heap_before);
+
+    if (sum == 1)
+    {
+        printf("\n");
+    }
+
+    kfree(queue.arr);
+}
+
+static const host_case_t benches[] = {
+    { "push_pop", bench_push_pop },
+    HOST_CASES_END
+};
+
+const host_suite_t ring_queue_suite = { "ring_queue", tests, benches };
@@ -0,0 +1,218 @@
+#include "host_test.h"
+#include <utils/data_structs/spsc_ring.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#define THREADED_ITEMS 2000000
+#define BENCH_OPS      1000000
+#define BENCH_BATCH    16
+
+static void test_fifo_full_empty()
+{
+    spsc_ring_t ring;
+    spsc_ring_init(&ring, 8);
+
+    CHECK(spsc_ring_pop(&ring) == NULL);
+
+    uptr next_in = 1;
+    uptr next_out = 1;
+
+    // walk the indices around several laps
+    for (u32 round = 0; round < 50; round++)
+    {
+        while (spsc_ring_push(&ring, (void*)next_in))
+        {
+            next_in++;
+        }
+        CHECK(spsc_ring_count(&ring) == 8);
+
+        for (u32 i = 0; i < 5; i++)
+        {
+            CHECK(spsc_ring_pop(&ring) == (void*)next_out++);
+        }
+    }
+
+    while (!spsc_ring_is_empty(&ring))
+    {
+        CHECK(spsc_ring_pop(&ring) == (void*)next_out++);
+    }
+    CHECK(next_out == next_in);
+
+    spsc_ring_free(&ring);
+}
+
+static void test_batch()
+{
+    spsc_ring_t ring;
+    spsc_ring_init(&ring, 8);
+
+    void* in[12];
+    void* out[12];
+    for (uptr i = 0; i < 12; i++)
+    {
+        in[i] = (void*)(i + 1);
+    }
+
+    // only the prefix that fits goes in
+    CHECK(spsc_ring_push_batch(&ring, in, 5) == 5);
+    CHECK(spsc_ring_push_batch(&ring, in + 5, 7) == 3);
+    CHECK(spsc_ring_push_batch(&ring, in + 8, 4) == 0);
+
+    CHECK(spsc_ring_pop_batch(&ring, out, 6) == 6);
+    CHECK(spsc_ring_push_batch(&ring, in + 8, 4) == 4);
+    CHECK(spsc_ring_pop_batch(&ring, out + 6, 12) == 6);
+    CHECK(spsc_ring_pop_batch(&ring, out, 1) == 0);
+
+    for (u32 i = 0; i < 12; i++)
+    {
+        CHECK(out[i] == in[i]);
+    }
+
+    spsc_ring_free(&ring);
+}
+
+typedef struct threaded_ctx
+{
+    spsc_ring_t ring;
+    u32 batch;
+} threaded_ctx_t;
+
+static void* producer(void* arg)
+{
+    threaded_ctx_t* ctx = arg;
+    void* items[BENCH_BATCH];
+    uptr next = 1;
+
+    while (next <= THREADED_ITEMS)
+    {
+        u32 count = 0;
+        while (count < ctx->batch && next + count <= THREADED_ITEMS)
+        {
+            items[count] = (void*)(next + count);
+            count++;
+        }
+
+        usize_ptr pushed = spsc_ring_push_batch(&ctx->ring, items, count);
+        next += pushed;
+
+        if (pushed == 0)
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+// one producer thread, the consumer must see every item once and in order
+static void run_threaded(u32 batch)
+{
+    threaded_ctx_t ctx;
+    spsc_ring_init(&ctx.ring, 64);
+    ctx.batch = batch;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, producer, &ctx);
+
+    void* items[BENCH_BATCH];
+    uptr expected = 1;
+    bool in_order = true;
+
+    while (expected <= THREADED_ITEMS)
+    {
+        usize_ptr popped = spsc_ring_pop_batch(&ctx.ring, items, batch);
+        for (usize_ptr i = 0; i < popped; i++)
+        {
+            in_order &= items[i] == (void*)expected++;
+        }
+
+        if (popped == 0)
+        {
+            sched_yield();
+        }
+    }
+
+    pthread_join(thread, NULL);
+    spsc_ring_free(&ctx.ring);
+
+    CHECK(in_order);
+}
+
+static void test_threaded()
+{
+    run_threaded(1);
+}
+
+static void test_threaded_batch()
+{
+    run_threaded(BENCH_BATCH);
+}
+
+static const host_case_t tests[] = {
+    { "fifo_full_empty", test_fifo_full_empty },
+    { "batch",           test_batch },
+    { "threaded",        test_threaded },
+    { "threaded_batch",  test_threaded_batch },
+    HOST_CASES_END
+};
+
+static void bench_push_pop()
+{
+    spsc_ring_t ring;
+    spsc_ring_init(&ring, 256);
+
+    uptr sum = 0;
+
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    for (u32 i = 1; i <= BENCH_OPS; i++)
+    {
+        spsc_ring_push(&ring, (void*)(uptr)i);
+        sum += (uptr)spsc_ring_pop(&ring);
+    }
+    host_bench_report("push+pop", BENCH_OPS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    void* items[BENCH_BATCH];
+    for (u32 i = 0; i < BENCH_BATCH; i++)
+    {
+        items[i] = (void*)(uptr)(i + 1);
+    }
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_OPS; i += BENCH_BATCH)
+    {
+        spsc_ring_push_batch(&ring, items, BENCH_BATCH);
+        sum += spsc_ring_pop_batch(&ring, items, BENCH_BATCH);
+    }
+    host_bench_report("push+pop batch 16", BENCH_OPS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    if (sum == 1)
+    {
+        printf("\n");
+    }
+
+    spsc_ring_free(&ring);
+}
+
+static void bench_threaded()
+{
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    run_threaded(1);
+    host_bench_report("2 threads", THREADED_ITEMS, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    run_threaded(BENCH_BATCH);
+    host_bench_report("2 threads batch 16", THREADED_ITEMS, host_now_ns() - ns, host_cycles() - cycles, 0);
+}
+
+static const host_case_t benches[] = {
+    { "push_pop", bench_push_pop },
+    { "threaded", bench_threaded },
+    HOST_CASES_END
+};
+
+const host_suite_t spsc_ring_suite = { "spsc_ring", tests, benches };
@@ -0,0 +1,364 @@
+#include "host_test.h"
+#include <utils/data_structs/xarray.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RANDOM_SLOTS 4096
+#define BENCH_PAGES  (1 << 18)
+
+// entries only need to be non NULL
+#define ENTRY(i) ((void*)(((uptr)(i) << 2) | 0x1000))
+
+// spread over several levels, with a dense run at the bottom
+static usize_ptr slot_index(u32 slot)
+{
+    if (slot < RANDOM_SLOTS / 2)
+    {
+        return slot;
+    }
+
+    return (usize_ptr)slot * 0x10001 + ((usize_ptr)slot << 40);
+}
+
+static void test_basic()
+{
+    xarray_t xa;
+    init_xarray(&xa);
+
+    usize_ptr heap = host_heap_bytes();
+
+    CHECK(xa_load(&xa, 0) == NULL);
+    CHECK(xa_erase(&xa, 5) == NULL);
+
+    CHECK(xa_store(&xa, 5, ENTRY(5)) == NULL);
+    CHECK(xa_load(&xa, 5) == ENTRY(5));
+    CHECK(xa_load(&xa, 4) == NULL);
+
+    // replacing returns the old entry
+    CHECK(xa_store(&xa, 5, ENTRY(6)) == ENTRY(5));
+
+    // far indices grow the tree over the existing one
+    usize_ptr far = (usize_ptr)-1;
+    CHECK(xa_store(&xa, far, ENTRY(7)) == NULL);
+    CHECK(xa_store(&xa, 64, ENTRY(8)) == NULL);
+
+    CHECK(xa_load(&xa, 5) == ENTRY(6));
+    CHECK(xa_load(&xa, far) == ENTRY(7));
+    CHECK(xa_load(&xa, far - 1) == NULL);
+    CHECK(xa_load(&xa, 64) == ENTRY(8));
+
+    CHECK(xa_erase(&xa, far) == ENTRY(7));
+    CHECK(xa_load(&xa, 5) == ENTRY(6));
+
+    // storing NULL erases
+    CHECK(xa_store(&xa, 64, NULL) == ENTRY(8));
+    CHECK(xa_erase(&xa, 5) == ENTRY(6));
+
+    // the last erase takes every node with it
+    CHECK(xa.root == NULL);
+    CHECK(host_heap_bytes() == heap);
+
+    xa_destroy(&xa);
+}
+
+static void test_random()
+{
+    static bool present[RANDOM_SLOTS];
+    static bool tagged[RANDOM_SLOTS];
+    memset(present, 0, sizeof(present));
+    memset(tagged, 0, sizeof(tagged));
+
+    xarray_t xa;
+    init_xarray(&xa);
+
+    u32 seed = 17;
+
+    for (u32 i = 0; i < 8 * RANDOM_SLOTS; i++)
+    {
+        u32 slot = host_rand(&seed) % RANDOM_SLOTS;
+        usize_ptr index = slot_index(slot);
+
+        if (present[slot])
+        {
+            if (host_rand(&seed) & 1)
+            {
+                CHECK(xa_erase(&xa, index) == ENTRY(slot));
+                present[slot] = false;
+                tagged[slot] = false;
+            }
+            else
+            {
+                // flip the tag instead
+                if (tagged[slot])
+                    xa_clear_tag(&xa, index, XA_TAG_DIRTY);
+                else
+                    xa_set_tag(&xa, index, XA_TAG_DIRTY);
+
+                tagged[slot] = !tagged[slot];
+            }
+        }
+        else
+        {
+            CHECK(xa_store(&xa, index, ENTRY(slot)) == NULL);
+            present[slot] = true;
+        }
+    }
+
+    u32 live = 0;
+    u32 live_tagged = 0;
+    for (u32 slot = 0; slot < RANDOM_SLOTS; slot++)
+    {
+        usize_ptr index = slot_index(slot);
+
+        CHECK(xa_load(&xa, index) == (present[slot] ? ENTRY(slot) : NULL));
+        CHECK(xa_get_tag(&xa, index, XA_TAG_DIRTY) == tagged[slot]);
+        CHECK(!xa_get_tag(&xa, index, XA_TAG_WRITEBACK));
+
+        live += present[slot];
+        live_tagged += tagged[slot];
+    }
+
+    CHECK(xa_tagged(&xa, XA_TAG_DIRTY) == (live_tagged != 0));
+    CHECK(!xa_tagged(&xa, XA_TAG_WRITEBACK));
+
+    // slot_index is increasing, so both walks come in slot order
+    usize_ptr index;
+    void* entry;
+    u32 slot = 0;
+    u32 seen = 0;
+
+    xa_for_each(&xa, index, entry)
+    {
+        while (!present[slot])
+        {
+            slot++;
+        }
+
+        CHECK(index == slot_index(slot) && entry == ENTRY(slot));
+        slot++;
+        seen++;
+    }
+    CHECK(seen == live);
+
+    slot = 0;
+    seen = 0;
+    xa_for_each_tag(&xa, index, entry, XA_TAG_DIRTY)
+    {
+        while (!tagged[slot])
+        {
+            slot++;
+        }
+
+        CHECK(index == slot_index(slot) && entry == ENTRY(slot));
+        slot++;
+        seen++;
+    }
+    CHECK(seen == live_tagged);
+
+    xa_destroy(&xa);
+    CHECK(xa_load(&xa, 0) == NULL);
+}
+
+static void test_range()
+{
+    xarray_t xa;
+    init_xarray(&xa);
+
+    // every third index across a few leaves
+    for (usize_ptr i = 0; i < 1000; i += 3)
+    {
+        xa_store(&xa, i, ENTRY(i));
+    }
+
+    usize_ptr index;
+    void* entry;
+    u32 seen = 0;
+
+    xa_for_each_range(&xa, index, entry, 100, 200)
+    {
+        CHECK(index >= 100 && index <= 200 && index % 3 == 0);
+        CHECK(entry == ENTRY(index));
+        seen++;
+    }
+    // 102..198
+    CHECK(seen == 33);
+
+    // erasing the current entry doesn't stop the walk
+    seen = 0;
+    xa_for_each(&xa, index, entry)
+    {
+        xa_erase(&xa, index);
+        seen++;
+    }
+    CHECK(seen == 334);
+    CHECK(xa.root == NULL);
+
+    // a range ending at the top index
+    usize_ptr top = (usize_ptr)-1;
+    xa_store(&xa, top, ENTRY(1));
+    xa_store(&xa, top - 64, ENTRY(2));
+
+    index = top - 100;
+    CHECK(xa_find(&xa, &index, top) == ENTRY(2) && index == top - 64);
+    CHECK(xa_find_after(&xa, &index, top) == ENTRY(1) && index == top);
+    CHECK(xa_find_after(&xa, &index, top) == NULL);
+
+    index = 0;
+    CHECK(xa_find(&xa, &index, top - 65) == NULL);
+
+    xa_destroy(&xa);
+}
+
+static void test_tags()
+{
+    xarray_t xa;
+    init_xarray(&xa);
+
+    for (usize_ptr i = 0; i < 512; i++)
+    {
+        xa_store(&xa, i, ENTRY(i));
+    }
+
+    xa_set_tag(&xa, 300, XA_TAG_WRITEBACK);
+    xa_set_tag(&xa, 7, XA_TAG_ACCESSED);
+
+    // replacing keeps the tags
+    xa_store(&xa, 300, ENTRY(1));
+    CHECK(xa_get_tag(&xa, 300, XA_TAG_WRITEBACK));
+
+    usize_ptr index = 0;
+    CHECK(xa_find_tag(&xa, &index, 511, XA_TAG_WRITEBACK) == ENTRY(1) && index == 300);
+    CHECK(xa_find_tag_after(&xa, &index, 511, XA_TAG_WRITEBACK) == NULL);
+
+    index = 8;
+    CHECK(xa_find_tag(&xa, &index, 511, XA_TAG_ACCESSED) == NULL);
+
+    // erasing drops them, up to the root
+    xa_erase(&xa, 300);
+    CHECK(!xa_tagged(&xa, XA_TAG_WRITEBACK));
+    CHECK(xa_tagged(&xa, XA_TAG_ACCESSED));
+
+    xa_clear_tag(&xa, 7, XA_TAG_ACCESSED);
+    CHECK(!xa_tagged(&xa, XA_TAG_ACCESSED));
+
+    // and a tag survives the tree growing over it
+    xa_set_tag(&xa, 5, XA_TAG_DIRTY);
+    xa_store(&xa, (usize_ptr)1 << 30, ENTRY(2));
+
+    index = 0;
+    CHECK(xa_find_tag(&xa, &index, (usize_ptr)-1, XA_TAG_DIRTY) == ENTRY(5) && index == 5);
+
+    xa_destroy(&xa);
+}
+
+// in RCU mode nodes outlive their removal until a grace period
+static void test_rcu()
+{
+    xarray_t xa;
+    init_xarray(&xa);
+    xa_set_rcu(&xa);
+
+    usize_ptr heap = host_heap_bytes();
+
+    for (usize_ptr i = 0; i < 4096; i += 64)
+    {
+        xa_store(&xa, i, ENTRY(i));
+    }
+
+    for (usize_ptr i = 0; i < 4096; i += 64)
+    {
+        CHECK(xa_erase(&xa, i) == ENTRY(i));
+    }
+
+    CHECK(xa.root == NULL);
+    CHECK(host_heap_bytes() > heap);
+
+    host_rcu_flush();
+    CHECK(host_heap_bytes() == heap);
+}
+
+static const host_case_t tests[] = {
+    { "basic",  test_basic },
+    { "random", test_random },
+    { "range",  test_range },
+    { "tags",   test_tags },
+    { "rcu",    test_rcu },
+    HOST_CASES_END
+};
+
+// a page cache shaped load: a dense file, every 64th page dirty
+static void bench_pages()
+{
+    xarray_t xa;
+    init_xarray(&xa);
+
+    usize_ptr heap = host_heap_bytes();
+
+    u64 ns = host_now_ns();
+    u64 cycles = host_cycles();
+    for (usize_ptr i = 0; i < BENCH_PAGES; i++)
+    {
+        xa_store(&xa, i, ENTRY(i));
+    }
+    host_bench_report("store dense", BENCH_PAGES, host_now_ns() - ns, host_cycles() - cycles,
+        host_heap_bytes() - heap);
+
+    u32 seed = 5;
+    uptr sum = 0;
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (u32 i = 0; i < BENCH_PAGES; i++)
+    {
+        sum += (uptr)xa_load(&xa, host_rand(&seed) % BENCH_PAGES);
+    }
+    host_bench_report("load random", BENCH_PAGES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    usize_ptr index;
+    void* entry;
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    xa_for_each(&xa, index, entry)
+    {
+        sum += (uptr)entry;
+    }
+    host_bench_report("iterate", BENCH_PAGES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    for (usize_ptr i = 0; i < BENCH_PAGES; i += 64)
+    {
+        xa_set_tag(&xa, i, XA_TAG_DIRTY);
+    }
+
+    // untagged leaves are skipped whole
+    ns = host_now_ns();
+    cycles = host_cycles();
+    u32 dirty = 0;
+    xa_for_each_tag(&xa, index, entry, XA_TAG_DIRTY)
+    {
+        dirty++;
+    }
+    host_bench_report("find dirty 1/64", dirty, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    ns = host_now_ns();
+    cycles = host_cycles();
+    for (usize_ptr i = 0; i < BENCH_PAGES; i++)
+    {
+        xa_erase(&xa, i);
+    }
+    host_bench_report("erase", BENCH_PAGES, host_now_ns() - ns, host_cycles() - cycles, 0);
+
+    if (sum == 1 || dirty != BENCH_PAGES / 64)
+    {
+        printf("  bench_pages: lost entries\n");
+    }
+
+    xa_destroy(&xa);
+}
+
+static const host_case_t benches[] = {
+    { "pages", bench_pages },
+    HOST_CASES_END
+};
+
+const host_suite_t xarray_suite = { "xarray", tests, benches };
@@ -0,0 +1,20 @@
+#include "host_test.h"
+
+extern const host_suite_t flat_hashmap_suite;
+extern const host_suite_t rb_tree_suite;
+extern const host_suite_t ring_queue_suite;
+extern const host_suite_t spsc_ring_suite;
+extern const host_suite_t mpmc_ring_suite;
+extern const host_suite_t xarray_suite;
+extern const host_suite_t hash_suite;
+
+const host_suite_t* const host_suites[] = {
+    &flat_hashmap_suite,
+    &rb_tree_suite,
+    &ring_queue_suite,
+    &spsc_ring_suite,
+    &mpmc_ring_suite,
+    &xarray_suite,
+    &hash_suite,
+    NULL
+};